@@ -1,11 +1,16 @@
+#include "benchmark_suite.hpp"
+
 #include <gfs/gfs.hpp>
 
-#include <chrono>
+#include <algorithm>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
+#include <unordered_map>
 
 std::random_device sRandDevice;
 std::mt19937 sRandGen(sRandDevice());
@@ -13,28 +18,8 @@ std::uniform_real_distribution<float> sFloatDist;
 std::uniform_int_distribution<uint32_t> sIntDist;
 
 constexpr uint32_t TEST_DATA_COUNT = 50000;
-constexpr uint32_t TEST_LOOP_COUNT = 20;
-constexpr const char* TEST_TMP_FILE_NAME = "tmp.bin";
-
-static auto Benchmark(uint32_t loopTimes, const std::function<void()>& func) -> uint32_t
-{
-	using std::chrono::duration_cast;
-	using std::chrono::milliseconds;
-	using clock = std::chrono::high_resolution_clock;
-
-	auto start = clock::now();
-
-	for (auto i = 0u; i < loopTimes; ++i)
-		func();
-
-	auto end = clock::now();
-	auto duration = uint32_t(duration_cast<milliseconds>(end - start).count());
-
-	if (std::filesystem::exists(TEST_TMP_FILE_NAME))
-		std::filesystem::remove(TEST_TMP_FILE_NAME);
-
-	return duration;
-}
+constexpr uint32_t FILE_ROTATION_COUNT = 8; // Files written/read round robin so each iteration does not hit the same file.
+constexpr const char* BENCHMARK_SHARED_CACHE_NAME = "gfs_benchmark_cache"; // Removed before & after use.
 
 struct DataObject
 {
@@ -52,58 +37,545 @@ struct DataObject
 	}
 };
 
-int main()
+// Same layout as `DataObject` without the (randomizing) constructor, so reads only measure deserialization.
+struct PlainDataObject
+{
+	float floats[4];
+	uint32_t ints[4];
+	bool b;
+};
+static_assert(sizeof(PlainDataObject) == sizeof(DataObject));
+
+struct StreamedDataObject : gfs::BinaryStreamable
+{
+	float floats[4]{};
+	uint32_t ints[4]{};
+	bool b = false;
+
+	void Read(gfs::ReadOnlyByteBuffer& buffer) override
+	{
+		buffer.Read(floats);
+		buffer.Read(ints);
+		buffer.Read(b);
+	}
+
+	void Write(gfs::WriteOnlyByteBuffer& buffer) const override
+	{
+		buffer.Write(floats);
+		buffer.Write(ints);
+		buffer.Write(b);
+	}
+};
+
+struct FieldDataObject : gfs::FieldStreamable<FieldDataObject>
+{
+	float floats[4]{};
+	uint32_t ints[4]{};
+	bool b = false;
+
+	static constexpr auto GetFields()
+	{
+		return std::make_tuple(gfs::Field(&FieldDataObject::floats), gfs::Field(&FieldDataObject::ints), gfs::Field(&FieldDataObject::b));
+	}
+};
+
+struct BlobObject : gfs::BinaryStreamable
+{
+	std::vector<uint8_t> Data;
+
+	void Read(gfs::ReadOnlyByteBuffer& buffer) override { buffer.Read(Data); }
+	void Write(gfs::WriteOnlyByteBuffer& buffer) const override { buffer.Write(Data); }
+};
+
+// Short runs of random bytes, so the data compresses roughly like typical asset data.
+static auto MakeBlob(uint64_t size) -> BlobObject
 {
-	std::cout << "GFS Benchmark" << std::endl;
+	BlobObject blob{};
+	blob.Data.resize(size);
+	for (uint64_t i = 0; i < size;)
+	{
+		const auto value = uint8_t(sIntDist(sRandGen));
+		const auto runLength = std::min<uint64_t>(1 + sIntDist(sRandGen) % 4, size - i);
+		std::fill_n(blob.Data.begin() + i, runLength, value);
+		i += runLength;
+	}
+	return blob;
+}
+
+static auto GetBlobFileSize(uint64_t blobSize) -> uint64_t
+{
+	return blobSize + sizeof(uint64_t); // Element count.
+}
+
+static void RunSerializationBenchmarks(BenchmarkSuite& suite)
+{
+	const auto quick = suite.GetOptions().Quick;
+	const auto iterations = quick ? 5u : 20u;
+	const auto dataSize = uint64_t(sizeof(DataObject)) * TEST_DATA_COUNT;
 
-	std::cout << "Generating test data..." << std::endl;
 	std::vector<DataObject> testData(TEST_DATA_COUNT);
-	std::cout << "Data Size = " << sizeof(DataObject) * TEST_DATA_COUNT << "bytes" << std::endl;
-	std::cout << "Loop Count = " << TEST_LOOP_COUNT << std::endl;
 
-	uint32_t duration = 0;
+	// Baselines without gfs.
+	suite.Run({ "ofstream_write", { { "variant", "per_element" } }, iterations, dataSize, TEST_DATA_COUNT }, [&](uint32_t) {
+		std::ofstream stream("tmp.bin", std::ios::binary);
+		for (const auto& value : testData)
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	});
+	suite.Run({ "ofstream_write", { { "variant", "bulk" } }, iterations, dataSize, TEST_DATA_COUNT }, [&](uint32_t) {
+		std::ofstream stream("tmp.bin", std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(testData.data()), std::streamsize(dataSize));
+	});
+	std::error_code error;
+	std::filesystem::remove("tmp.bin", error);
 
-	duration = Benchmark(TEST_LOOP_COUNT, [testData]() {
-		std::ofstream tmpStream(TEST_TMP_FILE_NAME, std::ios::binary);
+	suite.Run({ "serialize_write", { { "variant", "per_element" } }, iterations, dataSize, TEST_DATA_COUNT }, [&](uint32_t) {
+		gfs::WriteOnlyByteBuffer buffer(dataSize + sizeof(uint64_t));
+		buffer.Write(uint64_t(testData.size()));
 		for (const auto& value : testData)
-		{
-			tmpStream.write(reinterpret_cast<const char*>(&value), sizeof(value));
-		}
+			buffer.Write(value);
+		DoNotOptimize(buffer.GetSize());
+	});
+	suite.Run({ "serialize_write", { { "variant", "bulk" } }, iterations, dataSize, TEST_DATA_COUNT }, [&](uint32_t) {
+		gfs::WriteOnlyByteBuffer buffer(dataSize + sizeof(uint64_t));
+		buffer.Write(testData);
+		DoNotOptimize(buffer.GetSize());
 	});
-	std::cout << "Write straight to file (iterate each value): " << duration << "ms" << std::endl;
 
-	duration = Benchmark(TEST_LOOP_COUNT, [testData]() {
-		std::ofstream tmpStream(TEST_TMP_FILE_NAME, std::ios::binary);
-		tmpStream.write(reinterpret_cast<const char*>(testData.data()), sizeof(DataObject) * testData.size());
+	std::vector<StreamedDataObject> streamedTestData(TEST_DATA_COUNT);
+	suite.Run({ "serialize_write", { { "variant", "hand_written" } }, iterations, dataSize, TEST_DATA_COUNT }, [&](uint32_t) {
+		gfs::WriteOnlyByteBuffer buffer(dataSize * 2);
+		for (const auto& value : streamedTestData)
+			value.Write(buffer);
+		DoNotOptimize(buffer.GetSize());
 	});
-	std::cout << "Write straight to file (write whole vector assuming simple POD type): " << duration << "ms" << std::endl;
 
-	duration = Benchmark(TEST_LOOP_COUNT, [testData]() {
-		std::vector<uint8_t> binaryData;
-		for (const auto& value : testData)
+	std::vector<FieldDataObject> fieldTestData(TEST_DATA_COUNT);
+	suite.Run({ "serialize_write", { { "variant", "field_list" } }, iterations, dataSize, TEST_DATA_COUNT }, [&](uint32_t) {
+		gfs::WriteOnlyByteBuffer buffer(dataSize * 2);
+		for (const auto& value : fieldTestData)
+			value.Write(buffer);
+		DoNotOptimize(buffer.GetSize());
+	});
+
+	gfs::WriteOnlyByteBuffer serializedTestData;
+	serializedTestData.Write(testData);
+
+	// Each read gets a fresh copy of the serialized data (untimed), as if it had just been read from disk.
+	std::unique_ptr<gfs::ReadOnlyByteBuffer> readBuffer;
+	auto copySerializedTestData = [&](uint32_t) {
+		readBuffer = std::make_unique<gfs::ReadOnlyByteBuffer>(serializedTestData.GetSize());
+		std::memcpy(readBuffer->GetData(), serializedTestData.GetData(), serializedTestData.GetSize());
+	};
+
+	suite.Run(
+		{ "serialize_read", { { "variant", "per_element" } }, iterations, dataSize, TEST_DATA_COUNT },
+		[&](uint32_t) {
+			uint64_t count = 0;
+			readBuffer->Read(count);
+			readBuffer->AlignPosition(alignof(PlainDataObject));
+			std::vector<PlainDataObject> values;
+			values.reserve(count);
+			for (uint64_t i = 0; i < count; ++i)
+				readBuffer->Read(values.emplace_back());
+			DoNotOptimize(values.back().ints[0]);
+		},
+		copySerializedTestData);
+	suite.Run(
+		{ "serialize_read", { { "variant", "bulk" } }, iterations, dataSize, TEST_DATA_COUNT },
+		[&](uint32_t) {
+			std::vector<PlainDataObject> values;
+			readBuffer->Read(values);
+			DoNotOptimize(values.back().ints[0]);
+		},
+		copySerializedTestData);
+	suite.Run(
+		{ "serialize_read", { { "variant", "view" } }, iterations, dataSize, TEST_DATA_COUNT },
+		[&](uint32_t) {
+			const auto values = readBuffer->ReadView<PlainDataObject>();
+			DoNotOptimize(values[values.size() - 1].ints[0]);
+		},
+		copySerializedTestData);
+
+	// Index-like data: small values that waste most of their bytes at full width.
+	std::vector<uint32_t> indices(TEST_DATA_COUNT * 8);
+	for (auto& index : indices)
+		index = sIntDist(sRandGen) % 1000;
+	const auto indicesSize = uint64_t(sizeof(uint32_t)) * indices.size();
+
+	gfs::WriteOnlyByteBuffer varIndices;
+	suite.Run({ "varint_write", { { "max_value", "1000" } }, iterations, indicesSize, indices.size() }, [&](uint32_t) {
+		varIndices.SetSize(0);
+		varIndices.SetPosition(0);
+		varIndices.WriteVarArray(indices.data(), indices.size());
+	});
+	if (suite.IsEnabled("varint_write"))
+		std::cout << "  (varint array " << varIndices.GetSize() << " bytes vs " << indicesSize << " bytes)" << std::endl;
+	else
+		varIndices.WriteVarArray(indices.data(), indices.size());
+
+	suite.Run(
+		{ "varint_read", { { "max_value", "1000" } }, iterations, indicesSize, indices.size() },
+		[&](uint32_t) {
+			std::vector<uint32_t> values;
+			readBuffer->ReadVarArray(values);
+			DoNotOptimize(values.back());
+		},
+		[&](uint32_t) {
+			readBuffer = std::make_unique<gfs::ReadOnlyByteBuffer>(varIndices.GetSize());
+			std::memcpy(readBuffer->GetData(), varIndices.GetData(), varIndices.GetSize());
+		});
+}
+
+static void RunFileBenchmarks(BenchmarkSuite& suite, const std::filesystem::path& workDir)
+{
+	const bool writeEnabled = suite.IsEnabled("write_file");
+	const bool readEnabled = suite.IsEnabled("read_file") || suite.IsEnabled("read_file_uncached") || suite.IsEnabled("read_file_shared");
+	const bool batchEnabled = suite.IsEnabled("write_file_batch");
+	if (!writeEnabled && !readEnabled && !batchEnabled)
+		return;
+
+	const auto quick = suite.GetOptions().Quick;
+	const auto mountDir = workDir / "files";
+	std::filesystem::create_directories(mountDir);
+
+	gfs::Filesystem fs;
+	const auto mountId = fs.MountDir(mountDir);
+	const auto memoryMountId = fs.MountMemory(); // Same files without disk I/O.
+
+	// Compression is only applied from `FS_COMPRESS_MIN_FILE_SIZE_BYTES`, so small files are stored raw either way.
+	auto sizes = quick ? std::vector<uint64_t>{ 4096, 1024 * 1024 } : std::vector<uint64_t>{ 4096, 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+	if (!writeEnabled && !readEnabled)
+		sizes.clear();
+
+	gfs::FileID nextFileId = 1000;
+	for (const auto size : sizes)
+	{
+		const auto blob = MakeBlob(size);
+		const auto iterations = uint32_t(std::clamp<uint64_t>((quick ? 16 : 64) * 1024 * 1024 / size, FILE_ROTATION_COUNT, quick ? 50 : 200));
+		for (const auto compress : { false, true })
+		{
+			for (const auto inMemory : { false, true })
+			{
+				const BenchmarkSuite::Params params{ { "size", BenchmarkSuite::FormatBytes(size) },
+					{ "compress", compress ? "1" : "0" },
+					{ "mount", inMemory ? "memory" : "dir" } };
+				const auto firstFileId = nextFileId;
+				nextFileId += FILE_ROTATION_COUNT;
+
+				const auto writeFile = [&](uint32_t iteration) {
+					const auto rotation = iteration % FILE_ROTATION_COUNT;
+					const auto filename = "file_" + params[0].second + "_" + params[1].second + "_" + std::to_string(rotation) + ".rbin";
+					if (!fs.WriteFile(inMemory ? memoryMountId : mountId, filename, firstFileId + rotation, {}, blob, compress))
+						std::cerr << "Failed to write " << filename << std::endl;
+				};
+
+				// Reads need the files, so they are written even when only reads are benchmarked.
+				if (writeEnabled)
+					suite.Run({ "write_file", params, iterations, GetBlobFileSize(size) }, writeFile);
+				else
+				{
+					for (uint32_t i = 0; i < FILE_ROTATION_COUNT; ++i)
+						writeFile(i);
+				}
+
+				BlobObject readBlob{};
+				suite.Run({ "read_file", params, iterations, GetBlobFileSize(size) }, [&](uint32_t iteration) {
+					if (!fs.ReadFile(firstFileId + iteration % FILE_ROTATION_COUNT, readBlob))
+						std::cerr << "Failed to read file." << std::endl;
+					DoNotOptimize(readBlob.Data.size());
+				});
+
+				if (!inMemory)
+				{
+					suite.Run({ "read_file_uncached", params, iterations, GetBlobFileSize(size) }, [&](uint32_t iteration) {
+						if (!fs.ReadFile(firstFileId + iteration % FILE_ROTATION_COUNT, readBlob, gfs::ReadMode::Uncached))
+							std::cerr << "Failed to read file." << std::endl;
+						DoNotOptimize(readBlob.Data.size());
+					});
+				}
+
+				if (!inMemory && suite.IsEnabled("read_file_shared"))
+				{
+					// As another process on the host would see it, once the files are in the shared cache.
+					gfs::Filesystem::RemoveSharedCache(BENCHMARK_SHARED_CACHE_NAME);
+					gfs::Filesystem sharedFs;
+					sharedFs.MountDir(mountDir);
+					if (!sharedFs.EnableSharedCache(BENCHMARK_SHARED_CACHE_NAME, (size + 4096) * FILE_ROTATION_COUNT))
+						std::cerr << "Failed to create the shared cache." << std::endl;
+					for (uint32_t i = 0; i < FILE_ROTATION_COUNT; ++i)
+						sharedFs.ReadFile(firstFileId + i, readBlob);
+
+					suite.Run({ "read_file_shared", params, iterations, GetBlobFileSize(size) }, [&](uint32_t iteration) {
+						if (!sharedFs.ReadFile(firstFileId + iteration % FILE_ROTATION_COUNT, readBlob))
+							std::cerr << "Failed to read file." << std::endl;
+						DoNotOptimize(readBlob.Data.size());
+					});
+					gfs::Filesystem::RemoveSharedCache(BENCHMARK_SHARED_CACHE_NAME);
+				}
+			}
+		}
+	}
+
+	if (!batchEnabled)
+		return;
+
+	// Many small files, as when importing. Durable writes outside of a batch flush every file.
+	const auto batchFileCount = quick ? 32u : 128u;
+	const auto smallBlob = MakeBlob(4096);
+	for (const auto durable : { false, true })
+	{
+		for (const auto batched : { false, true })
 		{
-			const auto i = binaryData.size();
-			binaryData.resize(binaryData.size() + sizeof(DataObject));
-			std::memcpy(&binaryData[i], &value, sizeof(DataObject));
+			fs.SetDurableWrites(durable);
+			const BenchmarkSuite::Params params{ { "files", std::to_string(batchFileCount) }, { "durable", durable ? "1" : "0" }, { "batched", batched ? "1" : "0" } };
+			suite.Run({ "write_file_batch", params, quick ? 2u : 5u, GetBlobFileSize(4096) * batchFileCount, batchFileCount }, [&](uint32_t) {
+				if (batched)
+					fs.BeginWriteBatch();
+				for (uint32_t i = 0; i < batchFileCount; ++i)
+					fs.WriteFile(mountId, "batch_" + std::to_string(i) + ".rbin", 50000 + i, {}, smallBlob, false);
+				if (batched)
+					fs.EndWriteBatch();
+			});
 		}
-		std::ofstream tmpStream(TEST_TMP_FILE_NAME, std::ios::binary);
-		tmpStream.write(reinterpret_cast<const char*>(binaryData.data()), binaryData.size());
-	});
-	std::cout << "Vector buffer: " << duration << "ms" << std::endl;
+	}
+	fs.SetDurableWrites(false);
+}
 
-	duration = Benchmark(TEST_LOOP_COUNT, [testData]() {
-		std::vector<uint8_t> binaryData;
-		binaryData.reserve(sizeof(DataObject) * TEST_DATA_COUNT);
-		for (const auto& value : testData)
+static void RunArchiveBenchmarks(BenchmarkSuite& suite, const std::filesystem::path& workDir)
+{
+	if (!suite.IsEnabled("create_archive"))
+		return;
+
+	const auto quick = suite.GetOptions().Quick;
+	const auto mountDir = workDir / "archives";
+	std::filesystem::create_directories(mountDir);
+
+	gfs::Filesystem fs;
+	const auto mountId = fs.MountDir(mountDir);
+
+	constexpr uint64_t FileSize = 16 * 1024;
+	const auto blob = MakeBlob(FileSize);
+	for (const auto fileCount : { 16u, 256u })
+	{
+		std::vector<gfs::FileID> fileIds;
+		for (uint32_t i = 0; i < fileCount; ++i)
+		{
+			const auto fileId = gfs::FileID(fileCount) * 100000 + i;
+			fs.WriteFile(mountId, "src_" + std::to_string(fileId) + ".rbin", fileId, {}, blob, false);
+			fileIds.push_back(fileId);
+		}
+
+		const auto archiveName = "archive_" + std::to_string(fileCount) + ".pbin";
+		const BenchmarkSuite::Params params{ { "files", std::to_string(fileCount) }, { "file_size", BenchmarkSuite::FormatBytes(FileSize) } };
+		suite.Run({ "create_archive", params, quick ? 3u : 10u, GetBlobFileSize(FileSize) * fileCount, fileCount }, [&](uint32_t) {
+			if (!fs.CreateArchive(mountId, archiveName, fileIds))
+				std::cerr << "Failed to create " << archiveName << std::endl;
+		});
+	}
+}
+
+static void RunMountBenchmarks(BenchmarkSuite& suite, const std::filesystem::path& workDir)
+{
+	if (!suite.IsEnabled("mount_scan") && !suite.IsEnabled("find_file") && !suite.IsEnabled("for_each_file"))
+		return;
+
+	const auto quick = suite.GetOptions().Quick;
+	const auto blob = MakeBlob(256);
+	const auto fileCounts = quick ? std::vector<uint32_t>{ 100, 1000 } : std::vector<uint32_t>{ 100, 1000, 10000 };
+	for (const auto fileCount : fileCounts)
+	{
+		const auto getFilename = [](uint32_t i) { return "dir_" + std::to_string(i % 16) + "/file_" + std::to_string(i) + ".rbin"; };
+
+		const auto mountDir = workDir / ("mount_" + std::to_string(fileCount));
+		for (uint32_t i = 0; i < 16; ++i)
+			std::filesystem::create_directories(mountDir / ("dir_" + std::to_string(i)));
+		{
+			gfs::Filesystem fs;
+			fs.SetMountIndexEnabled(false);
+			const auto mountId = fs.MountDir(mountDir);
+			fs.BeginWriteBatch();
+			for (uint32_t i = 0; i < fileCount; ++i)
+				fs.WriteFile(mountId, getFilename(i), gfs::FileID(fileCount) * 100000 + i, {}, blob, false);
+			fs.EndWriteBatch();
+		}
+
+		std::unique_ptr<gfs::Filesystem> fs;
+		for (const auto index : { false, true })
+		{
+			// The first mount with the index enabled writes it, later mounts use it.
+			const BenchmarkSuite::Params params{ { "files", std::to_string(fileCount) }, { "index", index ? "1" : "0" } };
+			suite.Run(
+				{ "mount_scan", params, quick ? 3u : 10u, 0, fileCount },
+				[&](uint32_t) { fs->MountDir(mountDir); },
+				[&](uint32_t) {
+					fs = std::make_unique<gfs::Filesystem>();
+					fs->SetMountIndexEnabled(index);
+				});
+		}
+
+		if (!fs)
 		{
-			const auto i = binaryData.size();
-			binaryData.resize(binaryData.size() + sizeof(DataObject));
-			std::memcpy(&binaryData[i], &value, sizeof(DataObject));
+			fs = std::make_unique<gfs::Filesystem>();
+			fs->MountDir(mountDir);
 		}
-		std::ofstream tmpStream(TEST_TMP_FILE_NAME, std::ios::binary);
-		tmpStream.write(reinterpret_cast<const char*>(binaryData.data()), binaryData.size());
+
+		std::vector<std::filesystem::path> paths;
+		for (uint32_t i = 0; i < fileCount; ++i)
+			paths.emplace_back(getFilename(i));
+		std::shuffle(paths.begin(), paths.end(), sRandGen);
+
+		suite.Run({ "find_file", { { "files", std::to_string(fileCount) } }, quick ? 3u : 10u, 0, fileCount }, [&](uint32_t) {
+			for (const auto& path : paths)
+				DoNotOptimize(fs->FindFile(path));
+		});
+		suite.Run({ "for_each_file", { { "files", std::to_string(fileCount) } }, quick ? 3u : 10u, 0, fileCount }, [&](uint32_t) {
+			fs->ForEachFile([](const gfs::File& file) { DoNotOptimize(file.UncompressedSize); });
+		});
+	}
+}
+
+static void RunInterleavedBenchmarks(BenchmarkSuite& suite)
+{
+	if (!suite.IsEnabled("write_read_interleaved"))
+		return;
+
+	// Every read after a write sees a new registry version, as when importing or hot reloading while the game runs.
+	// In-memory, so the cost is the registry rather than disk I/O.
+	const auto quick = suite.GetOptions().Quick;
+	const auto blob = MakeBlob(256);
+	const auto fileCounts = quick ? std::vector<uint32_t>{ 1000, 16000 } : std::vector<uint32_t>{ 1000, 16000, 128000 };
+	constexpr uint32_t OpCount = 256;
+	for (const auto fileCount : fileCounts)
+	{
+		gfs::Filesystem fs;
+		const auto mountId = fs.MountMemory();
+		const auto getFilename = [](uint32_t i) { return "dir_" + std::to_string(i % 16) + "/file_" + std::to_string(i) + ".rbin"; };
+		fs.BeginWriteBatch();
+		for (uint32_t i = 0; i < fileCount; ++i)
+			fs.WriteFile(mountId, getFilename(i), i + 1, {}, blob, false);
+		fs.EndWriteBatch();
+
+		suite.Run({ "write_read_interleaved", { { "files", std::to_string(fileCount) } }, quick ? 3u : 10u, 0, OpCount }, [&](uint32_t iteration) {
+			for (uint32_t op = 0; op < OpCount; ++op)
+			{
+				const auto i = (iteration * OpCount + op) % fileCount;
+				if (!fs.WriteFile(mountId, getFilename(i), i + 1, {}, blob, false))
+					std::cerr << "Failed to write " << getFilename(i) << std::endl;
+				DoNotOptimize(fs.FindFile(getFilename((i * 7919) % fileCount)));
+			}
+		});
+	}
+}
+
+static void RunRegistryBenchmarks(BenchmarkSuite& suite)
+{
+	if (!suite.IsEnabled("registry"))
+		return;
+
+	const auto quick = suite.GetOptions().Quick;
+	const auto fileCount = quick ? 100000u : 1000000u;
+	const auto iterations = quick ? 3u : 10u;
+
+	std::vector<gfs::File> registryFiles(fileCount);
+	for (auto i = 0u; i < fileCount; ++i)
+	{
+		auto& file = registryFiles[i];
+		file.FileId = (uint64_t(sIntDist(sRandGen)) << 32) | i;
+		file.MountId = 1;
+		file.MountRelPath = "data/file_" + std::to_string(i) + ".rbin";
+		file.SourceFilename = "source/file_" + std::to_string(i % 1000) + ".txt";
+		file.UncompressedSize = sIntDist(sRandGen) % 4096;
+		file.CompressedSize = file.UncompressedSize;
+		file.Offset = 64;
+	}
+
+	std::vector<gfs::FileID> lookupIds(fileCount);
+	for (auto i = 0u; i < fileCount; ++i)
+		lookupIds[i] = registryFiles[i].FileId;
+	std::shuffle(lookupIds.begin(), lookupIds.end(), sRandGen);
+
+	std::unordered_map<gfs::FileID, gfs::File> fileMap;
+	for (const auto& file : registryFiles)
+		fileMap[file.FileId] = file;
+
+	gfs::FileRegistry registry;
+	registry.Reserve(fileCount);
+	for (const auto& file : registryFiles)
+		registry.Insert(file);
+
+	const auto params = [&](const char* container) -> BenchmarkSuite::Params {
+		return { { "files", std::to_string(fileCount) }, { "container", container } };
+	};
+
+	suite.Run({ "registry_lookup", params("unordered_map"), iterations, 0, fileCount }, [&](uint32_t) {
+		for (auto id : lookupIds)
+			DoNotOptimize(fileMap.find(id)->second.UncompressedSize);
 	});
-	std::cout << "Vector buffer (Preallocated): " << duration << "ms" << std::endl;
+	suite.Run({ "registry_lookup", params("file_registry"), iterations, 0, fileCount }, [&](uint32_t) {
+		for (auto id : lookupIds)
+			DoNotOptimize(registry.GetUncompressedSize(registry.Find(id)));
+	});
+	suite.Run({ "registry_iteration", params("unordered_map"), iterations, 0, fileCount }, [&](uint32_t) {
+		uint64_t checksum = 0;
+		for (const auto& [id, file] : fileMap)
+			checksum += file.UncompressedSize;
+		DoNotOptimize(checksum);
+	});
+	suite.Run({ "registry_iteration", params("file_registry"), iterations, 0, fileCount }, [&](uint32_t) {
+		uint64_t checksum = 0;
+		for (auto index = 0u; index < registry.GetCount(); ++index)
+			checksum += registry.GetUncompressedSize(index);
+		DoNotOptimize(checksum);
+	});
+}
+
+static void PrintUsage()
+{
+	std::cout << "Usage: benchmark [--quick] [--filter <name>] [--json <file|->] [--dir <work dir>]" << std::endl;
+	std::cout << "  --quick   Smaller data sets & fewer iterations." << std::endl;
+	std::cout << "  --filter  Only run cases whose name contains <name> (eg. read_file, registry)." << std::endl;
+	std::cout << "  --json    Also write results (latency percentiles & throughput) as JSON. '-' writes to stdout." << std::endl;
+	std::cout << "  --dir     Directory for files written by the benchmarks, removed afterwards. Default: gfs_benchmark_data" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite::Options options{};
+	std::filesystem::path workDir = "gfs_benchmark_data";
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--quick")
+			options.Quick = true;
+		else if (arg == "--filter" && hasValue)
+			options.Filter = argv[++i];
+		else if (arg == "--json" && hasValue)
+			options.JsonFilename = argv[++i];
+		else if (arg == "--dir" && hasValue)
+			workDir = argv[++i];
+		else
+		{
+			PrintUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	std::cout << "GFS Benchmark" << (options.Quick ? " (quick)" : "") << std::endl;
 
-	return 0;
-}
\ No newline at end of file
+	std::error_code error;
+	std::filesystem::remove_all(workDir, error);
+	std::filesystem::create_directories(workDir);
+
+	BenchmarkSuite suite(options);
+	RunSerializationBenchmarks(suite);
+	RunFileBenchmarks(suite, workDir);
+	RunArchiveBenchmarks(suite, workDir);
+	RunMountBenchmarks(suite, workDir);
+	RunInterleavedBenchmarks(suite);
+	RunRegistryBenchmarks(suite);
+
+	std::filesystem::remove_all(workDir, error);
+
+	return suite.Finish() ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include "benchmark_suite.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+	std::atomic<uint64_t> sSink = 0;
+
+	// Nearest-rank percentile of sorted samples.
+	auto Percentile(const std::vector<double>& sortedSamples, double percentile) -> double
+	{
+		const auto rank = size_t(std::ceil(percentile / 100.0 * double(sortedSamples.size())));
+		return sortedSamples[std::clamp<size_t>(rank, 1, sortedSamples.size()) - 1];
+	}
+
+	auto FormatDuration(double ns) -> std::string
+	{
+		char buffer[32];
+		if (ns < 1000.0)
+			std::snprintf(buffer, sizeof(buffer), "%.0fns", ns);
+		else if (ns < 1000000.0)
+			std::snprintf(buffer, sizeof(buffer), "%.1fus", ns / 1000.0);
+		else
+			std::snprintf(buffer, sizeof(buffer), "%.2fms", ns / 1000000.0);
+		return buffer;
+	}
+
+	auto EscapeJson(const std::string& str) -> std::string
+	{
+		std::string escaped;
+		for (const auto c : str)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+} // namespace
+
+void DoNotOptimize(uint64_t value)
+{
+	sSink.fetch_add(value, std::memory_order_relaxed);
+}
+
+BenchmarkSuite::BenchmarkSuite(Options options)
+	: m_options(std::move(options))
+{
+}
+
+bool BenchmarkSuite::IsEnabled(const std::string& name) const
+{
+	return m_options.Filter.empty() || name.find(m_options.Filter) != std::string::npos;
+}
+
+void BenchmarkSuite::Run(const Case& benchmarkCase, const std::function<void(uint32_t iteration)>& func, const std::function<void(uint32_t iteration)>& setup)
+{
+	using clock = std::chrono::steady_clock;
+
+	if (!IsEnabled(benchmarkCase.Name))
+		return;
+
+	std::vector<double> samples;
+	samples.reserve(benchmarkCase.Iterations);
+	for (uint32_t i = 0; i < benchmarkCase.Iterations; ++i)
+	{
+		if (setup)
+			setup(i);
+
+		const auto start = clock::now();
+		func(i);
+		const auto end = clock::now();
+		samples.push_back(double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	Result result{};
+	result.Info = benchmarkCase;
+	result.TotalNs = std::accumulate(samples.begin(), samples.end(), 0.0);
+	result.MeanNs = result.TotalNs / double(samples.size());
+	result.MinNs = samples.front();
+	result.P50Ns = Percentile(samples, 50.0);
+	result.P90Ns = Percentile(samples, 90.0);
+	result.P99Ns = Percentile(samples, 99.0);
+	result.MaxNs = samples.back();
+
+	PrintResult(result);
+	m_results.push_back(std::move(result));
+}
+
+bool BenchmarkSuite::Finish() const
+{
+	if (m_options.JsonFilename.empty())
+		return true;
+
+	if (m_options.JsonFilename == "-")
+	{
+		WriteJson(std::cout);
+		return true;
+	}
+
+	std::ofstream stream(m_options.JsonFilename);
+	WriteJson(stream);
+	return bool(stream);
+}
+
+auto BenchmarkSuite::FormatBytes(uint64_t bytes) -> std::string
+{
+	if (bytes >= 1024 * 1024 && bytes % (1024 * 1024) == 0)
+		return std::to_string(bytes / (1024 * 1024)) + "MB";
+	if (bytes >= 1024 && bytes % 1024 == 0)
+		return std::to_string(bytes / 1024) + "KB";
+	return std::to_string(bytes) + "B";
+}
+
+void BenchmarkSuite::PrintResult(const Result& result) const
+{
+	std::ostringstream name;
+	name << result.Info.Name;
+	if (!result.Info.Parameters.empty())
+	{
+		name << " [";
+		for (size_t i = 0; i < result.Info.Parameters.size(); ++i)
+			name << (i == 0 ? "" : ", ") << result.Info.Parameters[i].first << "=" << result.Info.Parameters[i].second;
+		name << "]";
+	}
+
+	const auto totalSeconds = std::max(result.TotalNs, 1.0) / 1e9;
+	const auto iterations = double(result.Info.Iterations);
+
+	char line[256];
+	std::snprintf(line,
+		sizeof(line),
+		"%-60s x%-5u p50 %-9s p90 %-9s p99 %-9s",
+		name.str().c_str(),
+		result.Info.Iterations,
+		FormatDuration(result.P50Ns).c_str(),
+		FormatDuration(result.P90Ns).c_str(),
+		FormatDuration(result.P99Ns).c_str());
+	std::cout << line;
+
+	if (result.Info.BytesPerIteration != 0)
+	{
+		std::snprintf(line, sizeof(line), " %9.1f MB/s", double(result.Info.BytesPerIteration) * iterations / totalSeconds / (1024.0 * 1024.0));
+		std::cout << line;
+	}
+	if (result.Info.OpsPerIteration > 1)
+	{
+		const auto opsPerSecond = double(result.Info.OpsPerIteration) * iterations / totalSeconds;
+		if (opsPerSecond >= 1e6)
+			std::snprintf(line, sizeof(line), " %9.2fM ops/s", opsPerSecond / 1e6);
+		else if (opsPerSecond >= 1e3)
+			std::snprintf(line, sizeof(line), " %9.2fk ops/s", opsPerSecond / 1e3);
+		else
+			std::snprintf(line, sizeof(line), " %9.0f ops/s", opsPerSecond);
+		std::cout << line;
+	}
+	std::cout << std::endl;
+}
+
+void BenchmarkSuite::WriteJson(std::ostream& stream) const
+{
+	stream << "{\n  \"results\": [";
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const auto& result = m_results[i];
+		const auto totalSeconds = std::max(result.TotalNs, 1.0) / 1e9;
+		const auto iterations = double(result.Info.Iterations);
+
+		stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << EscapeJson(result.Info.Name) << "\", \"params\": {";
+		for (size_t p = 0; p < result.Info.Parameters.size(); ++p)
+		{
+			const auto& [key, value] = result.Info.Parameters[p];
+			stream << (p == 0 ? "" : ", ") << "\"" << EscapeJson(key) << "\": \"" << EscapeJson(value) << "\"";
+		}
+		stream << "}, \"iterations\": " << result.Info.Iterations;
+		stream << ", \"mean_ns\": " << uint64_t(result.MeanNs) << ", \"min_ns\": " << uint64_t(result.MinNs);
+		stream << ", \"p50_ns\": " << uint64_t(result.P50Ns) << ", \"p90_ns\": " << uint64_t(result.P90Ns);
+		stream << ", \"p99_ns\": " << uint64_t(result.P99Ns) << ", \"max_ns\": " << uint64_t(result.MaxNs);
+		stream << ", \"bytes_per_sec\": " << uint64_t(double(result.Info.BytesPerIteration) * iterations / totalSeconds);
+		stream << ", \"ops_per_sec\": " << uint64_t(double(result.Info.OpsPerIteration) * iterations / totalSeconds) << "}";
+	}
+	stream << "\n  ]\n}" << std::endl;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Runs benchmark cases, timing every iteration separately so latency percentiles can be reported alongside throughput.
+ */
+class BenchmarkSuite
+{
+public:
+	using Params = std::vector<std::pair<std::string, std::string>>;
+
+	struct Options
+	{
+		std::string Filter;		  // Only cases whose name contains this are run.
+		std::string JsonFilename; // Results are also written here as JSON ("-" for stdout).
+		bool Quick = false;		  // Smaller data sets & fewer iterations, eg. For CI.
+	};
+
+	struct Case
+	{
+		std::string Name;
+		Params Parameters;
+		uint32_t Iterations = 1;
+		uint64_t BytesPerIteration = 0; // For throughput. 0 if not meaningful.
+		uint64_t OpsPerIteration = 1;
+	};
+
+	struct Result
+	{
+		Case Info;
+		double TotalNs;
+		double MeanNs;
+		double MinNs;
+		double P50Ns;
+		double P90Ns;
+		double P99Ns;
+		double MaxNs;
+	};
+
+	explicit BenchmarkSuite(Options options);
+
+	auto GetOptions() const -> const Options& { return m_options; }
+
+	bool IsEnabled(const std::string& name) const;
+
+	/**
+	 * @brief Runs `func` once per iteration.
+	 * @param benchmarkCase
+	 * @param func Timed. Receives the iteration index.
+	 * @param setup Optional. Runs before each iteration & is not timed.
+	 */
+	void Run(const Case& benchmarkCase, const std::function<void(uint32_t iteration)>& func, const std::function<void(uint32_t iteration)>& setup = {});
+
+	/**
+	 * @brief Writes the results as JSON if requested.
+	 * @return False if the JSON file could not be written.
+	 */
+	bool Finish() const;
+
+	static auto FormatBytes(uint64_t bytes) -> std::string;
+
+private:
+	void PrintResult(const Result& result) const;
+	void WriteJson(std::ostream& stream) const;
+
+private:
+	Options m_options;
+	std::vector<Result> m_results;
+};
+
+/**
+ * Keeps results of benchmarked code alive so the optimizer cannot remove it.
+ */
+void DoNotOptimize(uint64_t value);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "file_registry.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace gfs
+{
+	enum class AccessType : uint8_t
+	{
+		Read,
+		Write,
+	};
+
+	/**
+	 * A `ReadFile()`/`WriteFile()` call recorded by `Filesystem::StartAccessTrace()`.
+	 */
+	struct AccessTraceEvent
+	{
+		uint64_t TimestampNs; // Start of the call, relative to the start of the recording.
+		uint64_t DurationNs;
+		FileID FileId;
+		uint64_t Size;		  // Uncompressed size of the file data. 0 if the call failed before it was known.
+		uint32_t ThreadIndex; // Identifies the calling thread within the trace.
+		AccessType Type;
+		bool Succeeded;
+	};
+
+	/**
+	 * @brief Reads a trace written by `Filesystem::StartAccessTrace()`. Events are sorted by timestamp.
+	 * A trace cut short (eg. By a crash) is read up to its last complete event.
+	 * @param filename
+	 * @param outEvents
+	 * @return False if the file could not be read or is not a trace.
+	 */
+	bool ReadAccessTrace(const std::filesystem::path& filename, std::vector<AccessTraceEvent>& outEvents);
+
+} // namespace gfs
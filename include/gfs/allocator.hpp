@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace gfs
+{
+	// What an allocation is used for, so usage can be reported & budgeted separately.
+	enum class MemoryCategory : uint8_t
+	{
+		General,
+		FileData,	 // File payloads being read or written.
+		Compression, // Compressed copies of payloads.
+		Registry,	 // File registry arrays.
+		Count,
+	};
+
+	auto GetMemoryCategoryName(MemoryCategory category) -> const char*;
+
+	/**
+	 * Memory source for the filesystem & byte buffers. Implementations must be thread-safe as files are read & written
+	 * from worker threads.
+	 */
+	class Allocator
+	{
+	public:
+		virtual ~Allocator() = default;
+
+		/**
+		 * @brief
+		 * @param size
+		 * @param alignment Power of 2.
+		 * @param category
+		 * @return nullptr if the allocation could not be made (eg. The budget is exhausted).
+		 */
+		virtual auto Allocate(size_t size, size_t alignment, MemoryCategory category) -> void* = 0;
+
+		/**
+		 * @brief Frees an allocation. `size`, `alignment` & `category` are the values it was allocated with.
+		 */
+		virtual void Deallocate(void* ptr, size_t size, size_t alignment, MemoryCategory category) = 0;
+	};
+
+	/**
+	 * The global heap.
+	 */
+	class DefaultAllocator : public Allocator
+	{
+	public:
+		auto Allocate(size_t size, size_t alignment, MemoryCategory category) -> void* override;
+		void Deallocate(void* ptr, size_t size, size_t alignment, MemoryCategory category) override;
+	};
+
+	/**
+	 * @brief The allocator used when none is given.
+	 * @return A `DefaultAllocator`.
+	 */
+	auto GetDefaultAllocator() -> Allocator*;
+
+	/**
+	 * Bump allocator over a fixed block, eg. For per-frame or per-level loading. Allocations fail once the block is full.
+	 * Only the most recent allocation is actually freed, so short-lived temporaries (eg. Decompression buffers) do not
+	 * use up the arena. Everything else is released by `Reset()`.
+	 */
+	class ArenaAllocator : public Allocator
+	{
+	public:
+		/**
+		 * @brief
+		 * @param capacity Bytes. Allocated up front from `parent`.
+		 * @param parent Defaults to `GetDefaultAllocator()`.
+		 */
+		explicit ArenaAllocator(size_t capacity, Allocator* parent = nullptr);
+		~ArenaAllocator() override;
+
+		ArenaAllocator(const ArenaAllocator&) = delete;
+		ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+		auto Allocate(size_t size, size_t alignment, MemoryCategory category) -> void* override;
+		void Deallocate(void* ptr, size_t size, size_t alignment, MemoryCategory category) override;
+
+		/**
+		 * @brief Releases every allocation.
+		 * @attention Nothing allocated from the arena may be in use.
+		 */
+		void Reset();
+
+		auto GetUsed() const -> size_t { return m_top.load(std::memory_order_relaxed); }
+		auto GetCapacity() const -> size_t { return m_capacity; }
+
+	private:
+		Allocator* m_parent;
+		uint8_t* m_block;
+		size_t m_capacity;
+		std::atomic<size_t> m_top = 0;
+	};
+
+	struct MemoryUsage
+	{
+		uint64_t CurrentBytes = 0;
+		uint64_t PeakBytes = 0;
+		uint64_t LiveAllocations = 0;
+		uint64_t TotalAllocations = 0;
+		uint64_t FailedAllocations = 0;
+	};
+
+	/**
+	 * Forwards to another allocator & records current & peak usage per category.
+	 */
+	class TrackingAllocator : public Allocator
+	{
+	public:
+		/**
+		 * @brief
+		 * @param parent Defaults to `GetDefaultAllocator()`.
+		 */
+		explicit TrackingAllocator(Allocator* parent = nullptr);
+
+		auto Allocate(size_t size, size_t alignment, MemoryCategory category) -> void* override;
+		void Deallocate(void* ptr, size_t size, size_t alignment, MemoryCategory category) override;
+
+		auto GetUsage(MemoryCategory category) const -> MemoryUsage;
+
+		/**
+		 * @brief Usage across all categories. The peak is of the combined usage, not the sum of the category peaks.
+		 * @return
+		 */
+		auto GetTotalUsage() const -> MemoryUsage;
+
+		/**
+		 * @brief Sets the peaks to the current usage, eg. To measure the peak of a single level load.
+		 */
+		void ResetPeaks();
+
+	private:
+		struct Counters
+		{
+			std::atomic<uint64_t> CurrentBytes = 0;
+			std::atomic<uint64_t> PeakBytes = 0;
+			std::atomic<uint64_t> LiveAllocations = 0;
+			std::atomic<uint64_t> TotalAllocations = 0;
+			std::atomic<uint64_t> FailedAllocations = 0;
+
+			void Add(uint64_t size);
+			void Remove(uint64_t size);
+			auto Snapshot() const -> MemoryUsage;
+		};
+
+	private:
+		Allocator* m_parent;
+		std::array<Counters, size_t(MemoryCategory::Count)> m_categories;
+		Counters m_total;
+	};
+
+	/**
+	 * Standard library allocator adaptor, so containers can allocate from an `Allocator` under a category.
+	 */
+	template<typename T>
+	class StlAllocator
+	{
+	public:
+		using value_type = T;
+
+		StlAllocator() = default;
+		StlAllocator(Allocator* allocator, MemoryCategory category) : m_allocator(allocator), m_category(category) {}
+
+		template<typename U>
+		StlAllocator(const StlAllocator<U>& other) : m_allocator(other.GetAllocator()), m_category(other.GetCategory())
+		{
+		}
+
+		auto allocate(size_t count) -> T*
+		{
+			auto* ptr = GetAllocator()->Allocate(count * sizeof(T), alignof(T), m_category);
+			if (ptr == nullptr)
+				throw std::bad_alloc();
+			return static_cast<T*>(ptr);
+		}
+
+		void deallocate(T* ptr, size_t count) { GetAllocator()->Deallocate(ptr, count * sizeof(T), alignof(T), m_category); }
+
+		auto GetAllocator() const -> Allocator* { return m_allocator != nullptr ? m_allocator : GetDefaultAllocator(); }
+		auto GetCategory() const -> MemoryCategory { return m_category; }
+
+		template<typename U>
+		bool operator==(const StlAllocator<U>& other) const
+		{
+			return GetAllocator() == other.GetAllocator();
+		}
+
+		template<typename U>
+		bool operator!=(const StlAllocator<U>& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		Allocator* m_allocator = nullptr;
+		MemoryCategory m_category = MemoryCategory::General;
+	};
+
+} // namespace gfs
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+
+namespace gfs
+{
+	struct ArchivePatchInfo
+	{
+		uint64_t OldSize = 0;
+		uint64_t NewSize = 0;
+		uint64_t PatchSize = 0;
+		uint64_t CopiedBytes = 0; // Bytes of the new archive copied from the old one.
+		uint64_t AddedBytes = 0;  // Bytes of the new archive stored in the patch, before compression.
+		uint32_t UnchangedEntries = 0;
+		uint32_t ChangedEntries = 0; // Diffed block by block against their previous version.
+		uint32_t AddedEntries = 0;
+		uint32_t RemovedEntries = 0;
+	};
+
+	/**
+	 * @brief Creates a patch that turns one version of an archive into another.
+	 * Entries are matched by file id. Unchanged entries are copied whole, changed entries are diffed block by block against
+	 * their previous version & everything else is stored in the patch, LZ4 compressed. Files that are not gfs files are diffed
+	 * block by block as a whole.
+	 * @param oldArchive
+	 * @param newArchive
+	 * @param patchFilename
+	 * @param outInfo Optional.
+	 * @return
+	 * @attention Both archives are loaded into memory.
+	 */
+	bool CreateArchivePatch(const std::filesystem::path& oldArchive,
+		const std::filesystem::path& newArchive,
+		const std::filesystem::path& patchFilename,
+		ArchivePatchInfo* outInfo = nullptr);
+
+	/**
+	 * @brief Applies a patch to a copy of an archive. The patch is read once from front to back, so it can be streamed (eg.
+	 * While it is downloaded).
+	 * @param archive The archive the patch was created from.
+	 * @param patch
+	 * @param outputArchive Written to a temporary file & renamed into place, so may be `archive`.
+	 * @return False if `archive` is not the version the patch was created from, or the patch is corrupt.
+	 */
+	bool ApplyArchivePatch(const std::filesystem::path& archive, std::istream& patch, const std::filesystem::path& outputArchive);
+
+	/**
+	 * @brief Applies a patch by rewriting the archive in place, so only the changed parts are written & no second copy of the
+	 * archive is needed. Patches order their copies so nothing is overwritten before it has been copied.
+	 * @param archive The archive the patch was created from.
+	 * @param patch Read once from front to back.
+	 * @return False if `archive` is not the version the patch was created from (Left untouched), or the patch is corrupt.
+	 * @attention The archive is left corrupt if this fails part way. Use `ApplyArchivePatch()` when that is unacceptable.
+	 */
+	bool ApplyArchivePatchInPlace(const std::filesystem::path& archive, std::istream& patch);
+
+} // namespace gfs
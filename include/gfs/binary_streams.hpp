@@ -1,5 +1,10 @@
 #pragma once
 
+#include "allocator.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <string>
@@ -10,22 +15,122 @@ namespace gfs
 {
     class BinaryStreamRead;
     class BinaryStreamWrite;
+    struct BinaryStreamable;
+
+    /**
+     * Non-owning view of elements stored inside a `ReadOnlyByteBuffer`. Only valid while the buffer is alive.
+     */
+    template<typename T>
+    struct ArrayView
+    {
+        const T* Data = nullptr;
+        uint64_t Count = 0;
+
+        auto begin() const -> const T* { return Data; }
+        auto end() const -> const T* { return Data + Count; }
+        auto size() const -> uint64_t { return Count; }
+        bool empty() const { return Count == 0; }
+        auto operator[](uint64_t index) const -> const T& { return Data[index]; }
+    };
+
+    // Containers of these types are serialized as an element count, padding up to the type's alignment & a single memcpy.
+    // std::vector<bool> is excluded as it does not store its elements contiguously.
+    template<typename T>
+    constexpr bool is_bulk_serializable_v = std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool>;
+
+    // Maps signed integers to unsigned so small magnitudes stay small as varints (0, -1, 1, -2 -> 0, 1, 2, 3).
+    constexpr auto ZigZagEncode(int64_t value) -> uint64_t { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+    constexpr auto ZigZagDecode(uint64_t value) -> int64_t { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+    // Integer types that can be written as varints. Signed values are zig-zag encoded.
+    template<typename T>
+    constexpr bool is_varint_serializable_v = std::is_integral_v<T> && !std::is_same_v<T, bool>;
 
     class ReadOnlyByteBuffer
     {
     public:
-        ReadOnlyByteBuffer(uint64_t size);
+        /**
+         * @brief
+         * @param size
+         * @param allocator Defaults to `GetDefaultAllocator()`.
+         * @param category
+         * @attention `GetData()` is nullptr if the allocator could not provide the memory.
+         */
+        ReadOnlyByteBuffer(uint64_t size, Allocator* allocator = nullptr, MemoryCategory category = MemoryCategory::General);
+
+        /**
+         * @brief Reads memory owned by someone else in place, without copying it.
+         * @param data Must outlive the buffer. Aligned to `alignof(std::max_align_t)` for `ReadView()` to be aligned.
+         * @param size
+         */
+        ReadOnlyByteBuffer(const void* data, uint64_t size);
         ~ReadOnlyByteBuffer();
 
+        ReadOnlyByteBuffer(const ReadOnlyByteBuffer&) = delete;
+        ReadOnlyByteBuffer& operator=(const ReadOnlyByteBuffer&) = delete;
+
         void Read(uint64_t size, uint8_t* data);
 
         template<typename T>
         void Read(T& value);
 
+        template<typename T>
+        void Read(std::vector<T>& values);
+
+        template<typename T, size_t N>
+        void Read(std::array<T, N>& values);
+
+        /**
+         * @brief Reads an array written by `WriteOnlyByteBuffer::WriteArray()` (or a vector) without copying it.
+         * @return View of the elements inside this buffer.
+         */
+        template<typename T>
+        auto ReadView() -> ArrayView<T>;
+
+        /**
+         * @brief Reads an unsigned LEB128 varint written by `WriteOnlyByteBuffer::WriteVarUInt()`.
+         * @return
+         */
+        auto ReadVarUInt() -> uint64_t;
+        auto ReadVarInt() -> int64_t { return ZigZagDecode(ReadVarUInt()); }
+
+        /**
+         * @brief Reads an array written by `WriteOnlyByteBuffer::WriteVarArray()`.
+         * Runs of 1 & 2 byte varints are decoded 8 & 4 at a time.
+         * @param values
+         */
+        template<typename T>
+        void ReadVarArray(std::vector<T>& values);
+
+        /**
+         * @brief Reads an array written by `WriteOnlyByteBuffer::WriteDeltaArray()`.
+         * Runs of small deltas are decoded 8 at a time.
+         * @param values
+         */
+        template<typename T>
+        void ReadDeltaArray(std::vector<T>& values);
+
+        /**
+         * @brief Skips the padding written by `WriteOnlyByteBuffer::AlignPosition()`.
+         * @param alignment Power of 2.
+         */
+        void AlignPosition(uint64_t alignment);
+
         auto GetSize() const -> auto { return m_size; }
+        auto GetPosition() const -> auto { return m_position; }
         auto GetData() const -> void* { return m_buffer; }
 
     private:
+        // Elements of non bulk serializable containers. Streamable objects read themselves.
+        template<typename T>
+        void ReadElement(T& value);
+
+        // Returns the zig-zag encoded delta. `run` is the number of times the delta repeats after the first value.
+        auto ReadDeltaToken(uint64_t& run) -> uint64_t;
+
+    private:
+        Allocator* m_allocator;
+        MemoryCategory m_category;
         uint8_t* m_buffer;
         uint64_t m_size;
         uint64_t m_position;
@@ -37,15 +142,180 @@ namespace gfs
         Read(sizeof(T), reinterpret_cast<uint8_t*>(&value));
     }
 
+    template<typename T>
+    void ReadOnlyByteBuffer::Read(std::vector<T>& values)
+    {
+        uint64_t count = 0;
+        Read(count);
+        values.resize(count);
+        if constexpr (is_bulk_serializable_v<T>)
+        {
+            AlignPosition(alignof(T));
+            if (count != 0) // Empty vectors may have no storage to copy to.
+                Read(sizeof(T) * count, reinterpret_cast<uint8_t*>(values.data()));
+        }
+        else
+        {
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                T value{};
+                ReadElement(value);
+                values[i] = std::move(value);
+            }
+        }
+    }
+
+    template<typename T, size_t N>
+    void ReadOnlyByteBuffer::Read(std::array<T, N>& values)
+    {
+        // Fixed size, so no count is stored.
+        if constexpr (is_bulk_serializable_v<T>)
+        {
+            Read(sizeof(T) * N, reinterpret_cast<uint8_t*>(values.data()));
+        }
+        else
+        {
+            for (auto& value : values)
+                ReadElement(value);
+        }
+    }
+
+    template<typename T>
+    void ReadOnlyByteBuffer::ReadElement(T& value)
+    {
+        if constexpr (std::is_base_of_v<BinaryStreamable, T>)
+            value.Read(*this);
+        else
+            Read(value);
+    }
+
+    template<typename T>
+    auto ReadOnlyByteBuffer::ReadView() -> ArrayView<T>
+    {
+        static_assert(is_bulk_serializable_v<T>, "Only arrays of trivially copyable types can be viewed in place.");
+
+        uint64_t count = 0;
+        Read(count);
+        AlignPosition(alignof(T));
+
+        // Writers pad elements to their alignment relative to the start of the buffer, which is itself suitably aligned.
+        ArrayView<T> view{ reinterpret_cast<const T*>(m_buffer + m_position), count };
+        m_position += sizeof(T) * count;
+        return view;
+    }
+
+    template<typename T>
+    void ReadOnlyByteBuffer::ReadVarArray(std::vector<T>& values)
+    {
+        static_assert(is_varint_serializable_v<T>, "Only integers can be read as varints.");
+
+        const auto count = ReadVarUInt();
+        values.resize(count);
+
+        // Little-endian hosts only, matching the rest of the format. Each fast path loads 8 bytes & checks the
+        // continuation bits of all of them at once.
+        uint64_t i = 0;
+        while (i < count)
+        {
+            if (m_size - m_position >= sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, m_buffer + m_position, sizeof(word));
+
+                const auto continuationBits = word & 0x8080808080808080ull;
+                if (continuationBits == 0 && count - i >= 8)
+                {
+                    // 8 single byte varints.
+                    for (uint32_t byte = 0; byte < 8; ++byte)
+                        values[i + byte] = T((word >> (byte * 8)) & 0x7F);
+                    i += 8;
+                    m_position += 8;
+                    continue;
+                }
+                if (continuationBits == 0x0080008000800080ull && count - i >= 4)
+                {
+                    // 4 two byte varints.
+                    for (uint32_t pair = 0; pair < 4; ++pair)
+                    {
+                        const auto bits = word >> (pair * 16);
+                        values[i + pair] = T((bits & 0x7F) | ((bits >> 1) & 0x3F80));
+                    }
+                    i += 4;
+                    m_position += 8;
+                    continue;
+                }
+            }
+            values[i++] = T(ReadVarUInt());
+        }
+
+        if constexpr (std::is_signed_v<T>)
+        {
+            for (auto& value : values)
+                value = T(ZigZagDecode(uint64_t(std::make_unsigned_t<T>(value))));
+        }
+    }
+
+    template<typename T>
+    void ReadOnlyByteBuffer::ReadDeltaArray(std::vector<T>& values)
+    {
+        static_assert(is_varint_serializable_v<T>, "Only integers can be delta encoded.");
+
+        const auto count = ReadVarUInt();
+        values.resize(count);
+
+        // Values are accumulated with wrapping 64-bit arithmetic, so signed & unsigned types share one encoding.
+        uint64_t previous = 0;
+        uint64_t i = 0;
+        while (i < count)
+        {
+            if (count - i >= 8 && m_size - m_position >= sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, m_buffer + m_position, sizeof(word));
+
+                // 8 single byte tokens without runs.
+                if ((word & 0x8181818181818181ull) == 0)
+                {
+                    for (uint32_t byte = 0; byte < 8; ++byte)
+                    {
+                        previous += uint64_t(ZigZagDecode((word >> (byte * 8 + 1)) & 0x3F));
+                        values[i + byte] = T(previous);
+                    }
+                    i += 8;
+                    m_position += 8;
+                    continue;
+                }
+            }
+
+            uint64_t run = 0;
+            const auto delta = uint64_t(ZigZagDecode(ReadDeltaToken(run)));
+            for (run += 1; run != 0 && i < count; --run)
+            {
+                previous += delta;
+                values[i++] = T(previous);
+            }
+        }
+    }
+
     template<>
     void ReadOnlyByteBuffer::Read(std::string& value);
 
     class WriteOnlyByteBuffer
     {
     public:
-        WriteOnlyByteBuffer(uint64_t initialCapacity = 1024 * 1024 * 10);
+        /**
+         * @brief
+         * @param initialCapacity
+         * @param allocator Defaults to `GetDefaultAllocator()`.
+         * @param category
+         * @attention Throws `std::bad_alloc` if the allocator cannot provide the memory, as `new[]` would.
+         */
+        WriteOnlyByteBuffer(uint64_t initialCapacity = 1024 * 1024 * 10, Allocator* allocator = nullptr, MemoryCategory category = MemoryCategory::General);
         ~WriteOnlyByteBuffer();
 
+        WriteOnlyByteBuffer(const WriteOnlyByteBuffer&) = delete;
+        WriteOnlyByteBuffer& operator=(const WriteOnlyByteBuffer&) = delete;
+
         void SetCapacity(uint64_t newCapacity);
         void SetSize(uint64_t newSize);
         void SetPosition(uint64_t newPosition);
@@ -55,12 +325,66 @@ namespace gfs
         template<typename T>
         void Write(const T& value);
 
+        template<typename T>
+        void Write(const std::vector<T>& values);
+
+        template<typename T, size_t N>
+        void Write(const std::array<T, N>& values);
+
+        /**
+         * @brief Writes a contiguous array (eg. A span) in the same format as a `std::vector`.
+         * @param data
+         * @param count Number of elements.
+         */
+        template<typename T>
+        void WriteArray(const T* data, uint64_t count);
+
+        /**
+         * @brief Writes an unsigned LEB128 varint: 7 bits per byte, so values below 128 take a single byte.
+         * @param value
+         */
+        void WriteVarUInt(uint64_t value);
+        void WriteVarInt(int64_t value) { WriteVarUInt(ZigZagEncode(value)); }
+
+        /**
+         * @brief Writes a varint count followed by each element as a varint (zig-zag encoded when signed).
+         * @param data
+         * @param count Number of elements.
+         */
+        template<typename T>
+        void WriteVarArray(const T* data, uint64_t count);
+
+        /**
+         * @brief Writes a varint count followed by the differences between consecutive elements. Repeated differences
+         * (eg. Sequential ids or indices) are written once with a repeat count. Suits sorted or slowly changing values.
+         * @param data
+         * @param count Number of elements.
+         */
+        template<typename T>
+        void WriteDeltaArray(const T* data, uint64_t count);
+
+        /**
+         * @brief Writes zero padding until the position is a multiple of the alignment.
+         * @param alignment Power of 2.
+         */
+        void AlignPosition(uint64_t alignment);
+
         auto GetPosition() const -> auto { return m_position; }
         auto GetCapacity() const -> auto { return m_capacity; }
         auto GetSize() const -> auto { return m_size; }
         auto GetData() const -> uint8_t* { return m_buffer; }
 
     private:
+        template<typename T>
+        void WriteElement(const T& value);
+
+        // The token is the zig-zag encoded delta shifted left by one with a run flag in the lowest bit, written as a 65 bit
+        // LEB128 varint. When flagged the run length follows as another varint.
+        void WriteDeltaToken(uint64_t zigzagDelta, uint64_t run);
+
+    private:
+        Allocator* m_allocator;
+        MemoryCategory m_category;
         uint8_t* m_buffer;
         uint64_t m_capacity;
         uint64_t m_size;
@@ -74,6 +398,95 @@ namespace gfs
         Write(sizeof(T), reinterpret_cast<const uint8_t*>(&value));
     }
 
+    template<typename T>
+    void WriteOnlyByteBuffer::Write(const std::vector<T>& values)
+    {
+        if constexpr (is_bulk_serializable_v<T>)
+        {
+            WriteArray(values.data(), values.size());
+        }
+        else
+        {
+            Write(uint64_t(values.size()));
+            for (const auto& value : values)
+                WriteElement(value);
+        }
+    }
+
+    template<typename T, size_t N>
+    void WriteOnlyByteBuffer::Write(const std::array<T, N>& values)
+    {
+        if constexpr (is_bulk_serializable_v<T>)
+        {
+            Write(sizeof(T) * N, reinterpret_cast<const uint8_t*>(values.data()));
+        }
+        else
+        {
+            for (const auto& value : values)
+                WriteElement(value);
+        }
+    }
+
+    template<typename T>
+    void WriteOnlyByteBuffer::WriteElement(const T& value)
+    {
+        if constexpr (std::is_base_of_v<BinaryStreamable, T>)
+            value.Write(*this);
+        else
+            Write(value);
+    }
+
+    template<typename T>
+    void WriteOnlyByteBuffer::WriteArray(const T* data, uint64_t count)
+    {
+        static_assert(is_bulk_serializable_v<T>, "Only arrays of trivially copyable types can be written in bulk.");
+
+        Write(count);
+        AlignPosition(alignof(T));
+        if (count != 0) // Empty arrays may have no storage to copy from.
+            Write(sizeof(T) * count, reinterpret_cast<const uint8_t*>(data));
+    }
+
+    template<typename T>
+    void WriteOnlyByteBuffer::WriteVarArray(const T* data, uint64_t count)
+    {
+        static_assert(is_varint_serializable_v<T>, "Only integers can be written as varints.");
+
+        WriteVarUInt(count);
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            if constexpr (std::is_signed_v<T>)
+                WriteVarUInt(ZigZagEncode(data[i]));
+            else
+                WriteVarUInt(data[i]);
+        }
+    }
+
+    template<typename T>
+    void WriteOnlyByteBuffer::WriteDeltaArray(const T* data, uint64_t count)
+    {
+        static_assert(is_varint_serializable_v<T>, "Only integers can be delta encoded.");
+
+        WriteVarUInt(count);
+
+        uint64_t previous = 0;
+        uint64_t i = 0;
+        while (i < count)
+        {
+            const auto delta = uint64_t(data[i]) - previous;
+
+            uint64_t run = 0;
+            while (i + run + 1 < count && uint64_t(data[i + run + 1]) - uint64_t(data[i + run]) == delta)
+                ++run;
+            if (run < 2)
+                run = 0; // Cheaper to write a repeat of 1 as its own token.
+
+            WriteDeltaToken(ZigZagEncode(int64_t(delta)), run);
+            previous = uint64_t(data[i + run]);
+            i += run + 1;
+        }
+    }
+
     template<>
     void WriteOnlyByteBuffer::Write(const std::string& value);
 
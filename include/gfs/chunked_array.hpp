@@ -0,0 +1,227 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gfs
+{
+	/**
+	 * Array stored as fixed size chunks (about 4KB of elements each) that copies share until they are modified.
+	 * Copying only shares the chunk table. The first change to a copy copies the table (a pointer per chunk) & then each chunk
+	 * it changes, so publishing a copy of a large array after a small change costs in proportion to the change.
+	 * Only the last chunk grows as elements are added, so small arrays stay small.
+	 * @attention Copies can be read from any thread, but each copy must only be modified by one thread at a time.
+	 */
+	template<typename T>
+	class ChunkedArray
+	{
+	public:
+		static constexpr uint32_t ChunkShift = sizeof(T) <= 4 ? 10 : sizeof(T) <= 8 ? 9 : sizeof(T) <= 16 ? 8 : 7;
+		static constexpr uint64_t ChunkSize = uint64_t(1) << ChunkShift;
+
+		/**
+		 * @brief
+		 * @param allocator Used for the chunks & the chunk table. Defaults to `GetDefaultAllocator()`.
+		 * @param category
+		 */
+		explicit ChunkedArray(Allocator* allocator = nullptr, MemoryCategory category = MemoryCategory::General)
+			: m_allocator(allocator, category)
+		{
+		}
+
+		ChunkedArray(const ChunkedArray& other) = default;
+		ChunkedArray& operator=(const ChunkedArray& other) = default;
+
+		ChunkedArray(ChunkedArray&& other) noexcept
+			: m_allocator(other.m_allocator),
+			  m_table(std::move(other.m_table)),
+			  m_entries(std::exchange(other.m_entries, nullptr)),
+			  m_size(std::exchange(other.m_size, 0))
+		{
+		}
+
+		ChunkedArray& operator=(ChunkedArray&& other) noexcept
+		{
+			m_allocator = other.m_allocator;
+			m_table = std::move(other.m_table);
+			m_entries = std::exchange(other.m_entries, nullptr);
+			m_size = std::exchange(other.m_size, 0);
+			return *this;
+		}
+
+		auto operator[](uint64_t index) const -> const T& { return m_entries[index >> ChunkShift].Data[index & (ChunkSize - 1)]; }
+
+		/**
+		 * @brief Copies the element's chunk first if it is shared.
+		 * @param index
+		 * @return
+		 */
+		auto GetMutable(uint64_t index) -> T&;
+		void Set(uint64_t index, T value) { GetMutable(index) = std::move(value); }
+
+		void PushBack(T value);
+		void PopBack();
+
+		/**
+		 * @brief Replaces the contents with `count` copies of `value`, in new chunks.
+		 * @param count
+		 * @param value
+		 */
+		void Assign(uint64_t count, const T& value);
+		void Clear();
+		void Reserve(uint64_t count);
+
+		auto GetSize() const -> uint64_t { return m_size; }
+		bool IsEmpty() const { return m_size == 0; }
+
+	private:
+		using Chunk = std::vector<T, StlAllocator<T>>;
+
+		struct Entry
+		{
+			std::shared_ptr<Chunk> Items;
+			T* Data; // `Items->data()`, saving a dereference on reads.
+		};
+
+		using Table = std::vector<Entry, StlAllocator<Entry>>;
+
+		template<typename U>
+		static bool IsUnique(const std::shared_ptr<U>& ptr);
+
+		auto GetMutableTable() -> Table&;
+		auto GetMutableChunk(Table& table, uint64_t chunkIndex) -> Chunk&;
+		auto CreateChunk() const -> std::shared_ptr<Chunk>;
+
+	private:
+		StlAllocator<T> m_allocator;
+		std::shared_ptr<Table> m_table; // nullptr until the first element is added.
+		const Entry* m_entries = nullptr;
+		uint64_t m_size = 0;
+	};
+
+	template<typename T>
+	template<typename U>
+	bool ChunkedArray<T>::IsUnique(const std::shared_ptr<U>& ptr)
+	{
+		if (ptr.use_count() != 1)
+			return false;
+
+		// Other copies release their references from other threads. Their reads must happen before the writes that follow.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+
+	template<typename T>
+	auto ChunkedArray<T>::GetMutableTable() -> Table&
+	{
+		if (!m_table)
+			m_table = std::allocate_shared<Table>(StlAllocator<Table>(m_allocator), StlAllocator<Entry>(m_allocator));
+		else if (!IsUnique(m_table))
+			m_table = std::allocate_shared<Table>(StlAllocator<Table>(m_allocator), *m_table);
+
+		m_entries = m_table->data();
+		return *m_table;
+	}
+
+	template<typename T>
+	auto ChunkedArray<T>::GetMutableChunk(Table& table, uint64_t chunkIndex) -> Chunk&
+	{
+		auto& entry = table[chunkIndex];
+		if (!IsUnique(entry.Items))
+		{
+			auto items = std::allocate_shared<Chunk>(StlAllocator<Chunk>(m_allocator), m_allocator);
+			items->reserve(entry.Items->capacity());
+			items->assign(entry.Items->begin(), entry.Items->end());
+			entry.Items = std::move(items);
+			entry.Data = entry.Items->data();
+		}
+		return *entry.Items;
+	}
+
+	template<typename T>
+	auto ChunkedArray<T>::CreateChunk() const -> std::shared_ptr<Chunk>
+	{
+		return std::allocate_shared<Chunk>(StlAllocator<Chunk>(m_allocator), m_allocator);
+	}
+
+	template<typename T>
+	auto ChunkedArray<T>::GetMutable(uint64_t index) -> T&
+	{
+		auto& table = GetMutableTable();
+		return GetMutableChunk(table, index >> ChunkShift)[index & (ChunkSize - 1)];
+	}
+
+	template<typename T>
+	void ChunkedArray<T>::PushBack(T value)
+	{
+		auto& table = GetMutableTable();
+		const auto chunkIndex = m_size >> ChunkShift;
+		if (chunkIndex == table.size())
+		{
+			auto items = CreateChunk();
+			if (chunkIndex != 0)
+				items->reserve(ChunkSize); // Arrays this size are expected to keep growing.
+			table.push_back({ std::move(items), nullptr });
+			m_entries = table.data();
+		}
+
+		auto& chunk = GetMutableChunk(table, chunkIndex);
+		chunk.push_back(std::move(value));
+		table[chunkIndex].Data = chunk.data();
+		++m_size;
+	}
+
+	template<typename T>
+	void ChunkedArray<T>::PopBack()
+	{
+		auto& table = GetMutableTable();
+		--m_size;
+		const auto chunkIndex = m_size >> ChunkShift;
+		if ((m_size & (ChunkSize - 1)) == 0)
+		{
+			table.pop_back(); // Held only this element.
+			return;
+		}
+		GetMutableChunk(table, chunkIndex).pop_back();
+	}
+
+	template<typename T>
+	void ChunkedArray<T>::Assign(uint64_t count, const T& value)
+	{
+		m_table.reset();
+		m_size = 0;
+		auto& table = GetMutableTable();
+		table.reserve((count + ChunkSize - 1) >> ChunkShift);
+		for (uint64_t first = 0; first < count; first += ChunkSize)
+		{
+			auto items = CreateChunk();
+			items->assign(std::min(ChunkSize, count - first), value);
+			table.push_back({ items, items->data() });
+		}
+		m_entries = table.data();
+		m_size = count;
+	}
+
+	template<typename T>
+	void ChunkedArray<T>::Clear()
+	{
+		m_table.reset();
+		m_entries = nullptr;
+		m_size = 0;
+	}
+
+	template<typename T>
+	void ChunkedArray<T>::Reserve(uint64_t count)
+	{
+		auto& table = GetMutableTable();
+		table.reserve((count + ChunkSize - 1) >> ChunkShift);
+		m_entries = table.data();
+	}
+
+} // namespace gfs
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "binary_streams.hpp"
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+namespace gfs
+{
+    /**
+     * A serialized member. Members added after the first version of a type record the version they were introduced in, so
+     * data written by older versions can still be read (the member keeps its default value).
+     */
+    template<typename Class, typename Member>
+    struct FieldDesc
+    {
+        using MemberType = Member;
+
+        Member Class::*Pointer;
+        uint16_t SinceVersion;
+    };
+
+    template<typename Class, typename Member>
+    constexpr auto Field(Member Class::*pointer, uint16_t sinceVersion = 1) -> FieldDesc<Class, Member>
+    {
+        return { pointer, sinceVersion };
+    }
+
+    /**
+     * Generates `Read()`/`Write()` from a single list of members. The derived type provides the list as
+     * `static constexpr auto GetFields() { return std::make_tuple(gfs::Field(&Type::member), ...); }`.
+     *
+     * Objects are written as a `uint16_t` version followed by each member in list order. Members that are trivially copyable
+     * & adjacent in memory (no padding between them) are copied with a single memcpy. Data written by a newer version of a
+     * type cannot be read by an older version.
+     */
+    template<typename Derived, uint16_t Version = 1>
+    struct FieldStreamable : BinaryStreamable
+    {
+        static constexpr uint16_t FieldsVersion = Version;
+
+        void Read(ReadOnlyByteBuffer& buffer) override;
+        void Write(WriteOnlyByteBuffer& buffer) const override;
+    };
+
+    template<typename T>
+    void ReadFields(ReadOnlyByteBuffer& buffer, T& object);
+
+    template<typename T>
+    void WriteFields(WriteOnlyByteBuffer& buffer, const T& object);
+
+    namespace detail
+    {
+        template<typename T, typename = void>
+        struct has_fields : std::false_type
+        {
+        };
+
+        template<typename T>
+        struct has_fields<T, std::void_t<decltype(T::GetFields())>> : std::true_type
+        {
+        };
+
+        template<typename T, typename = void>
+        struct fields_version : std::integral_constant<uint16_t, 1>
+        {
+        };
+
+        template<typename T>
+        struct fields_version<T, std::void_t<decltype(T::FieldsVersion)>> : std::integral_constant<uint16_t, T::FieldsVersion>
+        {
+        };
+
+        template<typename Member>
+        constexpr bool is_memcpy_field_v = std::is_trivially_copyable_v<Member> && !has_fields<Member>::value;
+
+        // The field list as a constant, so each member pointer & version is known when the serializer is instantiated.
+        template<typename T>
+        inline constexpr auto field_list_v = T::GetFields();
+
+        template<typename T>
+        constexpr size_t field_count_v = std::tuple_size_v<std::remove_const_t<decltype(field_list_v<T>)>>;
+
+        template<typename T, size_t I>
+        using field_member_t = typename std::tuple_element_t<I, std::remove_const_t<decltype(field_list_v<T>)>>::MemberType;
+
+        template<typename T, size_t I>
+        constexpr uint16_t field_since_v = std::get<I>(field_list_v<T>).SinceVersion;
+
+        /**
+         * @brief
+         * @return End of the fields from `I` that may share a memcpy: trivially copyable & added in the same version.
+         */
+        template<typename T, size_t I>
+        constexpr auto GetMemcpyRunEnd() -> size_t
+        {
+            if constexpr (I + 1 < field_count_v<T>)
+            {
+                if constexpr (is_memcpy_field_v<field_member_t<T, I + 1>> && field_since_v<T, I + 1> == field_since_v<T, I>)
+                    return GetMemcpyRunEnd<T, I + 1>();
+                else
+                    return I + 1;
+            }
+            else
+            {
+                return I + 1;
+            }
+        }
+
+        template<typename T, size_t I, typename Object>
+        auto GetFieldBytes(Object& object)
+        {
+            using Byte = std::conditional_t<std::is_const_v<Object>, const uint8_t, uint8_t>;
+            return reinterpret_cast<Byte*>(&(object.*std::get<I>(field_list_v<T>).Pointer));
+        }
+
+        /**
+         * @brief Whether fields [I, End) follow each other in memory with no padding between them.
+         * @attention C++17 cannot evaluate member offsets in a constant expression. The member pointers are constants though,
+         * so this folds to true or false & the untaken branch is removed.
+         */
+        template<typename T, size_t I, size_t End>
+        bool IsContiguous(const T& object)
+        {
+            if constexpr (I + 1 >= End)
+                return true;
+            else
+                return GetFieldBytes<T, I>(object) + sizeof(field_member_t<T, I>) == GetFieldBytes<T, I + 1>(object) &&
+                       IsContiguous<T, I + 1, End>(object);
+        }
+
+        template<typename T, size_t I, size_t End>
+        constexpr auto GetRunSize() -> uint64_t
+        {
+            if constexpr (I >= End)
+                return 0;
+            else
+                return sizeof(field_member_t<T, I>) + GetRunSize<T, I + 1, End>();
+        }
+
+        template<typename Member>
+        void ReadMember(ReadOnlyByteBuffer& buffer, Member& value)
+        {
+            if constexpr (has_fields<Member>::value)
+                ReadFields(buffer, value); // Skips the virtual call for nested field streamables.
+            else if constexpr (std::is_base_of_v<BinaryStreamable, Member>)
+                value.Read(buffer);
+            else
+                buffer.Read(value);
+        }
+
+        template<typename Member>
+        void WriteMember(WriteOnlyByteBuffer& buffer, const Member& value)
+        {
+            if constexpr (has_fields<Member>::value)
+                WriteFields(buffer, value);
+            else if constexpr (std::is_base_of_v<BinaryStreamable, Member>)
+                value.Write(buffer);
+            else
+                buffer.Write(value);
+        }
+
+        template<typename T, size_t I>
+        void ReadFieldsFrom(ReadOnlyByteBuffer& buffer, T& object, uint16_t version);
+
+        template<typename T, size_t I>
+        void WriteFieldsFrom(WriteOnlyByteBuffer& buffer, const T& object);
+
+        // Copies the longest contiguous run of fields from `I`, then continues after it.
+        template<typename T, size_t I, size_t End>
+        void ReadRun(ReadOnlyByteBuffer& buffer, T& object, uint16_t version)
+        {
+            if constexpr (End > I + 1)
+            {
+                if (!IsContiguous<T, I, End>(object))
+                    return ReadRun<T, I, End - 1>(buffer, object, version);
+            }
+
+            if (field_since_v<T, I> <= version) // Not present in older data otherwise.
+                buffer.Read(GetRunSize<T, I, End>(), GetFieldBytes<T, I>(object));
+            ReadFieldsFrom<T, End>(buffer, object, version);
+        }
+
+        template<typename T, size_t I, size_t End>
+        void WriteRun(WriteOnlyByteBuffer& buffer, const T& object)
+        {
+            if constexpr (End > I + 1)
+            {
+                if (!IsContiguous<T, I, End>(object))
+                    return WriteRun<T, I, End - 1>(buffer, object);
+            }
+
+            buffer.Write(GetRunSize<T, I, End>(), GetFieldBytes<T, I>(object));
+            WriteFieldsFrom<T, End>(buffer, object);
+        }
+
+        template<typename T, size_t I>
+        void ReadFieldsFrom(ReadOnlyByteBuffer& buffer, T& object, uint16_t version)
+        {
+            if constexpr (I < field_count_v<T>)
+            {
+                if constexpr (is_memcpy_field_v<field_member_t<T, I>>)
+                {
+                    ReadRun<T, I, GetMemcpyRunEnd<T, I>()>(buffer, object, version);
+                }
+                else
+                {
+                    if (field_since_v<T, I> <= version)
+                        ReadMember(buffer, object.*std::get<I>(field_list_v<T>).Pointer);
+                    ReadFieldsFrom<T, I + 1>(buffer, object, version);
+                }
+            }
+        }
+
+        template<typename T, size_t I>
+        void WriteFieldsFrom(WriteOnlyByteBuffer& buffer, const T& object)
+        {
+            if constexpr (I < field_count_v<T>)
+            {
+                if constexpr (is_memcpy_field_v<field_member_t<T, I>>)
+                {
+                    WriteRun<T, I, GetMemcpyRunEnd<T, I>()>(buffer, object);
+                }
+                else
+                {
+                    WriteMember(buffer, object.*std::get<I>(field_list_v<T>).Pointer);
+                    WriteFieldsFrom<T, I + 1>(buffer, object);
+                }
+            }
+        }
+    } // namespace detail
+
+    template<typename T>
+    void ReadFields(ReadOnlyByteBuffer& buffer, T& object)
+    {
+        static_assert(detail::has_fields<T>::value, "Type must provide `static constexpr auto GetFields()`.");
+
+        uint16_t version = 0;
+        buffer.Read(version);
+        detail::ReadFieldsFrom<T, 0>(buffer, object, version);
+    }
+
+    template<typename T>
+    void WriteFields(WriteOnlyByteBuffer& buffer, const T& object)
+    {
+        static_assert(detail::has_fields<T>::value, "Type must provide `static constexpr auto GetFields()`.");
+
+        buffer.Write(detail::fields_version<T>::value);
+        detail::WriteFieldsFrom<T, 0>(buffer, object);
+    }
+
+    template<typename Derived, uint16_t Version>
+    void FieldStreamable<Derived, Version>::Read(ReadOnlyByteBuffer& buffer)
+    {
+        ReadFields(buffer, static_cast<Derived&>(*this));
+    }
+
+    template<typename Derived, uint16_t Version>
+    void FieldStreamable<Derived, Version>::Write(WriteOnlyByteBuffer& buffer) const
+    {
+        WriteFields(buffer, static_cast<const Derived&>(*this));
+    }
+
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "allocator.hpp"
+#include "chunked_array.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gfs
+{
+	using MountID = uint32_t;
+	using FileID = uint64_t;
+
+	constexpr MountID InvalidMountId = 0;
+	constexpr FileID InvalidFileId = 0;
+
+	/**
+	 * POD type.
+	 */
+	struct File
+	{
+		FileID FileId;						  // The Unique Identifier of the file.
+		MountID MountId;					  // The Id of the mount this file is in.
+		std::filesystem::path MountRelPath;	  // Path to this file relative to the mount it is in.
+		std::filesystem::path SourceFilename; // The source file this file was imported from.
+		std::string MetadataStr;			  // String containg optional metadata eg. Import settings, etc.
+		std::vector<FileID> FileDependencies; // Files this file references.
+		uint64_t SourceHash;				  // Content hash of the source file when this file was imported. 0 if unknown.
+		uint64_t MetadataHash;				  // Hash of the metadata this file was imported with. 0 if unknown.
+		uint32_t UncompressedSize;
+		uint32_t CompressedSize;
+		uint32_t Offset;
+
+		// In-memory only. Not written as part of the record.
+		uint32_t RecordOffset; // Position of this record within the file it is stored in.
+
+		friend auto operator<<(std::ostream& stream, const File& header) -> std::ostream&;
+		friend auto operator>>(std::istream& stream, File& header) -> std::istream&;
+	};
+
+	/**
+	 * Flat registry of files.
+	 * Fixed size fields are stored as a structure-of-arrays indexed by a dense file index, with an open-addressing
+	 * (linear probing) table mapping file ids to dense indices. Paths are interned & referenced by id.
+	 * Mount relative paths are normalized & indexed so files can also be found by path. When several mounts contain the
+	 * same path, the mount with the highest priority takes precedence (ties go to the most recently created mount).
+	 * Files are also indexed by source filename & by the files that depend on them.
+	 * Everything is stored in `ChunkedArray`s, so a copy (eg. A published snapshot) shares its storage with the original &
+	 * changing either afterwards only copies the chunks that change.
+	 * Dense indices are only stable until the next `Insert()`/`Remove()`.
+	 */
+	class FileRegistry
+	{
+	public:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+		static constexpr uint32_t EmptyPathId = 0; // Interned id of the empty path.
+
+		/**
+		 * @brief
+		 * @param allocator Used for all arrays (`MemoryCategory::Registry`). Defaults to `GetDefaultAllocator()`. Copies share
+		 * their storage, & so the allocator, with the original.
+		 */
+		explicit FileRegistry(Allocator* allocator = nullptr);
+
+		/**
+		 * @brief Adds a file, replacing any existing file with the same id.
+		 * @param file
+		 * @return The dense index of the file.
+		 */
+		auto Insert(const File& file) -> uint32_t;
+
+		/**
+		 * @brief
+		 * @param id
+		 * @return True if a file was removed.
+		 */
+		bool Remove(FileID id);
+
+		void Clear();
+		void Reserve(uint32_t count);
+
+		/**
+		 * @brief Sets whether cold fields (metadata & dependencies) are stored. Stored by default.
+		 * When not stored, `GetMetadata()`/`GetDependencies()` return empty values, dependencies are still indexed for
+		 * `GetDependents()`, but edges of replaced or removed files are only dropped once the dependent no longer exists.
+		 * @param resident
+		 */
+		void SetColdFieldsResident(bool resident);
+
+		/**
+		 * @brief Sets the precedence of a mount's files in path lookups. Must be set before files in the mount are added.
+		 * @param mountId
+		 * @param priority Higher priorities shadow lower priorities.
+		 */
+		void SetMountPriority(MountID mountId, int32_t priority);
+
+		/**
+		 * @brief Removes all files in a mount.
+		 * @param mountId
+		 */
+		void RemoveMount(MountID mountId);
+
+		/**
+		 * @brief
+		 * @param id
+		 * @return Dense index of the file or `InvalidIndex` if it is not registered.
+		 */
+		auto Find(FileID id) const -> uint32_t;
+
+		/**
+		 * @brief Finds the file at a mount relative path in the mount with the highest precedence that contains the path.
+		 * @param path Normalized path. See `NormalizePath()`.
+		 * @return Dense index of the file or `InvalidIndex` if no mount contains a single file at the path (eg. Archives).
+		 */
+		auto FindByPath(const std::string& path) const -> uint32_t;
+
+		/**
+		 * @brief Finds the file at a mount relative path in a specific mount.
+		 * @param path Normalized path. See `NormalizePath()`.
+		 * @param mountId
+		 * @return Dense index of the file or `InvalidIndex` if the mount does not contain a single file at the path.
+		 */
+		auto FindByPath(const std::string& path, MountID mountId) const -> uint32_t;
+
+		/**
+		 * @brief Lexically normalizes a mount relative path (generic separators, no `.`/`..` elements). Does not touch disk.
+		 * @param path
+		 * @return
+		 */
+		static auto NormalizePath(const std::filesystem::path& path) -> std::string;
+
+		/**
+		 * @brief
+		 * @param sourceFilename
+		 * @return Ids of the files imported from the source file.
+		 */
+		auto GetFilesWithSourceFile(const std::string& sourceFilename) const -> const std::vector<FileID>&;
+
+		/**
+		 * @brief
+		 * @param id
+		 * @return Ids of the registered files that list `id` as a dependency.
+		 */
+		auto GetDependents(FileID id) const -> std::vector<FileID>;
+
+		auto GetCount() const -> uint32_t { return uint32_t(m_fileIds.GetSize()); }
+
+		/**
+		 * @brief Builds a `File` from the stored fields.
+		 * @param index Dense index.
+		 * @return
+		 */
+		auto GetFile(uint32_t index) const -> File;
+
+		auto GetFileId(uint32_t index) const -> FileID { return m_fileIds[index]; }
+		auto GetMountId(uint32_t index) const -> MountID { return m_mountIds[index]; }
+		auto GetMountRelPathId(uint32_t index) const -> uint32_t { return m_mountRelPathIds[index]; }
+		auto GetSourceFilenameId(uint32_t index) const -> uint32_t { return m_sourceFilenameIds[index]; }
+		auto GetUncompressedSize(uint32_t index) const -> uint32_t { return m_uncompressedSizes[index]; }
+		auto GetCompressedSize(uint32_t index) const -> uint32_t { return m_compressedSizes[index]; }
+		auto GetOffset(uint32_t index) const -> uint32_t { return m_offsets[index]; }
+		auto GetRecordOffset(uint32_t index) const -> uint32_t { return m_recordOffsets[index]; }
+		auto GetSourceHash(uint32_t index) const -> uint64_t { return m_sourceHashes[index]; }
+		auto GetMetadataHash(uint32_t index) const -> uint64_t { return m_metadataHashes[index]; }
+		auto GetMetadata(uint32_t index) const -> const std::string& { return m_metadata[index]; }
+		auto GetDependencies(uint32_t index) const -> const std::vector<FileID>& { return m_dependencies[index]; }
+
+		auto GetMountRelPath(uint32_t index) const -> const std::string& { return m_paths[m_mountRelPathIds[index]]; }
+		auto GetSourceFilename(uint32_t index) const -> const std::string& { return m_paths[m_sourceFilenameIds[index]]; }
+
+		// Raw hot field arrays for tight loops.
+		auto GetFileIds() const -> const ChunkedArray<FileID>& { return m_fileIds; }
+		auto GetSourceFilenameIds() const -> const ChunkedArray<uint32_t>& { return m_sourceFilenameIds; }
+
+		/**
+		 * @brief
+		 * @param path
+		 * @return Interned id of the path or `InvalidIndex` if the path has never been interned.
+		 */
+		auto FindPathId(const std::string& path) const -> uint32_t;
+
+		auto GetPath(uint32_t pathId) const -> const std::string& { return m_paths[pathId]; }
+
+	private:
+		auto InternPath(const std::string& path) -> uint32_t;
+
+		auto GetMountPriority(MountID mountId) const -> int32_t;
+		bool HasPrecedence(MountID lhs, MountID rhs) const;
+		void AddPathFile(uint32_t index);
+		void RemovePathFile(uint32_t index);
+		void SetPathPosition(FileID id, uint32_t position);
+		void AddSourceFile(uint32_t sourceFilenameId, FileID id);
+		void RemoveSourceFile(uint32_t sourceFilenameId, FileID id);
+		void AddDependent(FileID dependency, FileID id);
+		void RemoveDependent(FileID dependency, FileID id);
+		auto FindByPathId(uint32_t pathId, MountID mountId) const -> uint32_t;
+
+		auto FindSlot(FileID id) const -> uint64_t;
+		auto FindPathSlot(const std::string& path, uint64_t hash) const -> uint64_t;
+		auto FindDependencySlot(FileID dependency) const -> uint64_t;
+		void Rehash(uint64_t newSlotCount);
+
+	private:
+		// Open-addressing table. Each slot holds a dense index or `InvalidIndex`.
+		ChunkedArray<uint32_t> m_slots;
+
+		// Hot fields (structure-of-arrays).
+		ChunkedArray<FileID> m_fileIds;
+		ChunkedArray<MountID> m_mountIds;
+		ChunkedArray<uint32_t> m_mountRelPathIds;
+		ChunkedArray<uint32_t> m_sourceFilenameIds;
+		ChunkedArray<uint32_t> m_uncompressedSizes;
+		ChunkedArray<uint32_t> m_compressedSizes;
+		ChunkedArray<uint32_t> m_offsets;
+		ChunkedArray<uint32_t> m_recordOffsets;
+		ChunkedArray<uint32_t> m_pathPositions; // Index in `m_pathFiles` of the file's mount relative path.
+
+		// Import cache fields. Always resident so up to date checks never touch disk.
+		ChunkedArray<uint64_t> m_sourceHashes;
+		ChunkedArray<uint64_t> m_metadataHashes;
+
+		// Cold fields.
+		ChunkedArray<std::string> m_metadata;
+		ChunkedArray<std::vector<FileID>> m_dependencies;
+
+		// Interned paths, with their hashes & an open-addressing table of path ids.
+		ChunkedArray<std::string> m_paths;
+		ChunkedArray<uint64_t> m_pathHashes;
+		ChunkedArray<uint32_t> m_pathSlots;
+
+		// Indexed by path id.
+		ChunkedArray<std::vector<FileID>> m_pathFiles;	 // Files at each mount relative path, ordered by mount precedence. A mount's files are contiguous.
+		ChunkedArray<std::vector<FileID>> m_sourceFiles; // Files imported from each source filename.
+		std::unordered_map<MountID, int32_t> m_mountPriorities;
+
+		// Dependency -> Files depending on it. Dense like the files, with their own open-addressing table.
+		ChunkedArray<uint32_t> m_dependencySlots;
+		ChunkedArray<FileID> m_dependencyIds;
+		ChunkedArray<std::vector<FileID>> m_dependents;
+		bool m_coldFieldsResident = true;
+	};
+
+} // namespace gfs
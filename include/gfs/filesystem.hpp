@@ -1,15 +1,20 @@
 #pragma once
 
+#include "access_trace.hpp"
 #include "binary_streams.hpp"
+#include "file_registry.hpp"
+#include "stats.hpp"
 
-#include <FileWatch.hpp>
-
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <filesystem>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -18,8 +23,18 @@
 namespace gfs
 {
 	constexpr uint64_t FS_COMPRESS_MIN_FILE_SIZE_BYTES = uint64_t(1024) * uint64_t(512); // 512KB = 0.5MB
+	constexpr const char* FS_MOUNT_INDEX_FILENAME = ".gfs_index"; // Default mount index snapshot, in the mount's root directory.
 
+	class AccessTraceRecorder;
 	class FileImporter;
+	class FileWatcher;
+	class MountBackend;
+	class MountFile;
+	class SharedCache;
+	class StagedWrite;
+	class ThreadPool;
+	struct StatsCollector;
+	struct WriteChunk;
 
 	template <typename S, typename T, typename = void>
 	struct is_to_stream_writable : std::false_type
@@ -31,11 +46,6 @@ namespace gfs
 	{
 	};
 
-	using MountID = uint32_t;
-	using FileID = uint64_t;
-
-	constexpr MountID InvalidMountId = 0;
-
 	struct FormatHeader
 	{
 		char MagicNumber[4];
@@ -46,13 +56,66 @@ namespace gfs
 		friend auto operator>>(std::istream& stream, FormatHeader& header) -> std::istream&;
 	};
 
+	enum class ReadMode : uint8_t
+	{
+		Default,  // Uncached for files of at least the uncached read threshold, cached otherwise.
+		Cached,	  // Through the OS page cache.
+		Uncached, // Bypasses the OS page cache where supported (`O_DIRECT` on Linux) & drops the file's pages afterwards.
+	};
+
+	struct ImportProgress
+	{
+		uint32_t CompletedCount; // Files processed so far, including failed files.
+		uint32_t TotalCount;
+		std::filesystem::path Filename; // The file that was just processed.
+	};
+
+	struct ImportOptions
+	{
+		std::string Metadata; // Passed to every import.
+		bool Recursive = true; // Also import files in subdirectories, mirroring the directory structure under the output directory.
+		std::function<void(const ImportProgress& progress)> ProgressCallback; // Called on the thread calling `ImportDirectory()`.
+	};
+
+	struct ImportError
+	{
+		std::filesystem::path Filename;
+		std::string Message;
+	};
+
+	struct ImportResult
+	{
+		uint32_t ImportedCount = 0;
+		uint32_t UpToDateCount = 0; // Skipped by the import cache.
+		uint32_t FailedCount = 0;
+		std::vector<ImportError> Errors; // Sorted by filename.
+
+		bool Succeeded() const { return FailedCount == 0; }
+	};
+
 	class Filesystem
 	{
 	public:
-		Filesystem() = default;
-		~Filesystem() = default;
+		/**
+		 * @brief
+		 * @param allocator Used for file data, compression buffers & the file registry, eg. An arena to keep loading
+		 * within a budget or a `TrackingAllocator` to measure it. Must outlive the filesystem & any snapshot from
+		 * `GetFileSnapshot()`, which shares the registry's storage. Defaults to `GetDefaultAllocator()`.
+		 */
+		explicit Filesystem(Allocator* allocator = nullptr);
+		~Filesystem();
 
-		void Tick();
+		auto GetAllocator() const -> Allocator* { return m_allocator; }
+
+		/**
+		 * @brief Processes hot reloads. Call once per frame from the main thread.
+		 * Files whose source files were modified & have been quiet for the debounce period are reimported on worker threads.
+		 * Independent files are reimported in parallel & dependents only after the files they depend on. The reimport callback
+		 * is then called from this function for each reimported file. Callbacks which do not fit in the time budget are
+		 * delivered on the next tick. At least one callback is made per tick if any are ready.
+		 * @param timeBudget
+		 */
+		void Tick(std::chrono::microseconds timeBudget = std::chrono::microseconds::max());
 
 		//////////////////////////////////////////////////////////////////////////
 		// Mounts
@@ -63,15 +126,46 @@ namespace gfs
 			MountID Id;
 			std::filesystem::path RootDirPath;
 			bool AllowUnmount;
+			int32_t Priority;
+			std::shared_ptr<MountBackend> Backend; // Where the files are stored. In-memory mounts have no root directory.
+			std::filesystem::path IndexFilename;   // Mount index snapshot (See `SetMountIndexEnabled()`). Empty if it has none.
+
+			bool IsInMemory() const;
 		};
 
 		/**
 		 * @brief
 		 * @param rootDir
 		 * @param allowUnmount
+		 * @param priority Precedence of this mount when finding files by path. Files in higher priority mounts shadow files at
+		 * the same path in lower priority mounts (eg. Mods overriding base data). Later mounts win ties.
+		 * @param indexFilename Where the mount index snapshot is kept. Relative to `rootDir`, or absolute to keep it out of the
+		 * content (eg. In a cache directory when the content is read only or under version control). Empty for no index.
 		 * @return 0 if failed to mount directory. >0 if successful.
 		 */
-		auto MountDir(const std::filesystem::path& rootDir, bool allowUnmount = true) -> MountID;
+		auto MountDir(const std::filesystem::path& rootDir,
+			bool allowUnmount = true,
+			int32_t priority = 0,
+			const std::filesystem::path& indexFilename = FS_MOUNT_INDEX_FILENAME) -> MountID;
+
+		/**
+		 * @brief Mounts an empty in-memory mount. Files written to it with `WriteFile()` or `CreateArchive()` (eg. An archive of
+		 * hot files gathered from other mounts), or loaded with `LoadIntoMemory()`, are kept in memory & read without any I/O.
+		 * Its contents are lost once unmounted.
+		 * @param allowUnmount
+		 * @param priority See `MountDir()`.
+		 * @return
+		 */
+		auto MountMemory(bool allowUnmount = true, int32_t priority = 0) -> MountID;
+
+		/**
+		 * @brief Copies a gfs file (eg. An archive) from disk into an in-memory mount & registers the files it contains.
+		 * @param mountId In-memory mount.
+		 * @param filename File on disk.
+		 * @param mountRelPath Path of the file within the mount.
+		 * @return False if the mount is not an in-memory mount or the file is not a valid gfs file.
+		 */
+		bool LoadIntoMemory(MountID mountId, const std::filesystem::path& filename, const std::filesystem::path& mountRelPath);
 
 		/**
 		 * @brief
@@ -83,11 +177,16 @@ namespace gfs
 		/**
 		 * @brief
 		 * @param rootDir
-		 * @return 0 if mount does not exist. Otherwise, returns the mounts id.
+		 * @return 0 if mount does not exist. Otherwise, returns the mounts id. In-memory mounts are never returned.
 		 */
 		auto GetMountId(const std::filesystem::path& rootDir) -> MountID;
 
-		auto GetMount(MountID mountId) -> const Mount*;
+		/**
+		 * @brief
+		 * @param mountId
+		 * @return A copy of the mount, so it stays valid if the mount is unmounted. Empty if there is no such mount.
+		 */
+		auto GetMount(MountID mountId) -> std::optional<Mount>;
 
 		/**
 		 * @brief Runs the given function for each mounted directory.
@@ -95,35 +194,92 @@ namespace gfs
 		 */
 		void ForEachMount(const std::function<void(const Mount&)>& func);
 
+		/**
+		 * @brief Enables/Disables the mount index snapshot. Enabled by default.
+		 * When enabled, mounting a directory writes an index file (See `MountDir()`) containing every file record along with
+		 * the size & modification time of the file it came from. Subsequent mounts of the same directory only revalidate files
+		 * whose size or modification time no longer match the index.
+		 * @param enabled
+		 */
+		void SetMountIndexEnabled(bool enabled);
+
 		//////////////////////////////////////////////////////////////////////////
 		// Files
 		//////////////////////////////////////////////////////////////////////////
 
+		using File = gfs::File;
+
 		/**
-		 * POD type.
+		 * @brief
+		 * @param id
+		 * @return A copy of the file or `std::nullopt` if it is not registered.
 		 */
-		struct File
-		{
-			FileID FileId;						  // The Unique Identifier of the file.
-			MountID MountId;					  // The Id of the mount this file is in.
-			std::filesystem::path MountRelPath;	  // Path to this file relative to the mount it is in.
-			std::filesystem::path SourceFilename; // The source file this file was imported from.
-			std::string MetadataStr;			  // String containg optional metadata eg. Import settings, etc.
-			std::vector<FileID> FileDependencies; // Files this file references.
-			uint32_t UncompressedSize;
-			uint32_t CompressedSize;
-			uint32_t Offset;
-
-			friend auto operator<<(std::ostream& stream, const File& header) -> std::ostream&;
-			friend auto operator>>(std::istream& stream, File& header) -> std::istream&;
-		};
+		auto GetFile(FileID id) const -> std::optional<File>;
 
 		/**
-		 * @brief
+		 * @brief Finds a file by its mount relative path, searching all mounts. Does not touch disk.
+		 * @param path Mount relative path. Lexically normalized before lookup.
+		 * @return The file in the highest priority mount containing the path or `InvalidFileId` if no mount contains a single
+		 * file at the path (Files inside archives are only addressable by id).
+		 */
+		auto FindFile(const std::filesystem::path& path) const -> FileID;
+
+		/**
+		 * @brief Finds a file by its mount relative path in a specific mount. Does not touch disk.
+		 * @param path Mount relative path. Lexically normalized before lookup.
+		 * @param mountId
+		 * @return
+		 */
+		auto FindFile(const std::filesystem::path& path, MountID mountId) const -> FileID;
+
+		/**
+		 * @brief Returns the files that list `id` as one of their dependencies.
 		 * @param id
+		 * @param recursive Also include the dependents of dependents.
 		 * @return
+		 * @attention With lazy file metadata enabled, files that were rewritten without the dependency may still be reported.
 		 */
-		auto GetFile(FileID id) const -> const File*;
+		auto GetDependents(FileID id, bool recursive = false) const -> std::vector<FileID>;
+
+		/**
+		 * @brief Returns an immutable snapshot of the registered files.
+		 * The snapshot is unaffected by later writes & stays valid for as long as it is held.
+		 * @return
+		 * @attention Shares storage allocated from the filesystem's allocator, so must be released before the allocator is
+		 * destroyed.
+		 */
+		auto GetFileSnapshot() const -> std::shared_ptr<const FileRegistry>;
+
+		/**
+		 * @brief Enables/Disables lazy loading of the cold file fields (`MetadataStr` & `FileDependencies`).
+		 * When enabled, registered files only keep their fixed size fields & (interned) paths resident. The cold fields are left
+		 * empty on files returned by `GetFile()`/`ForEachFile()` & should be accessed using `GetFileMetadata()` &
+		 * `GetFileDependencies()` instead, which read them from disk on demand.
+		 * @param enabled
+		 * @attention Should be set before any directories are mounted or files are written.
+		 */
+		void SetLazyFileMetadata(bool enabled);
+
+		/**
+		 * @brief Returns the source filename of a file.
+		 * @param id
+		 * @return Empty if the file does not exist or has no source file.
+		 */
+		auto GetFileSourceFilename(FileID id) -> std::filesystem::path;
+
+		/**
+		 * @brief Returns the metadata of a file, reading it from disk if it is not resident.
+		 * @param id
+		 * @return Empty if the file does not exist or has no metadata.
+		 */
+		auto GetFileMetadata(FileID id) -> std::string;
+
+		/**
+		 * @brief Returns the dependencies of a file, reading them from disk if they are not resident.
+		 * @param id
+		 * @return Empty if the file does not exist or has no dependencies.
+		 */
+		auto GetFileDependencies(FileID id) -> std::vector<FileID>;
 
 		/**
 		 * @brief
@@ -152,9 +308,64 @@ namespace gfs
 		 * @brief
 		 * @param fileId
 		 * @param dataObject
+		 * @param mode Whether the read goes through the OS page cache. Ignored for in-memory mounts & files read through the shared
+		 * cache (See `EnableSharedCache()`).
 		 * @return
 		 */
-		bool ReadFile(FileID fileId, BinaryStreamable& dataObject);
+		bool ReadFile(FileID fileId, BinaryStreamable& dataObject, ReadMode mode = ReadMode::Default);
+
+		/**
+		 * @brief Sets the stored (compressed) size from which `ReadMode::Default` reads bypass the OS page cache, so streaming
+		 * large files does not evict small hot ones. 0 (the default) disables it.
+		 * @param minSize
+		 */
+		void SetUncachedReadThreshold(uint64_t minSize);
+
+		/**
+		 * @brief Shares decompressed file data with other processes on the machine through a named shared memory segment, eg.
+		 * For several servers on one host reading the same mounts. Reads look a file up by id & content version (its file's
+		 * location, size & last write time) before touching the disk & add what they decompress, so each file is held once
+		 * per machine rather than once per process. The first process to use a name creates the segment with its sizes.
+		 * Files in in-memory mounts are not cached. Replaces any shared cache enabled before.
+		 * @param name Shared memory object name, eg. "gfs_server_cache".
+		 * @param capacity Bytes of file data. Nothing is evicted, so once full further files are read privately.
+		 * @param maxEntries
+		 * @return False if the segment could not be created or opened, or on platforms without POSIX shared memory.
+		 * @attention The segment outlives the processes using it until removed with `RemoveSharedCache()` (or a reboot).
+		 */
+		bool EnableSharedCache(const std::string& name, uint64_t capacity, uint32_t maxEntries = 65536);
+
+		void DisableSharedCache();
+
+		/**
+		 * @brief Removes a shared cache's name, so the next process to enable it creates a new segment. Processes already
+		 * using it are unaffected.
+		 * @param name
+		 * @return False if there is no such segment.
+		 */
+		static bool RemoveSharedCache(const std::string& name);
+
+		/**
+		 * @brief Files are always written to a temporary file & renamed over the target, so a file is never seen half written.
+		 * Durable writes also flush the data to disk before the rename, so the new file survives a crash. Disabled by default.
+		 * @param durable
+		 */
+		void SetDurableWrites(bool durable);
+
+		/**
+		 * @brief Groups files written by `WriteFile()` & `CreateArchive()` (from any thread) so they are committed together
+		 * when the batch ends. For durable writes the files are flushed in parallel on the thread pool rather than one after
+		 * another as they are written. Batches can be nested.
+		 * @attention Files written during a batch are not registered or readable until the outermost batch ends.
+		 */
+		void BeginWriteBatch();
+
+		/**
+		 * @brief Ends a batch started by `BeginWriteBatch()`, committing its files if it is the outermost batch.
+		 * @return False if any file in the batch failed to commit. If flushing a durable batch fails none of its files replace
+		 * those on disk.
+		 */
+		bool EndWriteBatch();
 
 		/////////////////////////////////////////////////////////////////////////
 		// Archives
@@ -180,16 +391,61 @@ namespace gfs
 		 */
 		auto GetImporter(const std::string& fileExt) -> std::shared_ptr<FileImporter>;
 
+		/**
+		 * @brief Imports a source file using the importer registered for its extension.
+		 * Files record a hash of their source file's contents & of the metadata they were imported with. When the import cache
+		 * is enabled & every file already imported from the source into `outputDir` of `outputMount` matches both, the importer
+		 * is skipped.
+		 * @param filename
+		 * @param outputMount
+		 * @param outputDir
+		 * @param metadata
+		 * @return True if imported or already up to date.
+		 */
 		bool Import(const std::filesystem::path& filename, MountID outputMount, const std::filesystem::path& outputDir, const std::string& metadata = "");
 
+		/**
+		 * @brief Imports every file in a directory that has an importer. Files are imported concurrently on worker threads, so
+		 * importers must be thread-safe. Blocks until all files have been processed.
+		 * @param srcDir
+		 * @param outputMount
+		 * @param outputDir Mount relative directory. Created (along with any subdirectories) if it does not exist.
+		 * @param options
+		 * @return Counts of imported, up to date & failed files along with the reason each file failed.
+		 * @attention Must not be called from within an importer.
+		 */
+		auto ImportDirectory(const std::filesystem::path& srcDir,
+			MountID outputMount,
+			const std::filesystem::path& outputDir,
+			const ImportOptions& options = {}) -> ImportResult;
+
+		/**
+		 * @brief Reimports a file from its source file, with the metadata it was imported with. Skipped (without calling the
+		 * reimport callback) when the import cache is enabled & the source contents have not changed.
+		 * @param fileId
+		 * @return True if reimported or already up to date.
+		 */
 		bool Reimport(FileID fileId);
 
+		/**
+		 * @brief Enables/Disables skipping imports of unchanged sources. Enabled by default.
+		 * @param enabled
+		 */
+		void SetImportCacheEnabled(bool enabled);
+
 		//////////////////////////////////////////////////////////////////////////
 		// Callbacks
 		//////////////////////////////////////////////////////////////////////////
 
 		void SetFileReimportCallback(const std::function<void(FileID fileId)>& callback);
 
+		/**
+		 * @brief Sets how long a modified source file must go without further modifications before its files are
+		 * reimported. Coalesces the burst of events editors produce per save. Default is 100ms.
+		 * @param quietPeriod
+		 */
+		void SetHotReloadDebounce(std::chrono::milliseconds quietPeriod);
+
 		//////////////////////////////////////////////////////////////////////////
 		// Utility
 		//////////////////////////////////////////////////////////////////////////
@@ -212,15 +468,109 @@ namespace gfs
 		 */
 		bool IsPathInAnyMount(const std::filesystem::path& path);
 
+		//////////////////////////////////////////////////////////////////////////
+		// Statistics
+		//////////////////////////////////////////////////////////////////////////
+
+		/**
+		 * @brief Returns a snapshot of the I/O, compression, import cache & hot reload statistics. Safe to call from any thread.
+		 * Recording uses relaxed atomics only. All values are 0 when built with `GFS_ENABLE_STATS=0`.
+		 * @return
+		 */
+		auto GetStats() const -> FilesystemStats;
+
+		/**
+		 * @brief Resets all counters & histograms, eg. To measure a single level load.
+		 */
+		void ResetStats();
+
+		/**
+		 * @brief Starts recording every `ReadFile()` & `WriteFile()` call (file id, thread, timestamp, size & duration) to a
+		 * compact binary trace, which can be loaded with `ReadAccessTrace()` or replayed with the `gfs_replay` tool.
+		 * @param filename
+		 * @return False if already recording or the trace file could not be created.
+		 */
+		bool StartAccessTrace(const std::filesystem::path& filename);
+
+		/**
+		 * @brief Stops recording & finishes writing the trace.
+		 * @return False if not recording or the trace failed to write.
+		 */
+		bool StopAccessTrace();
+
 	private:
-		auto GetMount_Internal(MountID id) -> Mount*;
-		auto GetFile(FileID id) -> File*;
+		struct MountIndexEntry
+		{
+			std::string MountRelPath; // Generic format path relative to the mount.
+			uint64_t FileSize;
+			int64_t LastWriteTime;
+			std::vector<File> Files; // Records contained in the file. Empty if the file is not a gfs file.
+		};
+
+		struct FileSnapshot
+		{
+			uint64_t Version;
+			FileRegistry Files;
+		};
+
+		struct SnapshotSlots;
+
+		struct ReimportBatch;
+
+		struct PendingWrite
+		{
+			std::shared_ptr<StagedWrite> Staged;
+			MountID MountId;
+			std::vector<File> Files; // Records to register once the file is committed.
+		};
+
+		enum class ImportStatus
+		{
+			Failed,
+			UpToDate,
+			Imported,
+		};
+
+	private:
+		bool GetMount_Internal(MountID id, Mount& outMount) const;
+		auto GetMounts_Internal() const -> std::vector<Mount>;
+		auto AcquireFileSnapshot() const -> const FileRegistry&;
+		auto GetLatestFileSnapshot() const -> std::shared_ptr<const FileSnapshot>;
+		auto GetAccessTrace() const -> std::shared_ptr<AccessTraceRecorder>;
+
+		void RegisterFile_Internal(const File& file);
+		bool CommitWrite_Internal(const Mount& mount, const std::filesystem::path& filename, const std::vector<WriteChunk>& chunks, std::vector<File> files);
+		bool FinalizeWrites(const std::vector<PendingWrite>& writes);
+		auto GetFile_Internal(FileID id) const -> std::optional<File>;
+		bool GetFullFile(FileID id, File& outFile);
+		bool GetFullFile(File file, File& outFile);
+		bool ReadFileRecord(const File& file, File& outFile);
+		static bool ReadFileRecord(std::istream& stream, const File& file, File& outFile);
+		bool ReadFileUncached(MountFile& mountFile, const File& file, BinaryStreamable& dataObject);
+		bool ReadPayload(const uint8_t* payload, const File& file, BinaryStreamable& dataObject);
+		auto ReadFileShared(SharedCache& cache, FileID fileId, MountFile& mountFile, const File& file, BinaryStreamable& dataObject) -> std::optional<bool>;
+		auto GetSharedCache() const -> std::shared_ptr<SharedCache>;
 
 		auto GetMountPathIsIn(const std::filesystem::path& path) -> MountID;
 
 		void GatherFilesInMount(const Mount& mount);
-		void ValidateAndRegisterFile(const std::filesystem::path& filename, MountID mountId);
-
+		static auto ReadFileRecords(std::istream& stream, uint64_t fileSize, const std::filesystem::path& mountRelPath, MountID mountId) -> std::vector<File>;
+
+		static auto ReadMountIndex(const Mount& mount) -> std::unordered_map<std::string, MountIndexEntry>;
+		static bool WriteMountIndex(const Mount& mount, const std::vector<MountIndexEntry>& entries);
+
+		auto Import_Internal(const std::filesystem::path& filename, MountID outputMount, const std::filesystem::path& outputDir, const std::string& metadata)
+			-> ImportStatus;
+		auto Reimport_Internal(FileID fileId) -> ImportStatus;
+		bool IsImportUpToDate(const std::filesystem::path& sourceFilename,
+			MountID mountId,
+			const std::filesystem::path& outputDir,
+			uint64_t sourceHash,
+			uint64_t metadataHash) const;
+		void StartReimportBatch(std::vector<FileID> files);
+		void SubmitReimport(const std::shared_ptr<ReimportBatch>& batch, uint32_t index);
+
+		void WatchSourceFiles(const std::vector<MountIndexEntry>& entries);
 		void CreateFileWatch(const std::filesystem::path& filename);
 		void OnFileModified(const std::filesystem::path& filePath);
 
@@ -229,19 +579,53 @@ namespace gfs
 	private:
 		std::unordered_map<MountID, Mount> m_mountMap;
 		MountID m_nextMountId = 1;
+		mutable std::shared_mutex m_mountMutex; // Guards `m_mountMap` as files are also written from worker threads.
+		std::atomic<bool> m_mountIndexEnabled = true;
 
-		std::unordered_map<FileID, File> m_files;
-		std::mutex m_fileMutex;
+		Allocator* m_allocator;
 
-		std::unordered_map<size_t, std::shared_ptr<FileImporter>> m_extImporterMap;
+		// Writers modify `m_files` under `m_fileMutex` & bump `m_fileVersion`. Readers use `m_fileSnapshot`, an immutable copy
+		// which is republished (at most once per version) the next time a reader sees it is out of date. Copies share the
+		// registry's chunks, so publishing only costs what changed. Writers read `m_files` itself under the lock.
+		FileRegistry m_files;
+		mutable std::mutex m_fileMutex;
+		std::atomic<uint64_t> m_fileVersion = 0;
+		mutable std::shared_ptr<const FileSnapshot> m_fileSnapshot; // Only accessed with std::atomic_load/std::atomic_store.
+		std::unique_ptr<SnapshotSlots> m_snapshotSlots;				// The snapshot each thread last used.
+		std::atomic<bool> m_lazyFileMetadata = false;
+
+		std::atomic<uint64_t> m_uncachedReadThreshold = 0;
+
+		std::atomic<bool> m_sharedCacheEnabled = false;
+		std::shared_ptr<SharedCache> m_sharedCache; // Only accessed with std::atomic_load/std::atomic_store.
 
-		std::vector<std::unique_ptr<filewatch::FileWatch<std::string>>> m_fileWatchers;
-		std::unordered_set<std::string> m_existingFileWatchers;
+		std::atomic<bool> m_durableWrites = false;
+		std::mutex m_writeBatchMutex;
+		uint32_t m_writeBatchDepth = 0;
+		std::vector<PendingWrite> m_pendingWrites; // Written to temporary files, waiting for the batch to end.
 
-		std::mutex m_hotReloadMutex;
-		std::queue<FileID> m_fileHotReloadQueue;
+		std::unique_ptr<StatsCollector> m_stats; // Declared before the watcher & worker threads, which record into it.
+
+		std::mutex m_accessTraceMutex; // Serializes starting & stopping.
+		std::atomic<bool> m_accessTraceEnabled = false;
+		std::shared_ptr<AccessTraceRecorder> m_accessTrace; // Only accessed with std::atomic_load/std::atomic_store.
+
+		std::unordered_map<size_t, std::shared_ptr<FileImporter>> m_extImporterMap;
+		std::shared_mutex m_importerMutex;
+		std::atomic<bool> m_importCacheEnabled = true;
+
+		mutable std::mutex m_hotReloadMutex;
+		std::unordered_map<FileID, std::chrono::steady_clock::time_point> m_pendingHotReloads; // File -> Last modification.
+		std::deque<FileID> m_fileHotReloadQueue;	 // Files ready to be reimported, in the order they became ready.
+		std::unordered_set<FileID> m_queuedHotReloads; // Files in `m_fileHotReloadQueue`.
+		std::chrono::milliseconds m_hotReloadDebounce{ 100 };
 
 		std::function<void(FileID)> m_fileReimportCallback;
+		std::shared_ptr<ReimportBatch> m_reimportBatch; // Reimports in flight. Only accessed from `Tick()`.
+
+		std::unique_ptr<FileWatcher> m_fileWatcher; // Source files of imported files.
+
+		std::unique_ptr<ThreadPool> m_threadPool;
 	};
 
 } // namespace gfs
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
 
 #include "filesystem.hpp"
-#include "file_importer.hpp"
\ No newline at end of file
+#include "archive_patch.hpp"
+#include "file_importer.hpp"
+#include "field_serializer.hpp"
\ No newline at end of file
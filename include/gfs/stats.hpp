@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Statistics collection can be compiled out entirely (CMake option `GFS_ENABLE_STATS`). `GetStats()` then returns zeros.
+#ifndef GFS_ENABLE_STATS
+	#define GFS_ENABLE_STATS 1
+#endif
+
+namespace gfs
+{
+	constexpr bool StatsEnabled = GFS_ENABLE_STATS != 0;
+
+	/**
+	 * Durations bucketed by powers of 2. Bucket `i` counts durations in [2^(i-1), 2^i) nanoseconds, bucket 0 counts 0ns.
+	 */
+	struct LatencyHistogram
+	{
+		static constexpr uint32_t BucketCount = 48; // Up to ~39 hours.
+
+		std::array<uint64_t, BucketCount> Buckets{};
+		uint64_t Count = 0;
+		uint64_t TotalNs = 0;
+		uint64_t MaxNs = 0;
+
+		auto GetMeanNs() const -> uint64_t { return Count != 0 ? TotalNs / Count : 0; }
+
+		/**
+		 * @brief Approximate percentile: the upper bound of the bucket it falls in, capped at the maximum.
+		 * @param percentile 0-100.
+		 * @return
+		 */
+		auto GetPercentileNs(double percentile) const -> uint64_t;
+	};
+
+	struct FilesystemStats
+	{
+		double ElapsedSeconds = 0.0; // Since the filesystem was created or the stats were reset.
+
+		uint64_t BytesRead = 0;	   // File data read from disk, as stored (ie. Compressed).
+		uint64_t BytesWritten = 0; // Whole files, headers & records included.
+		uint64_t FilesRead = 0;
+		uint64_t FilesWritten = 0; // Archives count as one file.
+		uint64_t FileOpens = 0;	   // Files opened for reading or writing, including mount scans.
+		double OpensPerSecond = 0.0;
+
+		uint64_t ImportCacheHits = 0; // Imports & reimports skipped as the source was unchanged.
+		uint64_t ImportCacheMisses = 0;
+		uint64_t MountIndexHits = 0; // Files registered from the mount index without being opened.
+		uint64_t SharedCacheHits = 0; // Reads served from the shared cache, without any I/O or decompression.
+		uint64_t SharedCacheMisses = 0;
+
+		LatencyHistogram ReadFileLatency; // Whole `ReadFile()` calls.
+		LatencyHistogram CompressTime;
+		LatencyHistogram DecompressTime;
+		LatencyHistogram MountScanTime;
+
+		uint32_t HotReloadQueueDepth = 0;	// Files waiting for their quiet period or to be reimported.
+		uint32_t MaxHotReloadQueueDepth = 0;
+	};
+
+} // namespace gfs
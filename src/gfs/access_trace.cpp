@@ -0,0 +1,156 @@
+#include "access_trace_recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace gfs
+{
+	constexpr char ACCESS_TRACE_MAGIC_NUM[4] = { 'g', 'f', 's', 't' }; // GFS Trace
+	constexpr uint16_t ACCESS_TRACE_VERSION = 1;
+
+	constexpr uint64_t ACCESS_TRACE_FLUSH_SIZE = 64 * 1024;
+
+	// Event flags byte.
+	constexpr uint8_t ACCESS_TRACE_WRITE_FLAG = 1 << 0;
+	constexpr uint8_t ACCESS_TRACE_SUCCEEDED_FLAG = 1 << 1;
+
+	namespace
+	{
+		std::atomic<uint32_t> sNextThreadIndex = 0;
+		thread_local const uint32_t tThreadIndex = sNextThreadIndex++;
+	} // namespace
+
+	AccessTraceRecorder::AccessTraceRecorder()
+		: m_buffer(ACCESS_TRACE_FLUSH_SIZE * 2)
+	{
+	}
+
+	AccessTraceRecorder::~AccessTraceRecorder()
+	{
+		Close();
+	}
+
+	bool AccessTraceRecorder::Open(const std::filesystem::path& filename)
+	{
+		std::lock_guard lock(m_mutex);
+		m_stream.open(filename, std::ios::binary | std::ios::trunc);
+		if (!m_stream)
+			return false;
+
+		m_stream.write(ACCESS_TRACE_MAGIC_NUM, sizeof(ACCESS_TRACE_MAGIC_NUM));
+		m_stream.write(reinterpret_cast<const char*>(&ACCESS_TRACE_VERSION), sizeof(ACCESS_TRACE_VERSION));
+		m_startTime = std::chrono::steady_clock::now();
+		m_lastTimestampNs = 0;
+		m_open = bool(m_stream);
+		return m_open;
+	}
+
+	void AccessTraceRecorder::Record(AccessType type,
+		FileID fileId,
+		uint64_t size,
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end,
+		bool succeeded)
+	{
+		const auto timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_startTime).count();
+		const auto durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+		std::lock_guard lock(m_mutex);
+		if (!m_open)
+			return;
+
+		// Events are appended as calls finish, so timestamps are stored as signed deltas to the previous event.
+		uint8_t flags = 0;
+		flags |= type == AccessType::Write ? ACCESS_TRACE_WRITE_FLAG : 0;
+		flags |= succeeded ? ACCESS_TRACE_SUCCEEDED_FLAG : 0;
+		m_buffer.Write(flags);
+		m_buffer.WriteVarUInt(tThreadIndex);
+		m_buffer.WriteVarInt(timestampNs - m_lastTimestampNs);
+		m_buffer.Write(fileId); // Ids are usually hashes, which do not shrink as varints.
+		m_buffer.WriteVarUInt(size);
+		m_buffer.WriteVarUInt(uint64_t(std::max<int64_t>(durationNs, 0)));
+		m_lastTimestampNs = timestampNs;
+
+		if (m_buffer.GetSize() >= ACCESS_TRACE_FLUSH_SIZE)
+			Flush_Internal();
+	}
+
+	bool AccessTraceRecorder::Close()
+	{
+		std::lock_guard lock(m_mutex);
+		if (!m_open)
+			return false;
+
+		Flush_Internal();
+		m_stream.close();
+		m_open = false;
+		return !m_failed && !m_stream.fail();
+	}
+
+	void AccessTraceRecorder::Flush_Internal()
+	{
+		m_stream.write(reinterpret_cast<const char*>(m_buffer.GetData()), std::streamsize(m_buffer.GetSize()));
+		if (!m_stream)
+			m_failed = true;
+
+		m_buffer.SetSize(0);
+		m_buffer.SetPosition(0);
+	}
+
+	bool ReadAccessTrace(const std::filesystem::path& filename, std::vector<AccessTraceEvent>& outEvents)
+	{
+		std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+		if (!stream)
+			return false;
+
+		const auto fileSize = uint64_t(stream.tellg());
+		constexpr uint64_t headerSize = sizeof(ACCESS_TRACE_MAGIC_NUM) + sizeof(ACCESS_TRACE_VERSION);
+		if (fileSize < headerSize)
+			return false;
+
+		// Padded so decoding a truncated last event cannot read past the end of the buffer.
+		constexpr uint64_t maxEventSize = 1 + 10 + 10 + sizeof(FileID) + 10 + 10;
+		ReadOnlyByteBuffer buffer(fileSize + maxEventSize);
+		std::memset(buffer.GetData(), 0, size_t(buffer.GetSize()));
+		stream.seekg(0);
+		stream.read(static_cast<char*>(buffer.GetData()), std::streamsize(fileSize));
+		if (!stream)
+			return false;
+
+		char magicNumber[4];
+		uint16_t version = 0;
+		buffer.Read(sizeof(magicNumber), reinterpret_cast<uint8_t*>(magicNumber));
+		buffer.Read(version);
+		if (std::memcmp(magicNumber, ACCESS_TRACE_MAGIC_NUM, sizeof(magicNumber)) != 0 || version > ACCESS_TRACE_VERSION)
+			return false;
+
+		outEvents.clear();
+		int64_t timestampNs = 0;
+		while (buffer.GetPosition() < fileSize)
+		{
+			uint8_t flags = 0;
+			buffer.Read(flags);
+
+			AccessTraceEvent event{};
+			event.Type = (flags & ACCESS_TRACE_WRITE_FLAG) != 0 ? AccessType::Write : AccessType::Read;
+			event.Succeeded = (flags & ACCESS_TRACE_SUCCEEDED_FLAG) != 0;
+			event.ThreadIndex = uint32_t(buffer.ReadVarUInt());
+			timestampNs += buffer.ReadVarInt();
+			buffer.Read(event.FileId);
+			event.Size = buffer.ReadVarUInt();
+			event.DurationNs = buffer.ReadVarUInt();
+			event.TimestampNs = uint64_t(std::max<int64_t>(timestampNs, 0));
+
+			if (buffer.GetPosition() > fileSize)
+				break; // Truncated.
+			outEvents.push_back(event);
+		}
+
+		std::stable_sort(outEvents.begin(), outEvents.end(), [](const AccessTraceEvent& lhs, const AccessTraceEvent& rhs) {
+			return lhs.TimestampNs < rhs.TimestampNs;
+		});
+		return true;
+	}
+
+} // namespace gfs
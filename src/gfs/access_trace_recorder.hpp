@@ -0,0 +1,86 @@
+#pragma once
+
+#include "gfs/access_trace.hpp"
+#include "gfs/binary_streams.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace gfs
+{
+	/**
+	 * Appends access events to a trace file. Events are encoded into a buffer which is written out whenever it fills up, so
+	 * recording from many threads costs a short lock & a few varints per call.
+	 */
+	class AccessTraceRecorder
+	{
+	public:
+		AccessTraceRecorder();
+		~AccessTraceRecorder(); // Closes the trace if still open.
+
+		bool Open(const std::filesystem::path& filename);
+
+		void Record(AccessType type,
+			FileID fileId,
+			uint64_t size,
+			std::chrono::steady_clock::time_point start,
+			std::chrono::steady_clock::time_point end,
+			bool succeeded);
+
+		/**
+		 * @brief Writes out the remaining events & closes the file. Events recorded afterwards are dropped.
+		 * @return False if any part of the trace failed to write.
+		 */
+		bool Close();
+
+	private:
+		void Flush_Internal();
+
+	private:
+		std::mutex m_mutex;
+		std::ofstream m_stream;
+		WriteOnlyByteBuffer m_buffer;
+		std::chrono::steady_clock::time_point m_startTime;
+		int64_t m_lastTimestampNs = 0;
+		bool m_open = false;
+		bool m_failed = false;
+	};
+
+	/**
+	 * Records one call from construction to destruction, if recording.
+	 */
+	class ScopedAccessTrace
+	{
+	public:
+		ScopedAccessTrace(std::shared_ptr<AccessTraceRecorder> recorder, AccessType type, FileID fileId)
+			: m_recorder(std::move(recorder)),
+			  m_type(type),
+			  m_fileId(fileId)
+		{
+			if (m_recorder)
+				m_start = std::chrono::steady_clock::now();
+		}
+
+		~ScopedAccessTrace()
+		{
+			if (m_recorder)
+				m_recorder->Record(m_type, m_fileId, Size, m_start, std::chrono::steady_clock::now(), Succeeded);
+		}
+
+		ScopedAccessTrace(const ScopedAccessTrace&) = delete;
+		ScopedAccessTrace& operator=(const ScopedAccessTrace&) = delete;
+
+		uint64_t Size = 0;
+		bool Succeeded = false;
+
+	private:
+		std::shared_ptr<AccessTraceRecorder> m_recorder;
+		AccessType m_type;
+		FileID m_fileId;
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+} // namespace gfs
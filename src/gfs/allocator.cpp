@@ -0,0 +1,156 @@
+#include "gfs/allocator.hpp"
+
+#include <cstdint>
+#include <new>
+
+namespace gfs
+{
+	auto GetMemoryCategoryName(MemoryCategory category) -> const char*
+	{
+		switch (category)
+		{
+			case MemoryCategory::General: return "General";
+			case MemoryCategory::FileData: return "FileData";
+			case MemoryCategory::Compression: return "Compression";
+			case MemoryCategory::Registry: return "Registry";
+			default: return "Unknown";
+		}
+	}
+
+	auto DefaultAllocator::Allocate(size_t size, size_t alignment, MemoryCategory /*category*/) -> void*
+	{
+		return ::operator new(size, std::align_val_t(alignment), std::nothrow);
+	}
+
+	void DefaultAllocator::Deallocate(void* ptr, size_t /*size*/, size_t alignment, MemoryCategory /*category*/)
+	{
+		::operator delete(ptr, std::align_val_t(alignment));
+	}
+
+	auto GetDefaultAllocator() -> Allocator*
+	{
+		static DefaultAllocator sAllocator;
+		return &sAllocator;
+	}
+
+	ArenaAllocator::ArenaAllocator(size_t capacity, Allocator* parent)
+		: m_parent(parent != nullptr ? parent : GetDefaultAllocator()),
+		  m_block(static_cast<uint8_t*>(m_parent->Allocate(capacity, alignof(std::max_align_t), MemoryCategory::General))),
+		  m_capacity(m_block != nullptr ? capacity : 0)
+	{
+	}
+
+	ArenaAllocator::~ArenaAllocator()
+	{
+		if (m_block != nullptr)
+			m_parent->Deallocate(m_block, m_capacity, alignof(std::max_align_t), MemoryCategory::General);
+	}
+
+	auto ArenaAllocator::Allocate(size_t size, size_t alignment, MemoryCategory /*category*/) -> void*
+	{
+		const auto base = reinterpret_cast<uintptr_t>(m_block);
+		auto top = m_top.load(std::memory_order_relaxed);
+		while (true)
+		{
+			const auto start = ((base + top + alignment - 1) & ~uintptr_t(alignment - 1)) - base;
+			if (start > m_capacity || size > m_capacity - start)
+				return nullptr;
+
+			if (m_top.compare_exchange_weak(top, start + size, std::memory_order_relaxed))
+				return m_block + start;
+		}
+	}
+
+	void ArenaAllocator::Deallocate(void* ptr, size_t size, size_t /*alignment*/, MemoryCategory /*category*/)
+	{
+		if (ptr == nullptr)
+			return;
+
+		// Only the most recent allocation can be given back. Padding before it stays used until `Reset()`.
+		const auto start = size_t(static_cast<uint8_t*>(ptr) - m_block);
+		auto expected = start + size;
+		m_top.compare_exchange_strong(expected, start, std::memory_order_relaxed);
+	}
+
+	void ArenaAllocator::Reset()
+	{
+		m_top.store(0, std::memory_order_relaxed);
+	}
+
+	TrackingAllocator::TrackingAllocator(Allocator* parent)
+		: m_parent(parent != nullptr ? parent : GetDefaultAllocator())
+	{
+	}
+
+	auto TrackingAllocator::Allocate(size_t size, size_t alignment, MemoryCategory category) -> void*
+	{
+		auto& counters = m_categories[size_t(category)];
+		auto* ptr = m_parent->Allocate(size, alignment, category);
+		if (ptr == nullptr)
+		{
+			counters.FailedAllocations.fetch_add(1, std::memory_order_relaxed);
+			m_total.FailedAllocations.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		counters.Add(size);
+		m_total.Add(size);
+		return ptr;
+	}
+
+	void TrackingAllocator::Deallocate(void* ptr, size_t size, size_t alignment, MemoryCategory category)
+	{
+		if (ptr == nullptr)
+			return;
+
+		m_parent->Deallocate(ptr, size, alignment, category);
+		m_categories[size_t(category)].Remove(size);
+		m_total.Remove(size);
+	}
+
+	auto TrackingAllocator::GetUsage(MemoryCategory category) const -> MemoryUsage
+	{
+		return m_categories[size_t(category)].Snapshot();
+	}
+
+	auto TrackingAllocator::GetTotalUsage() const -> MemoryUsage
+	{
+		return m_total.Snapshot();
+	}
+
+	void TrackingAllocator::ResetPeaks()
+	{
+		for (auto& counters : m_categories)
+			counters.PeakBytes.store(counters.CurrentBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_total.PeakBytes.store(m_total.CurrentBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	void TrackingAllocator::Counters::Add(uint64_t size)
+	{
+		const auto current = CurrentBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		auto peak = PeakBytes.load(std::memory_order_relaxed);
+		while (current > peak && !PeakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+		{
+		}
+		LiveAllocations.fetch_add(1, std::memory_order_relaxed);
+		TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void TrackingAllocator::Counters::Remove(uint64_t size)
+	{
+		CurrentBytes.fetch_sub(size, std::memory_order_relaxed);
+		LiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	auto TrackingAllocator::Counters::Snapshot() const -> MemoryUsage
+	{
+		MemoryUsage usage{};
+		usage.CurrentBytes = CurrentBytes.load(std::memory_order_relaxed);
+		usage.PeakBytes = PeakBytes.load(std::memory_order_relaxed);
+		usage.LiveAllocations = LiveAllocations.load(std::memory_order_relaxed);
+		usage.TotalAllocations = TotalAllocations.load(std::memory_order_relaxed);
+		usage.FailedAllocations = FailedAllocations.load(std::memory_order_relaxed);
+		return usage;
+	}
+
+} // namespace gfs
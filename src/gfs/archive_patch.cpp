@@ -0,0 +1,583 @@
+#include "gfs/archive_patch.hpp"
+
+#include "gfs/filesystem.hpp"
+#include "file_io.hpp"
+#include "format.hpp"
+#include "hash.hpp"
+#include "memory_mount.hpp"
+
+#include <lz4.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace gfs
+{
+	constexpr char FS_PATCH_MAGIC_NUM[4] = { 'g', 'f', 's', 'p' }; // GFS Patch
+	constexpr uint16_t FS_PATCH_VERSION = 1;
+
+	constexpr uint32_t FS_PATCH_BLOCK_SIZE = 1024;		  // Granularity of block level diffs.
+	constexpr uint32_t FS_PATCH_CHUNK_SIZE = 1024 * 1024; // Max data per add & bytes copied at a time when applying.
+
+	enum class PatchOp : uint8_t
+	{
+		Copy, // Range of the old archive.
+		Add,  // Data stored in the patch.
+		End,
+	};
+
+	struct PatchHeader
+	{
+		uint64_t OldSize;
+		uint64_t OldHash;
+		uint64_t NewSize;
+		uint64_t NewHash;
+	};
+
+	struct PatchCopy
+	{
+		uint64_t Dest;
+		uint64_t Src;
+		uint64_t Size;
+	};
+
+	struct PatchAdd
+	{
+		uint64_t Dest;
+		uint64_t Size;
+	};
+
+	// Where each range of the new archive comes from, in ascending order of destination. Adjacent ranges are merged.
+	struct PatchPlan
+	{
+		std::vector<PatchCopy> Copies;
+		std::vector<PatchAdd> Adds;
+
+		void Copy(uint64_t dest, uint64_t src, uint64_t size)
+		{
+			if (size == 0)
+				return;
+
+			if (!Copies.empty() && Copies.back().Dest + Copies.back().Size == dest && Copies.back().Src + Copies.back().Size == src)
+				Copies.back().Size += size;
+			else
+				Copies.push_back({ dest, src, size });
+		}
+
+		void Add(uint64_t dest, uint64_t size)
+		{
+			if (size == 0)
+				return;
+
+			if (!Adds.empty() && Adds.back().Dest + Adds.back().Size == dest)
+				Adds.back().Size += size;
+			else
+				Adds.push_back({ dest, size });
+		}
+	};
+
+	// rsync's rolling checksum. Sliding it along by a byte is cheap, so old blocks are found at any offset of the new data.
+	struct RollingChecksum
+	{
+		uint32_t A = 0;
+		uint32_t B = 0;
+
+		void Reset(const uint8_t* data, uint32_t size)
+		{
+			A = 0;
+			B = 0;
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				A += data[i];
+				B += (size - i) * data[i];
+			}
+		}
+
+		void Roll(uint8_t out, uint8_t in, uint32_t size)
+		{
+			A = A - out + in;
+			B = B - size * out + A;
+		}
+
+		auto Get() const -> uint32_t { return (A & 0xFFFF) | (B << 16); }
+	};
+
+	template <typename T>
+	static void WriteValue(std::ostream& stream, const T& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	static bool ReadValue(std::istream& stream, T& value)
+	{
+		stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+		return bool(stream);
+	}
+
+	static bool ReadWholeFile(const std::filesystem::path& filename, std::vector<uint8_t>& outData)
+	{
+		std::error_code error;
+		const auto fileSize = std::filesystem::file_size(filename, error);
+		std::ifstream stream(filename, std::ios::binary);
+		if (error || !stream)
+			return false;
+
+		outData.resize(size_t(fileSize));
+		stream.read(reinterpret_cast<char*>(outData.data()), std::streamsize(fileSize));
+		return uint64_t(stream.gcount()) == fileSize;
+	}
+
+	static bool HashStream(std::istream& stream, uint64_t size, uint64_t& outHash)
+	{
+		stream.clear();
+		stream.seekg(0);
+
+		Hasher64 hasher;
+		std::vector<char> chunk(FS_PATCH_CHUNK_SIZE);
+		for (uint64_t offset = 0; offset < size;)
+		{
+			const auto chunkSize = std::min<uint64_t>(size - offset, chunk.size());
+			stream.read(chunk.data(), std::streamsize(chunkSize));
+			if (uint64_t(stream.gcount()) != chunkSize)
+				return false;
+
+			hasher.Update(chunk.data(), size_t(chunkSize));
+			offset += chunkSize;
+		}
+		outHash = hasher.Finish();
+		return true;
+	}
+
+	// Records of a gfs file & where the data after them starts. False if not a gfs file.
+	static bool ReadArchiveEntries(const std::vector<uint8_t>& data, uint64_t& outDataStart, std::vector<File>& outFiles)
+	{
+		MemoryStreamBuffer buffer(data.data(), data.size());
+		std::istream stream(&buffer);
+
+		FormatHeader header{};
+		stream >> header;
+		if (!stream || std::memcmp(header.MagicNumber, FS_FORMAT_MAGIC_NUM, sizeof(header.MagicNumber)) != 0 || header.FormatVersion > FS_FORMAT_VERSION ||
+			uint64_t(header.FileCount) * FS_FORMAT_MIN_RECORD_SIZE > data.size())
+			return false;
+
+		outFiles.resize(header.FileCount);
+		for (auto& file : outFiles)
+		{
+			stream >> file;
+			if (!stream || uint64_t(file.Offset) + file.CompressedSize > data.size())
+				return false;
+		}
+		outDataStart = uint64_t(stream.tellg());
+		return true;
+	}
+
+	// Plans `newData[newOffset, newOffset + newSize)` from the old data in that range of `oldData` where it can.
+	static void DiffBlocks(const std::vector<uint8_t>& oldData,
+		uint64_t oldOffset,
+		uint64_t oldSize,
+		const std::vector<uint8_t>& newData,
+		uint64_t newOffset,
+		uint64_t newSize,
+		PatchPlan& plan)
+	{
+		const auto* oldPtr = oldData.data() + oldOffset;
+		const auto* newPtr = newData.data() + newOffset;
+		if (oldSize < FS_PATCH_BLOCK_SIZE || newSize < FS_PATCH_BLOCK_SIZE)
+		{
+			if (oldSize == newSize && newSize != 0 && std::memcmp(oldPtr, newPtr, size_t(newSize)) == 0)
+				plan.Copy(newOffset, oldOffset, newSize);
+			else
+				plan.Add(newOffset, newSize);
+			return;
+		}
+
+		std::unordered_map<uint32_t, std::vector<uint32_t>> oldBlocks; // Checksum -> Block indices.
+		const auto blockCount = oldSize / FS_PATCH_BLOCK_SIZE;
+		oldBlocks.reserve(size_t(blockCount));
+		RollingChecksum checksum;
+		for (uint64_t block = 0; block < blockCount; ++block)
+		{
+			checksum.Reset(oldPtr + block * FS_PATCH_BLOCK_SIZE, FS_PATCH_BLOCK_SIZE);
+			oldBlocks[checksum.Get()].push_back(uint32_t(block));
+		}
+
+		uint64_t position = 0;
+		uint64_t literalStart = 0; // Start of the new data not matched yet.
+		checksum.Reset(newPtr, FS_PATCH_BLOCK_SIZE);
+		while (position + FS_PATCH_BLOCK_SIZE <= newSize)
+		{
+			bool matched = false;
+			uint64_t matchOffset = 0;
+			const auto it = oldBlocks.find(checksum.Get());
+			if (it != oldBlocks.end())
+			{
+				for (const auto block : it->second)
+				{
+					matchOffset = uint64_t(block) * FS_PATCH_BLOCK_SIZE;
+					if (std::memcmp(newPtr + position, oldPtr + matchOffset, FS_PATCH_BLOCK_SIZE) == 0)
+					{
+						matched = true;
+						break;
+					}
+				}
+			}
+
+			if (!matched)
+			{
+				if (position + FS_PATCH_BLOCK_SIZE < newSize)
+					checksum.Roll(newPtr[position], newPtr[position + FS_PATCH_BLOCK_SIZE], FS_PATCH_BLOCK_SIZE);
+				++position;
+				continue;
+			}
+
+			// Grown in both directions, so unchanged data around an edit is copied rather than stored.
+			uint64_t matchSize = FS_PATCH_BLOCK_SIZE;
+			while (position > literalStart && matchOffset > 0 && newPtr[position - 1] == oldPtr[matchOffset - 1])
+			{
+				--position;
+				--matchOffset;
+				++matchSize;
+			}
+			while (position + matchSize < newSize && matchOffset + matchSize < oldSize && newPtr[position + matchSize] == oldPtr[matchOffset + matchSize])
+				++matchSize;
+
+			plan.Add(newOffset + literalStart, position - literalStart);
+			plan.Copy(newOffset + position, oldOffset + matchOffset, matchSize);
+			position += matchSize;
+			literalStart = position;
+			if (position + FS_PATCH_BLOCK_SIZE <= newSize)
+				checksum.Reset(newPtr + position, FS_PATCH_BLOCK_SIZE);
+		}
+		plan.Add(newOffset + literalStart, newSize - literalStart);
+	}
+
+	static void PlanPatch(const std::vector<uint8_t>& oldData, const std::vector<uint8_t>& newData, PatchPlan& plan, ArchivePatchInfo& info)
+	{
+		uint64_t oldDataStart = 0;
+		uint64_t newDataStart = 0;
+		std::vector<File> oldFiles;
+		std::vector<File> newFiles;
+		if (!ReadArchiveEntries(oldData, oldDataStart, oldFiles) || !ReadArchiveEntries(newData, newDataStart, newFiles))
+		{
+			DiffBlocks(oldData, 0, oldData.size(), newData, 0, newData.size(), plan);
+			return;
+		}
+
+		// Header & records. Data offsets move, but paths & metadata are mostly unchanged.
+		DiffBlocks(oldData, 0, oldDataStart, newData, 0, newDataStart, plan);
+
+		std::unordered_map<FileID, const File*> oldFileMap;
+		for (const auto& file : oldFiles)
+			oldFileMap[file.FileId] = &file;
+
+		std::sort(newFiles.begin(), newFiles.end(), [](const File& lhs, const File& rhs) { return lhs.Offset < rhs.Offset; });
+		std::unordered_set<FileID> newFileIds;
+		uint64_t plannedEnd = newDataStart;
+		for (const auto& file : newFiles)
+		{
+			newFileIds.insert(file.FileId);
+			if (file.Offset < plannedEnd)
+				continue; // Overlaps the previous entry, so is already planned.
+
+			plan.Add(plannedEnd, file.Offset - plannedEnd); // Anything between entries.
+			plannedEnd = uint64_t(file.Offset) + file.CompressedSize;
+
+			const auto it = oldFileMap.find(file.FileId);
+			if (it == oldFileMap.end())
+			{
+				plan.Add(file.Offset, file.CompressedSize);
+				++info.AddedEntries;
+				continue;
+			}
+
+			const auto& oldFile = *it->second;
+			if (oldFile.CompressedSize == file.CompressedSize &&
+				std::memcmp(oldData.data() + oldFile.Offset, newData.data() + file.Offset, file.CompressedSize) == 0)
+			{
+				plan.Copy(file.Offset, oldFile.Offset, file.CompressedSize);
+				++info.UnchangedEntries;
+				continue;
+			}
+
+			DiffBlocks(oldData, oldFile.Offset, oldFile.CompressedSize, newData, file.Offset, file.CompressedSize, plan);
+			++info.ChangedEntries;
+		}
+		plan.Add(plannedEnd, newData.size() - plannedEnd);
+
+		for (const auto& file : oldFiles)
+		{
+			if (newFileIds.count(file.FileId) == 0)
+				++info.RemovedEntries;
+		}
+	}
+
+	// Orders copies (sorted by destination) so applying them in place never overwrites data a later copy still reads. Copies
+	// caught in a cycle are turned into adds, as in Burns & Long's in-place reconstruction. Adds are applied after all copies.
+	static auto OrderCopiesForInPlace(const std::vector<PatchCopy>& copies, std::vector<PatchAdd>& adds) -> std::vector<PatchCopy>
+	{
+		const auto count = uint32_t(copies.size());
+
+		// Copy i must run before the copies whose destination overlaps its source.
+		std::vector<std::vector<uint32_t>> successors(count);
+		std::vector<uint32_t> predecessorCounts(count, 0);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const auto& copy = copies[i];
+			auto it = std::partition_point(copies.begin(), copies.end(), [&](const PatchCopy& other) { return other.Dest + other.Size <= copy.Src; });
+			for (; it != copies.end() && it->Dest < copy.Src + copy.Size; ++it)
+			{
+				const auto j = uint32_t(it - copies.begin());
+				if (j == i)
+					continue; // Overlapping itself is handled when applying.
+
+				successors[i].push_back(j);
+				++predecessorCounts[j];
+			}
+		}
+
+		std::vector<uint32_t> ready;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (predecessorCounts[i] == 0)
+				ready.push_back(i);
+		}
+
+		std::vector<PatchCopy> ordered;
+		ordered.reserve(count);
+		std::vector<bool> done(count, false);
+		uint32_t doneCount = 0;
+		uint32_t cycleCursor = 0;
+		auto complete = [&](uint32_t index) {
+			done[index] = true;
+			++doneCount;
+			for (const auto successor : successors[index])
+			{
+				if (--predecessorCounts[successor] == 0 && !done[successor])
+					ready.push_back(successor);
+			}
+		};
+
+		while (doneCount < count)
+		{
+			if (ready.empty())
+			{
+				// Every remaining copy waits on another, so one stops reading the old data by storing its data instead.
+				while (done[cycleCursor])
+					++cycleCursor;
+				adds.push_back({ copies[cycleCursor].Dest, copies[cycleCursor].Size });
+				complete(cycleCursor);
+				continue;
+			}
+
+			const auto index = ready.back();
+			ready.pop_back();
+			ordered.push_back(copies[index]);
+			complete(index);
+		}
+		return ordered;
+	}
+
+	bool CreateArchivePatch(const std::filesystem::path& oldArchive,
+		const std::filesystem::path& newArchive,
+		const std::filesystem::path& patchFilename,
+		ArchivePatchInfo* outInfo)
+	{
+		std::vector<uint8_t> oldData;
+		std::vector<uint8_t> newData;
+		if (!ReadWholeFile(oldArchive, oldData) || !ReadWholeFile(newArchive, newData))
+			return false;
+
+		ArchivePatchInfo info{};
+		info.OldSize = oldData.size();
+		info.NewSize = newData.size();
+
+		PatchPlan plan;
+		PlanPatch(oldData, newData, plan, info);
+		auto adds = std::move(plan.Adds);
+		const auto copies = OrderCopiesForInPlace(plan.Copies, adds);
+		std::sort(adds.begin(), adds.end(), [](const PatchAdd& lhs, const PatchAdd& rhs) { return lhs.Dest < rhs.Dest; });
+
+		std::ofstream stream(patchFilename, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+
+		stream.write(FS_PATCH_MAGIC_NUM, sizeof(FS_PATCH_MAGIC_NUM));
+		WriteValue(stream, FS_PATCH_VERSION);
+		WriteValue(stream, PatchHeader{ info.OldSize, Hasher64::Hash(oldData.data(), oldData.size()), info.NewSize, Hasher64::Hash(newData.data(), newData.size()) });
+
+		for (const auto& copy : copies)
+		{
+			WriteValue(stream, PatchOp::Copy);
+			WriteValue(stream, copy);
+			info.CopiedBytes += copy.Size;
+		}
+
+		// Split into chunks so applying (& decompressing) a patch needs a fixed amount of memory.
+		std::vector<char> compressedData(size_t(LZ4_compressBound(FS_PATCH_CHUNK_SIZE)));
+		for (const auto& add : adds)
+		{
+			info.AddedBytes += add.Size;
+			for (uint64_t offset = 0; offset < add.Size; offset += FS_PATCH_CHUNK_SIZE)
+			{
+				const auto size = std::min<uint64_t>(add.Size - offset, FS_PATCH_CHUNK_SIZE);
+				const auto* data = reinterpret_cast<const char*>(newData.data() + add.Dest + offset);
+				const auto compressedSize = LZ4_compress_default(data, compressedData.data(), int32_t(size), int32_t(compressedData.size()));
+
+				// Incompressible data (eg. Compressed entries) is stored as is (equal sizes mark data as uncompressed).
+				const bool isCompressed = compressedSize > 0 && uint64_t(compressedSize) < size;
+				const uint64_t storedSize = isCompressed ? uint64_t(compressedSize) : size;
+				WriteValue(stream, PatchOp::Add);
+				WriteValue(stream, PatchAdd{ add.Dest + offset, size });
+				WriteValue(stream, storedSize);
+				stream.write(isCompressed ? compressedData.data() : data, std::streamsize(storedSize));
+			}
+		}
+		WriteValue(stream, PatchOp::End);
+
+		stream.flush();
+		if (!stream)
+			return false;
+
+		info.PatchSize = uint64_t(stream.tellp());
+		if (outInfo != nullptr)
+			*outInfo = info;
+		return true;
+	}
+
+	static bool ReadPatchHeader(std::istream& patch, PatchHeader& outHeader)
+	{
+		char magicNumber[sizeof(FS_PATCH_MAGIC_NUM)]{};
+		uint16_t version = 0;
+		patch.read(magicNumber, sizeof(magicNumber));
+		if (!ReadValue(patch, version) || std::memcmp(magicNumber, FS_PATCH_MAGIC_NUM, sizeof(magicNumber)) != 0 || version > FS_PATCH_VERSION)
+			return false;
+
+		return ReadValue(patch, outHeader);
+	}
+
+	// Runs the operations of a patch, copying from `source` & writing to `target` (The same stream when patching in place).
+	static bool ApplyPatchOps(std::istream& patch, const PatchHeader& header, std::istream& source, std::ostream& target)
+	{
+		std::vector<char> buffer(FS_PATCH_CHUNK_SIZE);
+		std::vector<char> compressedData(size_t(LZ4_compressBound(FS_PATCH_CHUNK_SIZE)));
+		while (true)
+		{
+			PatchOp op{};
+			if (!ReadValue(patch, op))
+				return false;
+
+			if (op == PatchOp::End)
+				return true;
+
+			if (op == PatchOp::Copy)
+			{
+				PatchCopy copy{};
+				if (!ReadValue(patch, copy) || copy.Size > header.OldSize || copy.Src > header.OldSize - copy.Size || copy.Size > header.NewSize ||
+					copy.Dest > header.NewSize - copy.Size)
+					return false;
+
+				// A copy overlapping its own destination further along is copied back to front, like `memmove()`.
+				const bool backward = copy.Src < copy.Dest && copy.Dest < copy.Src + copy.Size;
+				for (uint64_t copied = 0; copied < copy.Size;)
+				{
+					const auto chunkSize = std::min<uint64_t>(copy.Size - copied, buffer.size());
+					const auto chunkOffset = backward ? copy.Size - copied - chunkSize : copied;
+					source.seekg(std::streamoff(copy.Src + chunkOffset));
+					source.read(buffer.data(), std::streamsize(chunkSize));
+					target.seekp(std::streamoff(copy.Dest + chunkOffset));
+					target.write(buffer.data(), std::streamsize(chunkSize));
+					if (!source || !target)
+						return false;
+					copied += chunkSize;
+				}
+			}
+			else if (op == PatchOp::Add)
+			{
+				PatchAdd add{};
+				uint64_t storedSize = 0;
+				if (!ReadValue(patch, add) || !ReadValue(patch, storedSize) || add.Size > FS_PATCH_CHUNK_SIZE || storedSize > add.Size ||
+					add.Dest > header.NewSize - add.Size)
+					return false;
+
+				if (storedSize == add.Size)
+					patch.read(buffer.data(), std::streamsize(add.Size));
+				else
+				{
+					patch.read(compressedData.data(), std::streamsize(storedSize));
+					if (!patch ||
+						LZ4_decompress_safe(compressedData.data(), buffer.data(), int32_t(storedSize), int32_t(add.Size)) != int32_t(add.Size))
+						return false;
+				}
+
+				target.seekp(std::streamoff(add.Dest));
+				target.write(buffer.data(), std::streamsize(add.Size));
+				if (!patch || !target)
+					return false;
+			}
+			else
+				return false;
+		}
+	}
+
+	bool ApplyArchivePatch(const std::filesystem::path& archive, std::istream& patch, const std::filesystem::path& outputArchive)
+	{
+		PatchHeader header{};
+		if (!ReadPatchHeader(patch, header))
+			return false;
+
+		std::error_code error;
+		uint64_t hash = 0;
+		std::ifstream source(archive, std::ios::binary);
+		if (std::filesystem::file_size(archive, error) != header.OldSize || error || !source || !HashStream(source, header.OldSize, hash) ||
+			hash != header.OldHash)
+			return false;
+
+		const auto tempFilename = MakeTempFilename(outputArchive);
+		bool succeeded = false;
+		{
+			std::fstream target(tempFilename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			succeeded = target && ApplyPatchOps(patch, header, source, target) && HashStream(target, header.NewSize, hash) && hash == header.NewHash;
+		}
+
+		if (succeeded)
+			std::filesystem::rename(tempFilename, outputArchive, error);
+		if (!succeeded || error)
+		{
+			std::filesystem::remove(tempFilename, error);
+			return false;
+		}
+		return true;
+	}
+
+	bool ApplyArchivePatchInPlace(const std::filesystem::path& archive, std::istream& patch)
+	{
+		PatchHeader header{};
+		if (!ReadPatchHeader(patch, header))
+			return false;
+
+		std::error_code error;
+		uint64_t hash = 0;
+		{
+			std::fstream file(archive, std::ios::in | std::ios::out | std::ios::binary);
+			if (std::filesystem::file_size(archive, error) != header.OldSize || error || !file || !HashStream(file, header.OldSize, hash) ||
+				hash != header.OldHash)
+				return false;
+
+			if (!ApplyPatchOps(patch, header, file, file))
+				return false;
+		}
+
+		std::filesystem::resize_file(archive, header.NewSize, error); // Smaller versions leave old data at the end.
+		if (error)
+			return false;
+
+		std::ifstream file(archive, std::ios::binary);
+		return HashStream(file, header.NewSize, hash) && hash == header.NewHash;
+	}
+
+} // namespace gfs
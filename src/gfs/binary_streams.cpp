@@ -1,9 +1,13 @@
 #include "gfs/binary_streams.hpp"
 
+#include <cstddef>
 #include <cstring>
+#include <new>
 
 namespace gfs
 {
+    constexpr size_t BUFFER_ALIGNMENT = alignof(std::max_align_t); // Matches `new[]`, which the buffers used to allocate with.
+
     static auto NextPowerOf2(uint64_t value) -> uint64_t
     {
         value--;
@@ -17,8 +21,19 @@ namespace gfs
         return value;
     }
 
-    ReadOnlyByteBuffer::ReadOnlyByteBuffer(uint64_t size)
-        : m_buffer(new uint8_t[size]),
+    ReadOnlyByteBuffer::ReadOnlyByteBuffer(uint64_t size, Allocator* allocator, MemoryCategory category)
+        : m_allocator(allocator != nullptr ? allocator : GetDefaultAllocator()),
+        m_category(category),
+        m_buffer(static_cast<uint8_t*>(m_allocator->Allocate(size_t(size), BUFFER_ALIGNMENT, category))),
+        m_size(m_buffer != nullptr ? size : 0),
+        m_position(0)
+    {
+    }
+
+    ReadOnlyByteBuffer::ReadOnlyByteBuffer(const void* data, uint64_t size)
+        : m_allocator(nullptr),
+        m_category(MemoryCategory::General),
+        m_buffer(const_cast<uint8_t*>(static_cast<const uint8_t*>(data))),
         m_size(size),
         m_position(0)
     {
@@ -26,7 +41,8 @@ namespace gfs
 
     ReadOnlyByteBuffer::~ReadOnlyByteBuffer()
     {
-        delete[] m_buffer;
+        if (m_allocator != nullptr) // Not owned when reading in place.
+            m_allocator->Deallocate(m_buffer, size_t(m_size), BUFFER_ALIGNMENT, m_category);
     }
 
     void ReadOnlyByteBuffer::Read(uint64_t size, uint8_t* data)
@@ -35,6 +51,37 @@ namespace gfs
         m_position += size;
     }
 
+    void ReadOnlyByteBuffer::AlignPosition(uint64_t alignment)
+    {
+        m_position = (m_position + alignment - 1) & ~(alignment - 1);
+    }
+
+    auto ReadOnlyByteBuffer::ReadVarUInt() -> uint64_t
+    {
+        uint64_t value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7)
+        {
+            const auto byte = m_buffer[m_position++];
+            value |= uint64_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                break;
+        }
+        return value;
+    }
+
+    auto ReadOnlyByteBuffer::ReadDeltaToken(uint64_t& run) -> uint64_t
+    {
+        const auto token = m_buffer[m_position++];
+
+        // The first byte holds the run flag & the low 6 bits of the delta, the rest is a regular varint.
+        auto zigzagDelta = uint64_t(token >> 1) & 0x3F;
+        if (token & 0x80)
+            zigzagDelta |= ReadVarUInt() << 6;
+
+        run = (token & 1) ? ReadVarUInt() : 0;
+        return zigzagDelta;
+    }
+
     template<>
     void ReadOnlyByteBuffer::Read(std::string& value)
     {
@@ -44,17 +91,21 @@ namespace gfs
         Read(sizeof(std::string::value_type) * strLen, reinterpret_cast<uint8_t*>(value.data()));
     }
 
-    WriteOnlyByteBuffer::WriteOnlyByteBuffer(uint64_t initialCapacity)
-        : m_buffer(new uint8_t[initialCapacity]),
+    WriteOnlyByteBuffer::WriteOnlyByteBuffer(uint64_t initialCapacity, Allocator* allocator, MemoryCategory category)
+        : m_allocator(allocator != nullptr ? allocator : GetDefaultAllocator()),
+        m_category(category),
+        m_buffer(static_cast<uint8_t*>(m_allocator->Allocate(size_t(initialCapacity), BUFFER_ALIGNMENT, category))),
         m_capacity(initialCapacity),
         m_size(0),
         m_position(0)
     {
+        if (m_buffer == nullptr)
+            throw std::bad_alloc();
     }
 
     WriteOnlyByteBuffer::~WriteOnlyByteBuffer()
     {
-        delete[] m_buffer;
+        m_allocator->Deallocate(m_buffer, size_t(m_capacity), BUFFER_ALIGNMENT, m_category);
     }
 
     void WriteOnlyByteBuffer::SetCapacity(uint64_t newCapacity)
@@ -62,9 +113,11 @@ namespace gfs
         if (newCapacity <= m_capacity)
             return;
 
-        uint8_t* newBuffer = new uint8_t[newCapacity];
+        auto* newBuffer = static_cast<uint8_t*>(m_allocator->Allocate(size_t(newCapacity), BUFFER_ALIGNMENT, m_category));
+        if (newBuffer == nullptr)
+            throw std::bad_alloc();
         std::memcpy(newBuffer, m_buffer, m_size);
-        delete[] m_buffer;
+        m_allocator->Deallocate(m_buffer, size_t(m_capacity), BUFFER_ALIGNMENT, m_category);
 
         m_buffer = newBuffer;
         m_capacity = newCapacity;
@@ -88,7 +141,7 @@ namespace gfs
     void WriteOnlyByteBuffer::Write(uint64_t size, const uint8_t* data)
     {
         if (m_position + size > m_capacity)
-            SetCapacity(NextPowerOf2(m_capacity));
+            SetCapacity(NextPowerOf2(m_position + size));
 
         std::memcpy(&m_buffer[m_position], data, size);
 
@@ -97,6 +150,50 @@ namespace gfs
             m_size = m_position;
     }
 
+    void WriteOnlyByteBuffer::AlignPosition(uint64_t alignment)
+    {
+        static constexpr uint8_t sZeros[64]{};
+
+        auto padding = ((m_position + alignment - 1) & ~(alignment - 1)) - m_position;
+        while (padding != 0)
+        {
+            const auto size = padding < sizeof(sZeros) ? padding : sizeof(sZeros);
+            Write(size, sZeros);
+            padding -= size;
+        }
+    }
+
+    void WriteOnlyByteBuffer::WriteVarUInt(uint64_t value)
+    {
+        static constexpr uint64_t MaxVarUIntSize = 10;
+        if (m_position + MaxVarUIntSize > m_capacity)
+            SetCapacity(NextPowerOf2(m_position + MaxVarUIntSize));
+
+        // Encode straight into the buffer.
+        auto* out = m_buffer + m_position;
+        while (value >= 0x80)
+        {
+            *out++ = uint8_t(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = uint8_t(value);
+
+        m_position = uint64_t(out - m_buffer);
+        if (m_position > m_size)
+            m_size = m_position;
+    }
+
+    void WriteOnlyByteBuffer::WriteDeltaToken(uint64_t zigzagDelta, uint64_t run)
+    {
+        const auto remaining = zigzagDelta >> 6;
+        const auto token = uint8_t(((zigzagDelta & 0x3F) << 1) | (run != 0 ? 1 : 0) | (remaining != 0 ? 0x80 : 0));
+        Write(token);
+        if (remaining != 0)
+            WriteVarUInt(remaining);
+        if (run != 0)
+            WriteVarUInt(run);
+    }
+
     template<>
     void WriteOnlyByteBuffer::Write(const std::string& value)
     {
@@ -0,0 +1,167 @@
+#include "directory_mount.hpp"
+
+#include "stats_collector.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <optional>
+
+namespace gfs
+{
+	namespace
+	{
+		class DirectoryMountFile : public MountFile
+		{
+		public:
+			DirectoryMountFile(std::filesystem::path filename, StatsCollector* stats) : m_filename(std::move(filename)), m_stats(stats) {}
+
+			auto GetResident(uint64_t /*offset*/, uint64_t /*size*/) const -> const uint8_t* override { return nullptr; }
+
+			auto Read(uint64_t offset, uint64_t size, uint8_t* outData) -> uint64_t override
+			{
+				auto& stream = GetStream();
+				stream.seekg(std::streamoff(offset));
+				stream.read(reinterpret_cast<char*>(outData), std::streamsize(size));
+				return uint64_t(stream.gcount());
+			}
+
+			auto ReadUncached(uint64_t offset, uint64_t size, AlignedBuffer& buffer, Allocator* allocator, MemoryCategory category)
+				-> const uint8_t* override
+			{
+				m_stats->FileOpens.Add();
+				return gfs::ReadFileUncached(m_filename, offset, size, buffer, allocator, category);
+			}
+
+			auto GetVersion() const -> uint64_t override { return GetFileVersion(m_filename); }
+
+			auto GetStream() -> std::istream& override
+			{
+				// Opened on first use, as uncached & shared reads may not need it.
+				if (!m_stream)
+				{
+					m_stream.emplace(m_filename, std::ios::binary);
+					m_stream->unsetf(std::ios::skipws);
+					m_stats->FileOpens.Add();
+				}
+				return *m_stream;
+			}
+
+		private:
+			std::filesystem::path m_filename;
+			StatsCollector* m_stats;
+			std::optional<std::ifstream> m_stream;
+		};
+
+		class DirectoryStagedWrite : public StagedWrite
+		{
+		public:
+			DirectoryStagedWrite(std::filesystem::path filename, std::filesystem::path tempFilename, bool synced)
+				: m_filename(std::move(filename)),
+				  m_tempFilename(std::move(tempFilename)),
+				  m_synced(synced)
+			{
+			}
+
+			bool IsSynced() const override { return m_synced; }
+
+			bool Sync() override
+			{
+				m_synced = SyncFile(m_tempFilename);
+				return m_synced;
+			}
+
+			bool Commit() override
+			{
+				std::error_code error;
+				std::filesystem::rename(m_tempFilename, m_filename, error);
+				if (error)
+				{
+					Discard();
+					return false;
+				}
+				return true;
+			}
+
+			void Discard() override
+			{
+				std::error_code error;
+				std::filesystem::remove(m_tempFilename, error);
+			}
+
+			auto GetCommitDirectory() const -> std::filesystem::path override { return m_filename.parent_path(); }
+
+		private:
+			std::filesystem::path m_filename;
+			std::filesystem::path m_tempFilename;
+			bool m_synced;
+		};
+	} // namespace
+
+	DirectoryMount::DirectoryMount(std::filesystem::path rootDir, StatsCollector* stats) : m_rootDir(std::move(rootDir)), m_stats(stats)
+	{
+	}
+
+	auto DirectoryMount::Open(const std::string& mountRelPath) const -> std::unique_ptr<MountFile>
+	{
+		return std::make_unique<DirectoryMountFile>(m_rootDir / mountRelPath, m_stats);
+	}
+
+	auto DirectoryMount::Stage(const std::string& mountRelPath, const std::vector<WriteChunk>& chunks, bool sync) -> std::shared_ptr<StagedWrite>
+	{
+		auto filename = m_rootDir / mountRelPath;
+		auto tempFilename = MakeTempFilename(filename);
+		m_stats->FileOpens.Add();
+		if (!WriteFileChunks(tempFilename, chunks, sync))
+		{
+			std::error_code error;
+			std::filesystem::remove(tempFilename, error);
+			return nullptr;
+		}
+		return std::make_shared<DirectoryStagedWrite>(std::move(filename), std::move(tempFilename), sync);
+	}
+
+	auto DirectoryMount::StageCopy(const std::string& /*mountRelPath*/, std::istream& /*stream*/, uint64_t /*size*/, uint64_t /*alignedOffset*/)
+		-> std::shared_ptr<StagedWrite>
+	{
+		return nullptr; // Files on disk are already where they are read from.
+	}
+
+	void DirectoryMount::CreateDirectories(const std::filesystem::path& mountRelDir)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_rootDir / mountRelDir, error);
+	}
+
+	void DirectoryMount::Enumerate(const EnumerateCallback& callback) const
+	{
+		for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(m_rootDir))
+		{
+			if (!dirEntry.is_regular_file() || IsTempFilename(dirEntry.path()))
+				continue; // Temporary files are left behind by writes interrupted by a crash.
+
+			callback(dirEntry.path().lexically_relative(m_rootDir).generic_string(),
+				dirEntry.file_size(),
+				int64_t(dirEntry.last_write_time().time_since_epoch().count()));
+		}
+	}
+
+	bool DirectoryMount::ContainsPath(const std::filesystem::path& path) const
+	{
+		std::filesystem::path finalPath;
+		try
+		{
+			finalPath = std::filesystem::canonical(m_rootDir / path);
+		}
+		catch (const std::exception& /*ex*/)
+		{
+			return false; // Path/File does not exists.
+		}
+
+		auto [rootEnd, nothing] = std::mismatch(m_rootDir.begin(), m_rootDir.end(), finalPath.begin());
+		if (rootEnd == m_rootDir.end())
+			return false;
+
+		return true;
+	}
+
+} // namespace gfs
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "mount_backend.hpp"
+
+#include <filesystem>
+
+namespace gfs
+{
+	struct StatsCollector;
+
+	/**
+	 * Files of a mount in a directory on disk. Writes go to a temporary file next to their destination & are committed by
+	 * renaming it over the destination.
+	 */
+	class DirectoryMount : public MountBackend
+	{
+	public:
+		/**
+		 * @brief
+		 * @param rootDir
+		 * @param stats Records file opens. Must outlive the mount & the files opened from it.
+		 */
+		DirectoryMount(std::filesystem::path rootDir, StatsCollector* stats);
+
+		bool IsInMemory() const override { return false; }
+		auto Open(const std::string& mountRelPath) const -> std::unique_ptr<MountFile> override;
+		auto Stage(const std::string& mountRelPath, const std::vector<WriteChunk>& chunks, bool sync) -> std::shared_ptr<StagedWrite> override;
+		auto StageCopy(const std::string& mountRelPath, std::istream& stream, uint64_t size, uint64_t alignedOffset)
+			-> std::shared_ptr<StagedWrite> override;
+		void CreateDirectories(const std::filesystem::path& mountRelDir) override;
+		void Enumerate(const EnumerateCallback& callback) const override;
+		bool ContainsPath(const std::filesystem::path& path) const override;
+
+	private:
+		std::filesystem::path m_rootDir;
+		StatsCollector* m_stats;
+	};
+
+} // namespace gfs
@@ -0,0 +1,270 @@
+#include "file_io.hpp"
+
+#include "hash.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define GFS_POSIX_FILE_IO
+	#include <fcntl.h>
+	#include <limits.h>
+	#include <sys/stat.h>
+	#include <sys/uio.h>
+	#include <unistd.h>
+#else
+	#include <fstream>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace gfs
+{
+	constexpr const char* FS_TEMP_FILE_EXTENSION = ".gfs_tmp";
+
+	bool WriteFileChunks(const std::filesystem::path& filename, const std::vector<WriteChunk>& chunks, bool sync)
+	{
+#if defined(GFS_POSIX_FILE_IO)
+		const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			return false;
+
+		std::vector<iovec> vectors;
+		vectors.reserve(chunks.size());
+		for (const auto& chunk : chunks)
+		{
+			if (chunk.Size != 0)
+				vectors.push_back({ const_cast<void*>(chunk.Data), chunk.Size });
+		}
+
+		bool succeeded = true;
+		size_t index = 0;
+		while (index < vectors.size())
+		{
+			const auto count = int(std::min<size_t>(vectors.size() - index, IOV_MAX));
+			const auto written = ::writev(fd, vectors.data() + index, count);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				succeeded = false;
+				break;
+			}
+
+			// Skip fully written chunks & continue from the middle of a partially written one.
+			auto remaining = size_t(written);
+			while (index < vectors.size() && remaining >= vectors[index].iov_len)
+				remaining -= vectors[index++].iov_len;
+			if (remaining != 0)
+			{
+				vectors[index].iov_base = static_cast<uint8_t*>(vectors[index].iov_base) + remaining;
+				vectors[index].iov_len -= remaining;
+			}
+		}
+
+		if (succeeded && sync)
+			succeeded = ::fsync(fd) == 0;
+		if (::close(fd) != 0)
+			succeeded = false;
+		return succeeded;
+#else
+		std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+		for (const auto& chunk : chunks)
+			stream.write(static_cast<const char*>(chunk.Data), std::streamsize(chunk.Size));
+		stream.flush();
+		return bool(stream);
+#endif
+	}
+
+	bool SyncFile(const std::filesystem::path& filename)
+	{
+#if defined(GFS_POSIX_FILE_IO)
+		// The file is flushed on its own, as `syncfs` would flush everything else on the filesystem too & only reports
+		// writeback errors from Linux 5.8.
+		const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		const bool succeeded = ::fsync(fd) == 0;
+		::close(fd);
+		return succeeded;
+#else
+		(void)filename;
+		return true;
+#endif
+	}
+
+	bool SyncDirectory(const std::filesystem::path& directory)
+	{
+#if defined(GFS_POSIX_FILE_IO)
+		const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		const bool succeeded = ::fsync(fd) == 0;
+		::close(fd);
+		return succeeded;
+#else
+		(void)directory;
+		return true;
+#endif
+	}
+
+	auto MakeTempFilename(const std::filesystem::path& filename) -> std::filesystem::path
+	{
+		// Random per process so concurrent processes writing the same file do not share a temp file.
+		static const auto sProcessTag = std::to_string(std::random_device{}());
+		static std::atomic<uint64_t> sCounter = 0;
+
+		auto tempFilename = filename;
+		tempFilename += FS_TEMP_FILE_EXTENSION + sProcessTag + "_" + std::to_string(sCounter++);
+		return tempFilename;
+	}
+
+	bool IsTempFilename(const std::filesystem::path& filename)
+	{
+		return filename.extension().string().rfind(FS_TEMP_FILE_EXTENSION, 0) == 0;
+	}
+
+	AlignedBuffer::~AlignedBuffer()
+	{
+		Free();
+	}
+
+	bool AlignedBuffer::Allocate(size_t size, size_t alignment, Allocator* allocator, MemoryCategory category)
+	{
+		Free();
+		m_allocator = allocator != nullptr ? allocator : GetDefaultAllocator();
+		m_category = category;
+		m_alignment = alignment;
+		m_data = static_cast<uint8_t*>(m_allocator->Allocate(size, alignment, category));
+		m_size = m_data != nullptr ? size : 0;
+		return m_data != nullptr;
+	}
+
+	void AlignedBuffer::Free()
+	{
+		if (m_data != nullptr)
+			m_allocator->Deallocate(m_data, m_size, m_alignment, m_category);
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	auto ReadFileUncached(const std::filesystem::path& filename,
+		uint64_t offset,
+		uint64_t size,
+		AlignedBuffer& buffer,
+		Allocator* allocator,
+		MemoryCategory category) -> const uint8_t*
+	{
+		// Direct I/O reads whole aligned blocks, so the enclosing range is read & the requested range returned from inside it.
+		const auto alignedOffset = offset & ~uint64_t(FS_DIRECT_IO_ALIGNMENT - 1);
+		const auto leadSize = offset - alignedOffset;
+		const auto alignedSize = (leadSize + size + FS_DIRECT_IO_ALIGNMENT - 1) & ~uint64_t(FS_DIRECT_IO_ALIGNMENT - 1);
+		if (!buffer.Allocate(size_t(alignedSize), FS_DIRECT_IO_ALIGNMENT, allocator, category))
+			return nullptr;
+
+#if defined(GFS_POSIX_FILE_IO)
+	#if defined(__linux__)
+		// Read-ahead hints only help buffered reads, they would fill the page cache in direct mode.
+		auto openBuffered = [&]() {
+			const int bufferedFd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+			if (bufferedFd >= 0)
+			{
+				::posix_fadvise(bufferedFd, off_t(alignedOffset), off_t(alignedSize), POSIX_FADV_SEQUENTIAL);
+				::posix_fadvise(bufferedFd, off_t(alignedOffset), off_t(alignedSize), POSIX_FADV_WILLNEED);
+			}
+			return bufferedFd;
+		};
+
+		int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+		bool direct = fd >= 0;
+		if (fd < 0 && errno == EINVAL)
+			fd = openBuffered();
+		if (fd < 0)
+			return nullptr;
+	#else
+		const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return nullptr;
+		#if defined(__APPLE__)
+		::fcntl(fd, F_NOCACHE, 1);
+		#endif
+	#endif
+
+		uint64_t readSize = 0;
+		while (readSize < leadSize + size)
+		{
+			const auto bytes = ::pread(fd, buffer.GetData() + readSize, size_t(alignedSize - readSize), off_t(alignedOffset + readSize));
+			if (bytes < 0 && errno == EINTR)
+				continue;
+	#if defined(__linux__)
+			// Some filesystems accept O_DIRECT when opening but not when reading. The rest is read buffered.
+			if (bytes < 0 && errno == EINVAL && direct)
+			{
+				::close(fd);
+				fd = openBuffered();
+				direct = false;
+				if (fd < 0)
+					return nullptr;
+				continue;
+			}
+	#endif
+			if (bytes <= 0)
+				break; // Failed or end of file.
+			readSize += uint64_t(bytes);
+		}
+
+	#if defined(__linux__)
+		// Also drops pages cached by other (buffered) reads of the range.
+		::posix_fadvise(fd, off_t(alignedOffset), off_t(alignedSize), POSIX_FADV_DONTNEED);
+	#endif
+		::close(fd);
+#else
+		std::ifstream stream(filename, std::ios::binary);
+		stream.seekg(std::streamoff(alignedOffset));
+		stream.read(reinterpret_cast<char*>(buffer.GetData()), std::streamsize(alignedSize));
+		const auto readSize = uint64_t(stream.gcount());
+#endif
+
+		return readSize >= leadSize + size ? buffer.GetData() + leadSize : nullptr;
+	}
+
+	auto GetFileVersion(const std::filesystem::path& filename) -> uint64_t
+	{
+#if defined(GFS_POSIX_FILE_IO)
+		struct stat status{};
+		if (::stat(filename.c_str(), &status) != 0)
+			return 0;
+
+	#if defined(__APPLE__)
+		const auto& lastWriteTime = status.st_mtimespec;
+	#else
+		const auto& lastWriteTime = status.st_mtim;
+	#endif
+		// Files are replaced by renaming, so a rewritten file is also a new inode.
+		const uint64_t fields[] = { uint64_t(status.st_dev), uint64_t(status.st_ino), uint64_t(status.st_size), uint64_t(lastWriteTime.tv_sec),
+			uint64_t(lastWriteTime.tv_nsec) };
+		Hasher64 hasher;
+		hasher.Update(fields, sizeof(fields));
+#else
+		std::error_code error;
+		const auto fileSize = std::filesystem::file_size(filename, error);
+		const auto lastWriteTime = std::filesystem::last_write_time(filename, error);
+		const auto absoluteFilename = std::filesystem::absolute(filename, error).lexically_normal().generic_string();
+		if (error)
+			return 0;
+
+		const uint64_t fields[] = { uint64_t(fileSize), uint64_t(lastWriteTime.time_since_epoch().count()) };
+		Hasher64 hasher;
+		hasher.Update(absoluteFilename.data(), absoluteFilename.size());
+		hasher.Update(fields, sizeof(fields));
+#endif
+		const auto version = hasher.Finish();
+		return version != 0 ? version : 1;
+	}
+
+} // namespace gfs
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "gfs/allocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace gfs
+{
+	struct WriteChunk
+	{
+		const void* Data;
+		size_t Size;
+	};
+
+	/**
+	 * @brief Creates (or truncates) a file & writes the chunks with a single gather write (`writev` on POSIX).
+	 * @param filename
+	 * @param chunks Written in order.
+	 * @param sync Flush the file's data to disk before returning.
+	 * @return
+	 */
+	bool WriteFileChunks(const std::filesystem::path& filename, const std::vector<WriteChunk>& chunks, bool sync);
+
+	/**
+	 * @brief Flushes the data of a file to disk with an `fsync`. Only flushed to the OS on platforms without POSIX file IO.
+	 * @param filename
+	 * @return
+	 */
+	bool SyncFile(const std::filesystem::path& filename);
+
+	/**
+	 * @brief Flushes a directory's entries (eg. After a rename) to disk. No-op on platforms without POSIX file IO.
+	 * @param directory
+	 * @return
+	 */
+	bool SyncDirectory(const std::filesystem::path& directory);
+
+	/**
+	 * @brief Unique name next to `filename` to write to before renaming over it.
+	 * @param filename
+	 * @return
+	 */
+	auto MakeTempFilename(const std::filesystem::path& filename) -> std::filesystem::path;
+
+	bool IsTempFilename(const std::filesystem::path& filename);
+
+	constexpr size_t FS_DIRECT_IO_ALIGNMENT = 4096; // Offset, size & memory alignment for `O_DIRECT` (The usual page size).
+
+	/**
+	 * Allocator backed memory with a given alignment, eg. For direct I/O.
+	 */
+	class AlignedBuffer
+	{
+	public:
+		AlignedBuffer() = default;
+		~AlignedBuffer();
+
+		AlignedBuffer(const AlignedBuffer&) = delete;
+		AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+		/**
+		 * @brief Frees any previous allocation.
+		 * @return False if out of memory.
+		 */
+		bool Allocate(size_t size, size_t alignment, Allocator* allocator, MemoryCategory category);
+
+		auto GetData() const -> uint8_t* { return m_data; }
+		auto GetSize() const -> size_t { return m_size; }
+
+	private:
+		void Free();
+
+	private:
+		Allocator* m_allocator = nullptr;
+		MemoryCategory m_category = MemoryCategory::General;
+		uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		size_t m_alignment = 0;
+	};
+
+	/**
+	 * @brief Reads part of a file without leaving it in the OS page cache, so streaming large files does not evict small hot
+	 * ones. Linux uses `O_DIRECT`, falling back on filesystems without direct I/O (eg. tmpfs), whether they reject it when
+	 * opening or when reading, to a buffered read with `POSIX_FADV_SEQUENTIAL`/`POSIX_FADV_WILLNEED` read-ahead hints.
+	 * Either way the range is dropped with `POSIX_FADV_DONTNEED` afterwards. macOS uses `F_NOCACHE`. Plain reads elsewhere.
+	 * @param filename
+	 * @param offset
+	 * @param size
+	 * @param buffer Allocated to hold the enclosing `FS_DIRECT_IO_ALIGNMENT` aligned range.
+	 * @param allocator
+	 * @param category
+	 * @return Start of the requested range within `buffer`. nullptr if the range could not be read or out of memory.
+	 */
+	auto ReadFileUncached(const std::filesystem::path& filename,
+		uint64_t offset,
+		uint64_t size,
+		AlignedBuffer& buffer,
+		Allocator* allocator,
+		MemoryCategory category) -> const uint8_t*;
+
+	/**
+	 * @brief Identifies a file's current contents for caches shared between processes: its location (device & inode on
+	 * POSIX, absolute path elsewhere), size & last write time.
+	 * @param filename
+	 * @return 0 if the file does not exist.
+	 */
+	auto GetFileVersion(const std::filesystem::path& filename) -> uint64_t;
+
+} // namespace gfs
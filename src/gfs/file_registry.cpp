@@ -0,0 +1,567 @@
+#include "gfs/file_registry.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace gfs
+{
+	constexpr uint64_t FS_REGISTRY_MIN_SLOT_COUNT = 64; // Must be a power of 2.
+
+	static auto HashFileId(FileID id) -> uint64_t
+	{
+		// splitmix64 finalizer. File ids are often sequential or hashes already, so just make sure bits are spread.
+		id ^= id >> 30;
+		id *= 0xbf58476d1ce4e5b9ull;
+		id ^= id >> 27;
+		id *= 0x94d049bb133111ebull;
+		id ^= id >> 31;
+		return id;
+	}
+
+	// Linear probing over a table of dense indices, shared by the file, path & dependency tables.
+	template<typename Matches>
+	static auto FindSlotIn(const ChunkedArray<uint32_t>& slots, uint64_t hash, const Matches& matches) -> uint64_t
+	{
+		// Returns the slot holding a matching index or the empty slot it would be inserted into.
+		const uint64_t mask = slots.GetSize() - 1;
+		auto slot = hash & mask;
+		while (slots[slot] != FileRegistry::InvalidIndex && !matches(slots[slot]))
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	template<typename HashOf>
+	static void EraseSlotIn(ChunkedArray<uint32_t>& slots, uint64_t slot, const HashOf& hashOf)
+	{
+		// Backward shift deletion. Moves following entries of the probe sequence back so no tombstones are needed.
+		const uint64_t mask = slots.GetSize() - 1;
+		auto next = slot;
+		while (true)
+		{
+			next = (next + 1) & mask;
+			if (slots[next] == FileRegistry::InvalidIndex)
+				break;
+
+			const auto home = hashOf(slots[next]) & mask;
+			const bool canMove = slot <= next ? (home <= slot || home > next) : (home <= slot && home > next);
+			if (canMove)
+			{
+				slots.Set(slot, slots[next]);
+				slot = next;
+			}
+		}
+		slots.Set(slot, FileRegistry::InvalidIndex);
+	}
+
+	template<typename HashOf>
+	static void RehashSlotsIn(ChunkedArray<uint32_t>& slots, uint64_t newSlotCount, uint32_t count, const HashOf& hashOf)
+	{
+		slots.Assign(std::max(newSlotCount, FS_REGISTRY_MIN_SLOT_COUNT), FileRegistry::InvalidIndex);
+		const uint64_t mask = slots.GetSize() - 1;
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			auto slot = hashOf(index) & mask;
+			while (slots[slot] != FileRegistry::InvalidIndex)
+				slot = (slot + 1) & mask;
+			slots.Set(slot, index);
+		}
+	}
+
+	FileRegistry::FileRegistry(Allocator* allocator)
+		: m_slots(allocator, MemoryCategory::Registry),
+		  m_fileIds(allocator, MemoryCategory::Registry),
+		  m_mountIds(allocator, MemoryCategory::Registry),
+		  m_mountRelPathIds(allocator, MemoryCategory::Registry),
+		  m_sourceFilenameIds(allocator, MemoryCategory::Registry),
+		  m_uncompressedSizes(allocator, MemoryCategory::Registry),
+		  m_compressedSizes(allocator, MemoryCategory::Registry),
+		  m_offsets(allocator, MemoryCategory::Registry),
+		  m_recordOffsets(allocator, MemoryCategory::Registry),
+		  m_pathPositions(allocator, MemoryCategory::Registry),
+		  m_sourceHashes(allocator, MemoryCategory::Registry),
+		  m_metadataHashes(allocator, MemoryCategory::Registry),
+		  m_metadata(allocator, MemoryCategory::Registry),
+		  m_dependencies(allocator, MemoryCategory::Registry),
+		  m_paths(allocator, MemoryCategory::Registry),
+		  m_pathHashes(allocator, MemoryCategory::Registry),
+		  m_pathSlots(allocator, MemoryCategory::Registry),
+		  m_pathFiles(allocator, MemoryCategory::Registry),
+		  m_sourceFiles(allocator, MemoryCategory::Registry),
+		  m_dependencySlots(allocator, MemoryCategory::Registry),
+		  m_dependencyIds(allocator, MemoryCategory::Registry),
+		  m_dependents(allocator, MemoryCategory::Registry)
+	{
+		Clear();
+	}
+
+	auto FileRegistry::Insert(const File& file) -> uint32_t
+	{
+		// Keep load factor <= 0.5
+		if ((m_fileIds.GetSize() + 1) * 2 > m_slots.GetSize())
+			Rehash(m_slots.GetSize() * 2);
+
+		const auto mountRelPathId = InternPath(NormalizePath(file.MountRelPath));
+		const auto sourceFilenameId = InternPath(file.SourceFilename.string());
+
+		uint32_t index = InvalidIndex;
+		const auto slot = FindSlot(file.FileId);
+		if (m_slots[slot] != InvalidIndex)
+		{
+			index = m_slots[slot]; // Replace existing file.
+			RemovePathFile(index);
+			RemoveSourceFile(m_sourceFilenameIds[index], file.FileId);
+			for (auto dependency : m_dependencies[index])
+				RemoveDependent(dependency, file.FileId);
+		}
+		else
+		{
+			index = uint32_t(m_fileIds.GetSize());
+			m_slots.Set(slot, index);
+
+			m_fileIds.PushBack({});
+			m_mountIds.PushBack({});
+			m_mountRelPathIds.PushBack({});
+			m_sourceFilenameIds.PushBack({});
+			m_uncompressedSizes.PushBack({});
+			m_compressedSizes.PushBack({});
+			m_offsets.PushBack({});
+			m_recordOffsets.PushBack({});
+			m_pathPositions.PushBack({});
+			m_sourceHashes.PushBack({});
+			m_metadataHashes.PushBack({});
+			m_metadata.PushBack({});
+			m_dependencies.PushBack({});
+		}
+
+		m_fileIds.Set(index, file.FileId);
+		m_mountIds.Set(index, file.MountId);
+		m_mountRelPathIds.Set(index, mountRelPathId);
+		m_sourceFilenameIds.Set(index, sourceFilenameId);
+		m_uncompressedSizes.Set(index, file.UncompressedSize);
+		m_compressedSizes.Set(index, file.CompressedSize);
+		m_offsets.Set(index, file.Offset);
+		m_recordOffsets.Set(index, file.RecordOffset);
+		m_sourceHashes.Set(index, file.SourceHash);
+		m_metadataHashes.Set(index, file.MetadataHash);
+		m_metadata.Set(index, m_coldFieldsResident ? file.MetadataStr : std::string());
+		m_dependencies.Set(index, m_coldFieldsResident ? file.FileDependencies : std::vector<FileID>());
+
+		AddPathFile(index);
+		AddSourceFile(sourceFilenameId, file.FileId);
+		for (auto dependency : file.FileDependencies)
+			AddDependent(dependency, file.FileId);
+		return index;
+	}
+
+	bool FileRegistry::Remove(FileID id)
+	{
+		const auto slot = FindSlot(id);
+		const auto index = m_slots[slot];
+		if (index == InvalidIndex)
+			return false;
+
+		RemovePathFile(index);
+		RemoveSourceFile(m_sourceFilenameIds[index], id);
+		for (auto dependency : m_dependencies[index])
+			RemoveDependent(dependency, id);
+		EraseSlotIn(m_slots, slot, [&](uint32_t other) { return HashFileId(m_fileIds[other]); });
+
+		// Move the last file into the removed files place to keep the arrays dense.
+		const auto lastIndex = uint32_t(m_fileIds.GetSize() - 1);
+		if (index != lastIndex)
+		{
+			m_slots.Set(FindSlot(m_fileIds[lastIndex]), index);
+
+			m_fileIds.Set(index, m_fileIds[lastIndex]);
+			m_mountIds.Set(index, m_mountIds[lastIndex]);
+			m_mountRelPathIds.Set(index, m_mountRelPathIds[lastIndex]);
+			m_sourceFilenameIds.Set(index, m_sourceFilenameIds[lastIndex]);
+			m_uncompressedSizes.Set(index, m_uncompressedSizes[lastIndex]);
+			m_compressedSizes.Set(index, m_compressedSizes[lastIndex]);
+			m_offsets.Set(index, m_offsets[lastIndex]);
+			m_recordOffsets.Set(index, m_recordOffsets[lastIndex]);
+			m_pathPositions.Set(index, m_pathPositions[lastIndex]);
+			m_sourceHashes.Set(index, m_sourceHashes[lastIndex]);
+			m_metadataHashes.Set(index, m_metadataHashes[lastIndex]);
+			m_metadata.Set(index, m_metadata[lastIndex]);
+			m_dependencies.Set(index, m_dependencies[lastIndex]);
+		}
+
+		m_fileIds.PopBack();
+		m_mountIds.PopBack();
+		m_mountRelPathIds.PopBack();
+		m_sourceFilenameIds.PopBack();
+		m_uncompressedSizes.PopBack();
+		m_compressedSizes.PopBack();
+		m_offsets.PopBack();
+		m_recordOffsets.PopBack();
+		m_pathPositions.PopBack();
+		m_sourceHashes.PopBack();
+		m_metadataHashes.PopBack();
+		m_metadata.PopBack();
+		m_dependencies.PopBack();
+		return true;
+	}
+
+	void FileRegistry::Clear()
+	{
+		m_slots.Assign(FS_REGISTRY_MIN_SLOT_COUNT, InvalidIndex);
+
+		m_fileIds.Clear();
+		m_mountIds.Clear();
+		m_mountRelPathIds.Clear();
+		m_sourceFilenameIds.Clear();
+		m_uncompressedSizes.Clear();
+		m_compressedSizes.Clear();
+		m_offsets.Clear();
+		m_recordOffsets.Clear();
+		m_pathPositions.Clear();
+		m_sourceHashes.Clear();
+		m_metadataHashes.Clear();
+		m_metadata.Clear();
+		m_dependencies.Clear();
+
+		m_paths.Clear();
+		m_pathHashes.Clear();
+		m_pathSlots.Assign(FS_REGISTRY_MIN_SLOT_COUNT, InvalidIndex);
+		m_pathFiles.Clear();
+		m_sourceFiles.Clear();
+		InternPath(""); // EmptyPathId
+
+		m_mountPriorities.clear();
+
+		m_dependencySlots.Assign(FS_REGISTRY_MIN_SLOT_COUNT, InvalidIndex);
+		m_dependencyIds.Clear();
+		m_dependents.Clear();
+	}
+
+	void FileRegistry::Reserve(uint32_t count)
+	{
+		uint64_t slotCount = m_slots.GetSize();
+		while (uint64_t(count) * 2 > slotCount)
+			slotCount *= 2;
+		if (slotCount != m_slots.GetSize())
+			Rehash(slotCount);
+
+		m_fileIds.Reserve(count);
+		m_mountIds.Reserve(count);
+		m_mountRelPathIds.Reserve(count);
+		m_sourceFilenameIds.Reserve(count);
+		m_uncompressedSizes.Reserve(count);
+		m_compressedSizes.Reserve(count);
+		m_offsets.Reserve(count);
+		m_recordOffsets.Reserve(count);
+		m_pathPositions.Reserve(count);
+		m_sourceHashes.Reserve(count);
+		m_metadataHashes.Reserve(count);
+		m_metadata.Reserve(count);
+		m_dependencies.Reserve(count);
+	}
+
+	void FileRegistry::SetColdFieldsResident(bool resident)
+	{
+		m_coldFieldsResident = resident;
+	}
+
+	void FileRegistry::SetMountPriority(MountID mountId, int32_t priority)
+	{
+		m_mountPriorities[mountId] = priority;
+	}
+
+	void FileRegistry::RemoveMount(MountID mountId)
+	{
+		std::vector<FileID> mountFiles;
+		for (uint32_t index = 0; index < m_fileIds.GetSize(); ++index)
+		{
+			if (m_mountIds[index] == mountId)
+				mountFiles.push_back(m_fileIds[index]);
+		}
+
+		for (auto id : mountFiles)
+			Remove(id);
+
+		m_mountPriorities.erase(mountId);
+	}
+
+	auto FileRegistry::Find(FileID id) const -> uint32_t
+	{
+		return m_slots[FindSlot(id)];
+	}
+
+	auto FileRegistry::FindByPath(const std::string& path) const -> uint32_t
+	{
+		const auto pathId = FindPathId(path);
+		if (pathId == InvalidIndex || pathId == EmptyPathId)
+			return InvalidIndex;
+
+		const auto& pathFiles = m_pathFiles[pathId];
+		if (pathFiles.empty())
+			return InvalidIndex;
+
+		// Only the mount with the highest precedence is considered, so a shadowed path never falls through to another mount.
+		return FindByPathId(pathId, m_mountIds[Find(pathFiles.front())]);
+	}
+
+	auto FileRegistry::FindByPath(const std::string& path, MountID mountId) const -> uint32_t
+	{
+		const auto pathId = FindPathId(path);
+		if (pathId == InvalidIndex || pathId == EmptyPathId)
+			return InvalidIndex;
+
+		return FindByPathId(pathId, mountId);
+	}
+
+	auto FileRegistry::NormalizePath(const std::filesystem::path& path) -> std::string
+	{
+		auto normalPath = path.lexically_normal().generic_string();
+		if (!normalPath.empty() && normalPath.back() == '/')
+			normalPath.pop_back();
+		return normalPath == "." ? std::string() : normalPath;
+	}
+
+	auto FileRegistry::GetFilesWithSourceFile(const std::string& sourceFilename) const -> const std::vector<FileID>&
+	{
+		static const std::vector<FileID> sNoFiles;
+
+		const auto sourceFilenameId = FindPathId(sourceFilename);
+		if (sourceFilenameId == InvalidIndex || sourceFilenameId == EmptyPathId)
+			return sNoFiles;
+
+		return m_sourceFiles[sourceFilenameId];
+	}
+
+	auto FileRegistry::GetDependents(FileID id) const -> std::vector<FileID>
+	{
+		const auto dependencyIndex = m_dependencySlots[FindDependencySlot(id)];
+		if (dependencyIndex == InvalidIndex)
+			return {};
+
+		auto dependents = m_dependents[dependencyIndex];
+		if (!m_coldFieldsResident)
+		{
+			// Edges from removed files cannot be dropped eagerly without their dependency lists.
+			dependents.erase(std::remove_if(dependents.begin(), dependents.end(), [&](FileID dependent) { return Find(dependent) == InvalidIndex; }),
+				dependents.end());
+		}
+		return dependents;
+	}
+
+	auto FileRegistry::GetFile(uint32_t index) const -> File
+	{
+		File file{};
+		file.FileId = m_fileIds[index];
+		file.MountId = m_mountIds[index];
+		file.MountRelPath = m_paths[m_mountRelPathIds[index]];
+		file.SourceFilename = m_paths[m_sourceFilenameIds[index]];
+		file.MetadataStr = m_metadata[index];
+		file.FileDependencies = m_dependencies[index];
+		file.UncompressedSize = m_uncompressedSizes[index];
+		file.CompressedSize = m_compressedSizes[index];
+		file.Offset = m_offsets[index];
+		file.RecordOffset = m_recordOffsets[index];
+		file.SourceHash = m_sourceHashes[index];
+		file.MetadataHash = m_metadataHashes[index];
+		return file;
+	}
+
+	auto FileRegistry::FindPathId(const std::string& path) const -> uint32_t
+	{
+		return m_pathSlots[FindPathSlot(path, std::hash<std::string>{}(path))];
+	}
+
+	auto FileRegistry::InternPath(const std::string& path) -> uint32_t
+	{
+		const uint64_t hash = std::hash<std::string>{}(path);
+		const auto slot = FindPathSlot(path, hash);
+		if (m_pathSlots[slot] != InvalidIndex)
+			return m_pathSlots[slot];
+
+		const auto newPathId = uint32_t(m_paths.GetSize());
+		m_paths.PushBack(path);
+		m_pathHashes.PushBack(hash);
+		m_pathFiles.PushBack({});
+		m_sourceFiles.PushBack({});
+
+		// Keep load factor <= 0.5
+		if (m_paths.GetSize() * 2 > m_pathSlots.GetSize())
+			RehashSlotsIn(m_pathSlots, m_pathSlots.GetSize() * 2, uint32_t(m_paths.GetSize()), [&](uint32_t pathId) { return m_pathHashes[pathId]; });
+		else
+			m_pathSlots.Set(slot, newPathId);
+		return newPathId;
+	}
+
+	auto FileRegistry::GetMountPriority(MountID mountId) const -> int32_t
+	{
+		const auto it = m_mountPriorities.find(mountId);
+		return it == m_mountPriorities.end() ? 0 : it->second;
+	}
+
+	bool FileRegistry::HasPrecedence(MountID lhs, MountID rhs) const
+	{
+		const auto lhsPriority = GetMountPriority(lhs);
+		const auto rhsPriority = GetMountPriority(rhs);
+		if (lhsPriority != rhsPriority)
+			return lhsPriority > rhsPriority;
+
+		return lhs > rhs; // Later mounts win ties.
+	}
+
+	void FileRegistry::AddPathFile(uint32_t index)
+	{
+		const auto pathId = m_mountRelPathIds[index];
+		if (pathId == EmptyPathId)
+			return;
+
+		// Archives put every file on one path, so the end of the mount's files is binary searched. Files of the mount with
+		// the lowest precedence (the usual case while a mount is scanned) are appended.
+		const auto mountId = m_mountIds[index];
+		auto& pathFiles = m_pathFiles.GetMutable(pathId);
+		const auto it = std::partition_point(pathFiles.begin(), pathFiles.end(), [&](FileID other) { return !HasPrecedence(mountId, m_mountIds[Find(other)]); });
+		const auto position = uint32_t(it - pathFiles.begin());
+		pathFiles.insert(it, m_fileIds[index]);
+
+		m_pathPositions.Set(index, position);
+		for (auto i = position + 1; i < pathFiles.size(); ++i)
+			SetPathPosition(pathFiles[i], i);
+	}
+
+	void FileRegistry::RemovePathFile(uint32_t index)
+	{
+		const auto pathId = m_mountRelPathIds[index];
+		if (pathId == EmptyPathId)
+			return;
+
+		// Order within a mount does not matter, so the mount's last file takes this one's place & only the files of mounts
+		// with lower precedence move.
+		const auto mountId = m_mountIds[index];
+		const auto position = m_pathPositions[index];
+		auto& pathFiles = m_pathFiles.GetMutable(pathId);
+		const auto mountEnd = std::partition_point(pathFiles.begin() + position, pathFiles.end(), [&](FileID other) { return !HasPrecedence(mountId, m_mountIds[Find(other)]); });
+		const auto lastPosition = uint32_t(mountEnd - pathFiles.begin() - 1);
+		if (position != lastPosition)
+		{
+			pathFiles[position] = pathFiles[lastPosition];
+			SetPathPosition(pathFiles[position], position);
+		}
+
+		pathFiles.erase(pathFiles.begin() + lastPosition);
+		for (auto i = lastPosition; i < pathFiles.size(); ++i)
+			SetPathPosition(pathFiles[i], i);
+	}
+
+	void FileRegistry::SetPathPosition(FileID id, uint32_t position)
+	{
+		m_pathPositions.Set(Find(id), position);
+	}
+
+	void FileRegistry::AddSourceFile(uint32_t sourceFilenameId, FileID id)
+	{
+		if (sourceFilenameId != EmptyPathId)
+			m_sourceFiles.GetMutable(sourceFilenameId).push_back(id);
+	}
+
+	void FileRegistry::RemoveSourceFile(uint32_t sourceFilenameId, FileID id)
+	{
+		const auto& sourceFiles = m_sourceFiles[sourceFilenameId];
+		if (std::find(sourceFiles.begin(), sourceFiles.end(), id) == sourceFiles.end())
+			return;
+
+		auto& mutableSourceFiles = m_sourceFiles.GetMutable(sourceFilenameId);
+		mutableSourceFiles.erase(std::remove(mutableSourceFiles.begin(), mutableSourceFiles.end(), id), mutableSourceFiles.end());
+	}
+
+	void FileRegistry::AddDependent(FileID dependency, FileID id)
+	{
+		const auto slot = FindDependencySlot(dependency);
+		const auto dependencyIndex = m_dependencySlots[slot];
+		if (dependencyIndex == InvalidIndex)
+		{
+			const auto newIndex = uint32_t(m_dependencyIds.GetSize());
+			m_dependencyIds.PushBack(dependency);
+			m_dependents.PushBack({ id });
+
+			// Keep load factor <= 0.5
+			if (m_dependencyIds.GetSize() * 2 > m_dependencySlots.GetSize())
+			{
+				RehashSlotsIn(m_dependencySlots, m_dependencySlots.GetSize() * 2, uint32_t(m_dependencyIds.GetSize()),
+					[&](uint32_t index) { return HashFileId(m_dependencyIds[index]); });
+			}
+			else
+				m_dependencySlots.Set(slot, newIndex);
+			return;
+		}
+
+		const auto& dependents = m_dependents[dependencyIndex];
+		if (std::find(dependents.begin(), dependents.end(), id) == dependents.end())
+			m_dependents.GetMutable(dependencyIndex).push_back(id);
+	}
+
+	void FileRegistry::RemoveDependent(FileID dependency, FileID id)
+	{
+		const auto slot = FindDependencySlot(dependency);
+		const auto dependencyIndex = m_dependencySlots[slot];
+		if (dependencyIndex == InvalidIndex)
+			return;
+
+		const auto& dependents = m_dependents[dependencyIndex];
+		if (std::find(dependents.begin(), dependents.end(), id) == dependents.end())
+			return;
+
+		if (dependents.size() > 1)
+		{
+			auto& mutableDependents = m_dependents.GetMutable(dependencyIndex);
+			mutableDependents.erase(std::remove(mutableDependents.begin(), mutableDependents.end(), id), mutableDependents.end());
+			return;
+		}
+
+		// The last dependent, so the dependency is removed. The last dependency is moved into its place to keep the arrays dense.
+		EraseSlotIn(m_dependencySlots, slot, [&](uint32_t index) { return HashFileId(m_dependencyIds[index]); });
+		const auto lastIndex = uint32_t(m_dependencyIds.GetSize() - 1);
+		if (dependencyIndex != lastIndex)
+		{
+			m_dependencySlots.Set(FindDependencySlot(m_dependencyIds[lastIndex]), dependencyIndex);
+			m_dependencyIds.Set(dependencyIndex, m_dependencyIds[lastIndex]);
+			m_dependents.Set(dependencyIndex, m_dependents[lastIndex]);
+		}
+		m_dependencyIds.PopBack();
+		m_dependents.PopBack();
+	}
+
+	auto FileRegistry::FindByPathId(uint32_t pathId, MountID mountId) const -> uint32_t
+	{
+		uint32_t foundIndex = InvalidIndex;
+		for (auto id : m_pathFiles[pathId])
+		{
+			const auto index = Find(id);
+			if (m_mountIds[index] != mountId)
+				continue;
+
+			if (foundIndex != InvalidIndex)
+				return InvalidIndex; // Several files share the path (eg. An archive).
+
+			foundIndex = index;
+		}
+		return foundIndex;
+	}
+
+	auto FileRegistry::FindSlot(FileID id) const -> uint64_t
+	{
+		return FindSlotIn(m_slots, HashFileId(id), [&](uint32_t index) { return m_fileIds[index] == id; });
+	}
+
+	auto FileRegistry::FindPathSlot(const std::string& path, uint64_t hash) const -> uint64_t
+	{
+		return FindSlotIn(m_pathSlots, hash, [&](uint32_t pathId) { return m_pathHashes[pathId] == hash && m_paths[pathId] == path; });
+	}
+
+	auto FileRegistry::FindDependencySlot(FileID dependency) const -> uint64_t
+	{
+		return FindSlotIn(m_dependencySlots, HashFileId(dependency), [&](uint32_t index) { return m_dependencyIds[index] == dependency; });
+	}
+
+	void FileRegistry::Rehash(uint64_t newSlotCount)
+	{
+		RehashSlotsIn(m_slots, newSlotCount, uint32_t(m_fileIds.GetSize()), [&](uint32_t index) { return HashFileId(m_fileIds[index]); });
+	}
+
+} // namespace gfs
@@ -0,0 +1,280 @@
+#include "file_watcher.hpp"
+
+#if defined(__linux__)
+	#include <poll.h>
+	#include <sys/eventfd.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#else
+	#include <FileWatch.hpp>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <system_error>
+
+namespace gfs
+{
+#if defined(__linux__)
+	struct FileWatcher::PlatformDirectoryWatch
+	{
+		int WatchDescriptor;
+	};
+#else
+	struct FileWatcher::PlatformDirectoryWatch
+	{
+		std::unique_ptr<filewatch::FileWatch<std::string>> Watch;
+	};
+#endif
+
+	FileWatcher::FileWatcher(Callback onModified)
+		: m_onModified(std::move(onModified))
+	{
+#if defined(__linux__)
+		m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (m_inotifyFd >= 0 && m_wakeFd >= 0)
+			m_thread = std::thread(&FileWatcher::WatchThread, this);
+#endif
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+#if defined(__linux__)
+		if (m_thread.joinable())
+		{
+			m_stop = true;
+			const uint64_t wake = 1;
+			[[maybe_unused]] const auto written = write(m_wakeFd, &wake, sizeof(wake));
+			m_thread.join();
+		}
+
+		if (m_inotifyFd >= 0)
+			close(m_inotifyFd);
+		if (m_wakeFd >= 0)
+			close(m_wakeFd);
+#else
+		// Directory watches have to be destroyed without holding the lock, as their callback threads may be waiting on it.
+		std::unordered_map<std::string, Directory> directories;
+		{
+			std::lock_guard lock(m_mutex);
+			directories.swap(m_directories);
+		}
+		for (auto& [key, directory] : directories)
+			DestroyDirectoryWatch(std::move(directory.Watch));
+#endif
+	}
+
+	bool FileWatcher::Watch(const std::filesystem::path& filename)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(filename, error))
+			return false;
+
+		const auto absolutePath = std::filesystem::absolute(filename, error).lexically_normal();
+		if (error)
+			return false;
+
+		const auto directoryKey = absolutePath.parent_path().string();
+		const auto name = absolutePath.filename().string();
+
+		std::lock_guard lock(m_mutex);
+
+		auto it = m_directories.find(directoryKey);
+		if (it == m_directories.end())
+		{
+			auto watch = CreateDirectoryWatch(directoryKey);
+			if (!watch)
+				return false;
+
+			it = m_directories.emplace(directoryKey, Directory{}).first;
+			it->second.Watch = std::move(watch);
+		}
+
+		auto& registeredPaths = it->second.Files[name];
+		if (std::find(registeredPaths.begin(), registeredPaths.end(), filename) == registeredPaths.end())
+			registeredPaths.push_back(filename);
+		return true;
+	}
+
+	void FileWatcher::Unwatch(const std::filesystem::path& filename)
+	{
+		std::error_code error;
+		const auto absolutePath = std::filesystem::absolute(filename, error).lexically_normal();
+		if (error)
+			return;
+
+		const auto directoryKey = absolutePath.parent_path().string();
+		const auto name = absolutePath.filename().string();
+
+		std::unique_ptr<PlatformDirectoryWatch> unusedWatch;
+		{
+			std::lock_guard lock(m_mutex);
+
+			const auto dirIt = m_directories.find(directoryKey);
+			if (dirIt == m_directories.end())
+				return;
+
+			auto& files = dirIt->second.Files;
+			const auto fileIt = files.find(name);
+			if (fileIt == files.end())
+				return;
+
+			auto& registeredPaths = fileIt->second;
+			registeredPaths.erase(std::remove(registeredPaths.begin(), registeredPaths.end(), filename), registeredPaths.end());
+			if (registeredPaths.empty())
+				files.erase(fileIt);
+
+			if (files.empty())
+			{
+				unusedWatch = std::move(dirIt->second.Watch);
+				m_directories.erase(dirIt);
+			}
+		}
+
+		if (unusedWatch)
+			DestroyDirectoryWatch(std::move(unusedWatch));
+	}
+
+	void FileWatcher::OnDirectoryEvent(const std::string& directoryKey, const std::string& filename)
+	{
+		std::vector<std::filesystem::path> modifiedPaths;
+		{
+			std::lock_guard lock(m_mutex);
+
+			const auto dirIt = m_directories.find(directoryKey);
+			if (dirIt == m_directories.end())
+				return;
+
+			const auto fileIt = dirIt->second.Files.find(filename);
+			if (fileIt == dirIt->second.Files.end())
+				return;
+
+			modifiedPaths = fileIt->second;
+		}
+
+		for (const auto& path : modifiedPaths)
+			m_onModified(path);
+	}
+
+	void FileWatcher::OnEventsLost()
+	{
+		std::vector<std::filesystem::path> watchedPaths;
+		{
+			std::lock_guard lock(m_mutex);
+			for (const auto& [directoryKey, directory] : m_directories)
+			{
+				for (const auto& [filename, registeredPaths] : directory.Files)
+					watchedPaths.insert(watchedPaths.end(), registeredPaths.begin(), registeredPaths.end());
+			}
+		}
+
+		for (const auto& path : watchedPaths)
+			m_onModified(path);
+	}
+
+#if defined(__linux__)
+	auto FileWatcher::CreateDirectoryWatch(const std::string& directoryKey) -> std::unique_ptr<PlatformDirectoryWatch>
+	{
+		if (m_inotifyFd < 0)
+			return nullptr;
+
+		// IN_CLOSE_WRITE instead of IN_MODIFY so one save is one event. Editors commonly save by writing a temporary file &
+		// renaming it over the original, hence IN_MOVED_TO.
+		const auto watchDescriptor = inotify_add_watch(m_inotifyFd, directoryKey.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watchDescriptor < 0)
+			return nullptr;
+
+		m_watchDirectories[watchDescriptor] = directoryKey;
+		return std::make_unique<PlatformDirectoryWatch>(PlatformDirectoryWatch{ watchDescriptor });
+	}
+
+	void FileWatcher::DestroyDirectoryWatch(std::unique_ptr<PlatformDirectoryWatch> watch)
+	{
+		std::lock_guard lock(m_mutex);
+		inotify_rm_watch(m_inotifyFd, watch->WatchDescriptor);
+		m_watchDirectories.erase(watch->WatchDescriptor);
+	}
+
+	void FileWatcher::WatchThread()
+	{
+		alignas(inotify_event) char buffer[1024 * 64];
+
+		pollfd pollFds[2]{};
+		pollFds[0].fd = m_inotifyFd;
+		pollFds[0].events = POLLIN;
+		pollFds[1].fd = m_wakeFd;
+		pollFds[1].events = POLLIN;
+
+		while (!m_stop)
+		{
+			if (poll(pollFds, 2, -1) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return;
+			}
+
+			if (m_stop)
+				return;
+
+			while (true)
+			{
+				const auto length = read(m_inotifyFd, buffer, sizeof(buffer));
+				if (length <= 0)
+					break;
+
+				for (ssize_t i = 0; i < length;)
+				{
+					const auto* event = reinterpret_cast<const inotify_event*>(&buffer[i]);
+					i += ssize_t(sizeof(inotify_event) + event->len);
+
+					if (event->mask & IN_Q_OVERFLOW)
+					{
+						OnEventsLost();
+						continue;
+					}
+
+					if (event->len == 0)
+						continue;
+
+					std::string directoryKey;
+					{
+						std::lock_guard lock(m_mutex);
+						const auto it = m_watchDirectories.find(event->wd);
+						if (it == m_watchDirectories.end())
+							continue;
+						directoryKey = it->second;
+					}
+					OnDirectoryEvent(directoryKey, event->name);
+				}
+			}
+		}
+	}
+#else
+	auto FileWatcher::CreateDirectoryWatch(const std::string& directoryKey) -> std::unique_ptr<PlatformDirectoryWatch>
+	{
+		try
+		{
+			auto watch = std::make_unique<PlatformDirectoryWatch>();
+			watch->Watch = std::make_unique<filewatch::FileWatch<std::string>>(directoryKey,
+				[this, directoryKey](const std::string& path, const filewatch::Event changeType) {
+					if (changeType == filewatch::Event::modified || changeType == filewatch::Event::added
+						|| changeType == filewatch::Event::renamed_new)
+						OnDirectoryEvent(directoryKey, std::filesystem::path(path).filename().string());
+				});
+			return watch;
+		}
+		catch (const std::exception& /*ex*/)
+		{
+			return nullptr;
+		}
+	}
+
+	void FileWatcher::DestroyDirectoryWatch(std::unique_ptr<PlatformDirectoryWatch> watch)
+	{
+		watch.reset();
+	}
+#endif
+
+} // namespace gfs
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace gfs
+{
+	/**
+	 * Watches many files for modification using a single watch per directory & a single thread.
+	 * On Linux all directories share one inotify instance. Other platforms use one `filewatch::FileWatch` per directory.
+	 */
+	class FileWatcher
+	{
+	public:
+		using Callback = std::function<void(const std::filesystem::path& filename)>;
+
+		/**
+		 * @param onModified Called from the watcher thread with the path a file was registered with when it is modified.
+		 * If events were lost (eg. The inotify queue overflowed) it is called for every watched file, as any may have changed.
+		 */
+		explicit FileWatcher(Callback onModified);
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		/**
+		 * @brief Starts watching a file. Thread-safe.
+		 * @param filename
+		 * @return True if the file is being watched.
+		 */
+		bool Watch(const std::filesystem::path& filename);
+
+		/**
+		 * @brief Stops watching a file. The directory watch is removed with the last file in it. Thread-safe.
+		 * @param filename
+		 */
+		void Unwatch(const std::filesystem::path& filename);
+
+	private:
+		struct PlatformDirectoryWatch;
+		struct Directory
+		{
+			std::unique_ptr<PlatformDirectoryWatch> Watch;
+			std::unordered_map<std::string, std::vector<std::filesystem::path>> Files; // Filename -> Registered paths.
+		};
+
+		auto CreateDirectoryWatch(const std::string& directoryKey) -> std::unique_ptr<PlatformDirectoryWatch>;
+		void DestroyDirectoryWatch(std::unique_ptr<PlatformDirectoryWatch> watch);
+
+		void OnDirectoryEvent(const std::string& directoryKey, const std::string& filename);
+		void OnEventsLost();
+#if defined(__linux__)
+		void WatchThread();
+#endif
+
+	private:
+		Callback m_onModified;
+
+		std::mutex m_mutex;
+		std::unordered_map<std::string, Directory> m_directories; // Keyed by absolute directory path.
+
+#if defined(__linux__)
+		int m_inotifyFd = -1;
+		int m_wakeFd = -1;
+		std::unordered_map<int, std::string> m_watchDirectories; // Watch descriptor -> Directory key.
+		std::atomic<bool> m_stop = false;
+		std::thread m_thread;
+#endif
+	};
+
+} // namespace gfs
@@ -2,39 +2,439 @@
 
 #include "gfs/binary_streams.hpp"
 #include "gfs/file_importer.hpp"
+#include "access_trace_recorder.hpp"
+#include "directory_mount.hpp"
+#include "file_io.hpp"
+#include "file_watcher.hpp"
+#include "format.hpp"
+#include "hash.hpp"
+#include "memory_mount.hpp"
+#include "shared_cache.hpp"
+#include "stats_collector.hpp"
+#include "thread_pool.hpp"
 
 #include <lz4.h>
 
 #include <cassert>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace gfs
 {
-	constexpr char FS_FORMAT_MAGIC_NUM[4] = { 'g', 'f', 's', 'f' }; // GFS Format
-	constexpr auto FS_FORMAT_VERSION = 1;
+	constexpr uint32_t FS_MOUNT_SCAN_BATCH_SIZE = 256; // Number of files validated per mount scan job.
 
-	constexpr uint32_t FS_FORMAT_PATH_LENGTH = 255;
+	constexpr char FS_MOUNT_INDEX_MAGIC_NUM[4] = { 'g', 'f', 's', 'i' }; // GFS Index
+	constexpr uint16_t FS_MOUNT_INDEX_VERSION = 3;
 
-	void Filesystem::Tick()
+	constexpr uint32_t FS_HASH_CHUNK_SIZE = 1024 * 1024; // Source files are hashed in 1MB chunks.
+
+	constexpr uint64_t FS_WRITE_BUFFER_INITIAL_CAPACITY = 1024 * 1024 * 10; // Same as the `WriteOnlyByteBuffer` default.
+
+	constexpr uint32_t FS_SNAPSHOT_SLOT_BLOCK_SIZE = 64;   // Per thread snapshot slots are allocated this many at a time.
+	constexpr uint32_t FS_SNAPSHOT_SLOT_BLOCK_COUNT = 256; // Threads beyond these blocks share a locked map.
+
+	// Reading a `FormatHeader` stores its version in the stream so file records that follow are parsed with the same layout.
+	static const int sFormatVersionIndex = std::ios_base::xalloc();
+
+	static auto GetStreamFormatVersion(std::ios_base& stream) -> long
 	{
-		std::lock_guard lock(m_hotReloadMutex);
-		while (!m_fileHotReloadQueue.empty())
+		const auto version = stream.iword(sFormatVersionIndex);
+		return version != 0 ? version : FS_FORMAT_VERSION;
+	}
+
+	// Size of a record as written by `operator<<(std::ostream&, const File&)`, so data offsets are known before writing.
+	static auto GetFileRecordSize(const File& file) -> uint32_t
+	{
+		return FS_FORMAT_MIN_RECORD_SIZE + sizeof(file.SourceHash) + sizeof(file.MetadataHash) + uint32_t(file.MountRelPath.string().size()) +
+			uint32_t(file.SourceFilename.string().size()) + uint32_t(file.MetadataStr.size()) + uint32_t(sizeof(FileID) * file.FileDependencies.size());
+	}
+
+	// 0 is reserved for "unknown" (eg. Files written before hashes were recorded).
+	static auto NonZeroHash(uint64_t hash) -> uint64_t
+	{
+		return hash != 0 ? hash : 1;
+	}
+
+	static bool HashFileContents(const std::filesystem::path& filename, uint64_t& outHash)
+	{
+		std::ifstream stream(filename, std::ios::binary);
+		if (!stream)
+			return false;
+
+		Hasher64 hasher;
+		std::vector<char> chunk(FS_HASH_CHUNK_SIZE);
+		while (stream)
+		{
+			stream.read(chunk.data(), std::streamsize(chunk.size()));
+			hasher.Update(chunk.data(), size_t(stream.gcount()));
+		}
+		if (stream.bad())
+			return false;
+
+		outHash = NonZeroHash(hasher.Finish());
+		return true;
+	}
+
+	static auto HashMetadata(const std::string& metadata) -> uint64_t
+	{
+		return NonZeroHash(Hasher64::Hash(metadata));
+	}
+
+	// Source file being imported on this thread. Files written by its importer are stamped with its hash without rehashing it.
+	struct ImportContext
+	{
+		std::string SourceFilename;
+		uint64_t SourceHash = 0;
+	};
+	thread_local ImportContext tImportContext;
+
+	struct ScopedImportContext
+	{
+		ImportContext Previous; // Importers may import other files.
+
+		ScopedImportContext(const std::filesystem::path& sourceFilename, uint64_t sourceHash) : Previous(std::move(tImportContext))
+		{
+			tImportContext = { sourceFilename.string(), sourceHash };
+		}
+		~ScopedImportContext() { tImportContext = std::move(Previous); }
+	};
+
+	// Mount index files may be truncated or corrupt, so every read is bounds checked.
+	template <typename T>
+	static bool ReadIndexValue(ReadOnlyByteBuffer& buffer, T& value)
+	{
+		if (buffer.GetSize() - buffer.GetPosition() < sizeof(T))
+			return false;
+
+		buffer.Read(value);
+		return true;
+	}
+
+	static bool ReadIndexString(ReadOnlyByteBuffer& buffer, std::string& value)
+	{
+		uint64_t strLen = 0;
+		if (!ReadIndexValue(buffer, strLen) || buffer.GetSize() - buffer.GetPosition() < strLen)
+			return false;
+
+		value.resize(strLen);
+		buffer.Read(strLen, reinterpret_cast<uint8_t*>(value.data()));
+		return true;
+	}
+
+	// Small index for each running thread, reused once the thread exits, so per thread state can be kept in arrays owned by
+	// each filesystem (& released with it) rather than in thread_locals that outlive it.
+	class ThreadIndexPool
+	{
+	public:
+		auto Acquire() -> uint32_t
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_freeIndices.empty())
+				return m_nextIndex++;
+
+			const auto index = m_freeIndices.back();
+			m_freeIndices.pop_back();
+			return index;
+		}
+
+		void Release(uint32_t index)
+		{
+			std::lock_guard lock(m_mutex);
+			m_freeIndices.push_back(index);
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::vector<uint32_t> m_freeIndices;
+		uint32_t m_nextIndex = 0;
+	};
+
+	static auto GetThreadIndexPool() -> ThreadIndexPool&
+	{
+		static ThreadIndexPool sPool;
+		return sPool;
+	}
+
+	struct ThreadIndex
+	{
+		uint32_t Value = GetThreadIndexPool().Acquire();
+		~ThreadIndex() { GetThreadIndexPool().Release(Value); }
+	};
+
+	static auto GetThreadIndex() -> uint32_t
+	{
+		thread_local ThreadIndex tIndex;
+		return tIndex.Value;
+	}
+
+	struct Filesystem::SnapshotSlots
+	{
+		struct Slot
+		{
+			std::shared_ptr<const FileSnapshot> Snapshot; // Only used by the thread with the slot's index.
+		};
+
+		// Allocated as threads first use them. Threads beyond the last block share a locked map instead.
+		std::array<std::atomic<Slot*>, FS_SNAPSHOT_SLOT_BLOCK_COUNT> Blocks{};
+		std::mutex OverflowMutex;
+		std::unordered_map<std::thread::id, Slot> OverflowSlots;
+
+		~SnapshotSlots()
+		{
+			for (auto& block : Blocks)
+				delete[] block.load(std::memory_order_relaxed);
+		}
+
+		auto GetSlot(uint32_t threadIndex) -> Slot*
+		{
+			const auto blockIndex = threadIndex / FS_SNAPSHOT_SLOT_BLOCK_SIZE;
+			if (blockIndex >= Blocks.size())
+				return nullptr;
+
+			auto* block = Blocks[blockIndex].load(std::memory_order_acquire);
+			if (block == nullptr)
+			{
+				auto* newBlock = new Slot[FS_SNAPSHOT_SLOT_BLOCK_SIZE];
+				if (Blocks[blockIndex].compare_exchange_strong(block, newBlock, std::memory_order_acq_rel))
+					block = newBlock;
+				else
+					delete[] newBlock; // Another thread added it first.
+			}
+			return &block[threadIndex % FS_SNAPSHOT_SLOT_BLOCK_SIZE];
+		}
+	};
+
+	Filesystem::Filesystem(Allocator* allocator)
+		: m_allocator(allocator != nullptr ? allocator : GetDefaultAllocator()),
+		  m_files(m_allocator),
+		  m_fileSnapshot(std::make_shared<FileSnapshot>()),
+		  m_snapshotSlots(std::make_unique<SnapshotSlots>()),
+		  m_stats(std::make_unique<StatsCollector>()),
+		  m_fileWatcher(std::make_unique<FileWatcher>([this](const std::filesystem::path& filename) { OnFileModified(filename); })),
+		  m_threadPool(std::make_unique<ThreadPool>())
+	{
+	}
+
+	Filesystem::~Filesystem() = default;
+
+	struct Filesystem::ReimportBatch
+	{
+		std::vector<FileID> Files;
+		std::vector<std::vector<uint32_t>> Dependents; // Batch indices of the files reimported after each file.
+		std::unique_ptr<std::atomic<uint32_t>[]> RemainingDependencies;
+		std::atomic<uint32_t> RemainingFiles = 0;
+
+		std::mutex ResultMutex;
+		std::deque<FileID> Reimported; // Successfully reimported files not yet passed to the reimport callback.
+	};
+
+	void Filesystem::Tick(std::chrono::microseconds timeBudget)
+	{
+		const auto startTime = std::chrono::steady_clock::now();
+
+		std::vector<FileID> filesToReimport;
+		{
+			std::lock_guard lock(m_hotReloadMutex);
+			for (auto it = m_pendingHotReloads.begin(); it != m_pendingHotReloads.end();)
+			{
+				if (startTime - it->second < m_hotReloadDebounce)
+				{
+					++it;
+					continue;
+				}
+
+				if (m_queuedHotReloads.insert(it->first).second)
+					m_fileHotReloadQueue.push_back(it->first);
+				it = m_pendingHotReloads.erase(it);
+			}
+			m_stats->MaxHotReloadQueueDepth.Max(m_pendingHotReloads.size() + m_fileHotReloadQueue.size());
+
+			// A new batch only starts once the previous one has been fully delivered, so the same file is never reimported
+			// twice at once & files queued meanwhile still wait for their dependencies.
+			if (!m_reimportBatch && !m_fileHotReloadQueue.empty())
+			{
+				filesToReimport.assign(m_fileHotReloadQueue.begin(), m_fileHotReloadQueue.end());
+				m_fileHotReloadQueue.clear();
+				m_queuedHotReloads.clear();
+			}
+		}
+
+		if (!filesToReimport.empty())
+			StartReimportBatch(std::move(filesToReimport));
+
+		if (!m_reimportBatch)
+			return;
+
+		// Deliver results on this thread.
+		while (true)
+		{
+			FileID reimportedFile;
+			{
+				std::lock_guard lock(m_reimportBatch->ResultMutex);
+				if (m_reimportBatch->Reimported.empty())
+				{
+					// Files push their result before counting themselves as done, so nothing can still be delivered.
+					if (m_reimportBatch->RemainingFiles.load(std::memory_order_acquire) == 0)
+						break;
+					return;
+				}
+
+				reimportedFile = m_reimportBatch->Reimported.front();
+				m_reimportBatch->Reimported.pop_front();
+			}
+
+			if (m_fileReimportCallback)
+				m_fileReimportCallback(reimportedFile);
+
+			// Compared in the budget's units, as converting `microseconds::max()` to the clock's units overflows.
+			if (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime) >= timeBudget)
+				return;
+		}
+
+		m_reimportBatch.reset();
+	}
+
+	void Filesystem::StartReimportBatch(std::vector<FileID> files)
+	{
+		auto batch = std::make_shared<ReimportBatch>();
+		batch->Files = std::move(files);
+
+		const auto fileCount = uint32_t(batch->Files.size());
+		std::unordered_map<FileID, uint32_t> batchIndices;
+		for (uint32_t i = 0; i < fileCount; ++i)
+			batchIndices[batch->Files[i]] = i;
+
+		// Dependency edges within the batch. Dependents are used as they are indexed even when cold fields are not resident.
+		batch->Dependents.resize(fileCount);
+		{
+			const auto& files = AcquireFileSnapshot();
+			for (uint32_t i = 0; i < fileCount; ++i)
+			{
+				for (const auto dependent : files.GetDependents(batch->Files[i]))
+				{
+					const auto it = batchIndices.find(dependent);
+					if (it != batchIndices.end() && it->second != i)
+						batch->Dependents[i].push_back(it->second);
+				}
+			}
+		}
+
+		auto countDependencies = [&]() {
+			std::vector<uint32_t> dependencyCounts(fileCount, 0);
+			for (const auto& dependents : batch->Dependents)
+			{
+				for (const auto dependent : dependents)
+					++dependencyCounts[dependent];
+			}
+			return dependencyCounts;
+		};
+		auto dependencyCounts = countDependencies();
+
+		// Files in (or after) a dependency cycle would never become ready, so edges between them are dropped.
+		{
+			auto remaining = dependencyCounts;
+			std::vector<uint32_t> ready;
+			for (uint32_t i = 0; i < fileCount; ++i)
+			{
+				if (remaining[i] == 0)
+					ready.push_back(i);
+			}
+
+			std::vector<bool> resolved(fileCount, false);
+			while (!ready.empty())
+			{
+				const auto index = ready.back();
+				ready.pop_back();
+				resolved[index] = true;
+				for (const auto dependent : batch->Dependents[index])
+				{
+					if (--remaining[dependent] == 0)
+						ready.push_back(dependent);
+				}
+			}
+
+			bool hasCycle = false;
+			for (uint32_t i = 0; i < fileCount; ++i)
+			{
+				if (resolved[i])
+					continue;
+
+				hasCycle = true;
+				auto& dependents = batch->Dependents[i];
+				dependents.erase(std::remove_if(dependents.begin(), dependents.end(), [&](uint32_t dependent) { return !resolved[dependent]; }),
+					dependents.end());
+			}
+
+			if (hasCycle)
+				dependencyCounts = countDependencies();
+		}
+
+		batch->RemainingDependencies = std::make_unique<std::atomic<uint32_t>[]>(fileCount);
+		for (uint32_t i = 0; i < fileCount; ++i)
+			batch->RemainingDependencies[i] = dependencyCounts[i];
+		batch->RemainingFiles = fileCount;
+
+		m_reimportBatch = batch;
+
+		for (uint32_t i = 0; i < fileCount; ++i)
 		{
-			auto fileToReimport = m_fileHotReloadQueue.front();
-			m_fileHotReloadQueue.pop();
-			Reimport(fileToReimport);
+			if (dependencyCounts[i] == 0)
+				SubmitReimport(batch, i);
 		}
 	}
 
-	auto Filesystem::MountDir(const std::filesystem::path& rootDir, bool allowUnmount) -> MountID
+	void Filesystem::SubmitReimport(const std::shared_ptr<ReimportBatch>& batch, uint32_t index)
+	{
+		m_threadPool->Submit([this, batch, index]() {
+			const auto fileId = batch->Files[index];
+
+			auto result = ImportStatus::Failed;
+			try
+			{
+				result = Reimport_Internal(fileId);
+			}
+			catch (...)
+			{
+				// Failed reimports must still release their dependents.
+			}
+
+			if (result == ImportStatus::Imported)
+			{
+				std::lock_guard lock(batch->ResultMutex);
+				batch->Reimported.push_back(fileId);
+			}
+
+			// Dependents are submitted once their last dependency in the batch has been reimported.
+			for (const auto dependent : batch->Dependents[index])
+			{
+				if (batch->RemainingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+					SubmitReimport(batch, dependent);
+			}
+
+			batch->RemainingFiles.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	auto Filesystem::MountDir(const std::filesystem::path& rootDir, bool allowUnmount, int32_t priority, const std::filesystem::path& indexFilename)
+		-> MountID
 	{
 		if (!std::filesystem::exists(rootDir))
 			return InvalidMountId;
@@ -42,35 +442,143 @@ namespace gfs
 		if (!std::filesystem::is_directory(rootDir))
 			return InvalidMountId;
 
-		auto& mount = m_mountMap[m_nextMountId];
-		mount.RootDirPath = rootDir;
-		mount.AllowUnmount = allowUnmount;
-		mount.Id = m_nextMountId++;
-		assert(mount.Id != InvalidMountId);
+		Mount mount{};
+		{
+			std::unique_lock mountLock(m_mountMutex);
+			mount.RootDirPath = rootDir;
+			mount.Backend = std::make_shared<DirectoryMount>(rootDir, m_stats.get());
+			if (!indexFilename.empty())
+				mount.IndexFilename = rootDir / indexFilename; // Absolute paths replace the root.
+			mount.AllowUnmount = allowUnmount;
+			mount.Priority = priority;
+			mount.Id = m_nextMountId++;
+			assert(mount.Id != InvalidMountId);
+			m_mountMap[mount.Id] = mount;
+		}
+
+		{
+			std::lock_guard lock(m_fileMutex);
+			m_files.SetMountPriority(mount.Id, mount.Priority);
+		}
 
 		GatherFilesInMount(mount);
 
 		return mount.Id;
 	}
 
-	bool Filesystem::UnmountDir(MountID id)
+	auto Filesystem::MountMemory(bool allowUnmount, int32_t priority) -> MountID
 	{
-		const auto it = m_mountMap.find(id);
-		if (it == m_mountMap.end())
+		Mount mount{};
+		{
+			std::unique_lock mountLock(m_mountMutex);
+			mount.AllowUnmount = allowUnmount;
+			mount.Priority = priority;
+			mount.Backend = std::make_shared<MemoryMount>(m_allocator);
+			mount.Id = m_nextMountId++;
+			assert(mount.Id != InvalidMountId);
+			m_mountMap[mount.Id] = mount;
+		}
+
+		std::lock_guard lock(m_fileMutex);
+		m_files.SetMountPriority(mount.Id, mount.Priority);
+		return mount.Id;
+	}
+
+	bool Filesystem::LoadIntoMemory(MountID mountId, const std::filesystem::path& filename, const std::filesystem::path& mountRelPath)
+	{
+		Mount mount{};
+		if (!GetMount_Internal(mountId, mount))
+			return false;
+
+		std::error_code error;
+		const auto fileSize = std::filesystem::file_size(filename, error);
+		if (error)
 			return false;
 
-		if (!it->second.AllowUnmount)
+		std::ifstream stream(filename, std::ios::binary);
+		m_stats->FileOpens.Add();
+
+		PendingWrite write{};
+		const auto normalMountRelPath = FileRegistry::NormalizePath(mountRelPath);
+		write.MountId = mountId;
+		write.Files = ReadFileRecords(stream, fileSize, normalMountRelPath, mountId);
+		if (write.Files.empty())
 			return false;
 
-		m_mountMap.erase(it);
+		// Placed so the data of the first file is aligned & can be read in place.
+		uint64_t dataStartOffset = fileSize;
+		for (const auto& file : write.Files)
+			dataStartOffset = std::min<uint64_t>(dataStartOffset, file.Offset);
+
+		stream.clear();
+		stream.seekg(0);
+		write.Staged = mount.Backend->StageCopy(normalMountRelPath, stream, fileSize, dataStartOffset);
+		if (!write.Staged)
+			return false; // Not an in-memory mount, out of memory or the file could not be read.
+		m_stats->BytesRead.Add(fileSize);
+
+		for (const auto& file : write.Files)
+		{
+			if (!file.SourceFilename.empty())
+				CreateFileWatch(file.SourceFilename);
+		}
+
+		return FinalizeWrites({ write });
+	}
+
+	bool Filesystem::UnmountDir(MountID id)
+	{
+		{
+			// The mount is removed before its files so files written to it concurrently are either rejected or removed.
+			std::unique_lock mountLock(m_mountMutex);
+			const auto it = m_mountMap.find(id);
+			if (it == m_mountMap.end())
+				return false;
+
+			if (!it->second.AllowUnmount)
+				return false;
+
+			m_mountMap.erase(it);
+		}
+
+		std::vector<std::string> unwatchedSourceFilenames;
+		{
+			std::lock_guard lock(m_fileMutex);
+
+			std::unordered_set<uint32_t> sourceFilenameIds;
+			for (uint32_t i = 0; i < m_files.GetCount(); ++i)
+			{
+				if (m_files.GetMountId(i) == id && m_files.GetSourceFilenameId(i) != FileRegistry::EmptyPathId)
+					sourceFilenameIds.insert(m_files.GetSourceFilenameId(i));
+			}
+
+			m_files.RemoveMount(id); // Unshadows files at the same paths in other mounts.
+			m_fileVersion.fetch_add(1, std::memory_order_release);
+
+			// Source files are only unwatched once no file in any mount was imported from them.
+			for (const auto sourceFilenameId : sourceFilenameIds)
+			{
+				const auto& sourceFilename = m_files.GetPath(sourceFilenameId);
+				if (m_files.GetFilesWithSourceFile(sourceFilename).empty())
+					unwatchedSourceFilenames.push_back(sourceFilename);
+			}
+		}
+
+		for (const auto& sourceFilename : unwatchedSourceFilenames)
+			m_fileWatcher->Unwatch(sourceFilename);
+
 		return true;
 	}
 
 	auto Filesystem::GetMountId(const std::filesystem::path& rootDir) -> MountID
 	{
 		const auto rootDirAbs = std::filesystem::absolute(rootDir);
+		std::shared_lock mountLock(m_mountMutex);
 		for (const auto& [id, mount] : m_mountMap)
 		{
+			if (mount.RootDirPath.empty())
+				continue; // In-memory mount.
+
 			const auto mountDirAbs = std::filesystem::absolute(mount.RootDirPath);
 			if (rootDirAbs == mountDirAbs)
 				return mount.Id;
@@ -78,31 +586,124 @@ namespace gfs
 		return InvalidMountId;
 	}
 
-	auto Filesystem::GetMount(MountID mountId) -> const Mount*
+	bool Filesystem::Mount::IsInMemory() const
 	{
-		return GetMount_Internal(mountId);
+		return Backend && Backend->IsInMemory();
+	}
+
+	auto Filesystem::GetMount(MountID mountId) -> std::optional<Mount>
+	{
+		std::shared_lock mountLock(m_mountMutex);
+		const auto it = m_mountMap.find(mountId);
+		if (it == m_mountMap.end())
+			return std::nullopt;
+
+		return it->second;
 	}
 
 	void Filesystem::ForEachMount(const std::function<void(const Mount&)>& func)
 	{
-		for (const auto& [id, mount] : m_mountMap)
+		// Copied so `func` is free to mount/unmount.
+		for (const auto& mount : GetMounts_Internal())
 			func(mount);
 	}
 
-	auto Filesystem::GetFile(FileID id) const -> const File*
+	void Filesystem::SetMountIndexEnabled(bool enabled)
 	{
-		const auto it = m_files.find(id);
-		if (it == m_files.end())
-			return nullptr;
+		m_mountIndexEnabled.store(enabled, std::memory_order_relaxed);
+	}
 
-		return &it->second;
+	void Filesystem::SetLazyFileMetadata(bool enabled)
+	{
+		std::lock_guard lock(m_fileMutex);
+		m_lazyFileMetadata.store(enabled, std::memory_order_relaxed);
+		m_files.SetColdFieldsResident(!enabled);
+	}
+
+	auto Filesystem::GetFileSourceFilename(FileID id) -> std::filesystem::path
+	{
+		const auto& files = AcquireFileSnapshot();
+		const auto index = files.Find(id);
+		if (index == FileRegistry::InvalidIndex)
+			return {};
+
+		return files.GetSourceFilename(index);
+	}
+
+	auto Filesystem::GetFileMetadata(FileID id) -> std::string
+	{
+		File file{};
+		if (!GetFullFile(id, file))
+			return {};
+
+		return file.MetadataStr;
+	}
+
+	auto Filesystem::GetFileDependencies(FileID id) -> std::vector<FileID>
+	{
+		File file{};
+		if (!GetFullFile(id, file))
+			return {};
+
+		return file.FileDependencies;
+	}
+
+	auto Filesystem::GetFile(FileID id) const -> std::optional<File>
+	{
+		const auto& files = AcquireFileSnapshot();
+		const auto index = files.Find(id);
+		if (index == FileRegistry::InvalidIndex)
+			return std::nullopt;
+
+		return files.GetFile(index);
+	}
+
+	auto Filesystem::FindFile(const std::filesystem::path& path) const -> FileID
+	{
+		const auto& files = AcquireFileSnapshot();
+		const auto index = files.FindByPath(FileRegistry::NormalizePath(path));
+		return index == FileRegistry::InvalidIndex ? InvalidFileId : files.GetFileId(index);
+	}
+
+	auto Filesystem::FindFile(const std::filesystem::path& path, MountID mountId) const -> FileID
+	{
+		const auto& files = AcquireFileSnapshot();
+		const auto index = files.FindByPath(FileRegistry::NormalizePath(path), mountId);
+		return index == FileRegistry::InvalidIndex ? InvalidFileId : files.GetFileId(index);
+	}
+
+	auto Filesystem::GetDependents(FileID id, bool recursive) const -> std::vector<FileID>
+	{
+		const auto& files = AcquireFileSnapshot();
+		auto dependents = files.GetDependents(id);
+		if (!recursive)
+			return dependents;
+
+		// Breadth first walk over the reverse dependency graph. Only touches affected files.
+		std::unordered_set<FileID> visited(dependents.begin(), dependents.end());
+		for (size_t i = 0; i < dependents.size(); ++i)
+		{
+			for (auto dependent : files.GetDependents(dependents[i]))
+			{
+				if (visited.insert(dependent).second)
+					dependents.push_back(dependent);
+			}
+		}
+		return dependents;
+	}
+
+	auto Filesystem::GetFileSnapshot() const -> std::shared_ptr<const FileRegistry>
+	{
+		auto snapshot = GetLatestFileSnapshot();
+		return std::shared_ptr<const FileRegistry>(snapshot, &snapshot->Files);
 	}
 
 	void Filesystem::ForEachFile(const std::function<void(const File& file)>& func)
 	{
-		std::lock_guard lock(m_fileMutex);
-		for (const auto& [id, file] : m_files)
-			func(file);
+		// Hold our own reference so `func` is free to call back into the filesystem.
+		const auto snapshot = GetLatestFileSnapshot();
+		for (uint32_t index = 0; index < snapshot->Files.GetCount(); ++index)
+			func(snapshot->Files.GetFile(index));
 	}
 
 	bool Filesystem::WriteFile(MountID mountId,
@@ -114,28 +715,35 @@ namespace gfs
 		const std::filesystem::path& sourceFilename,
 		const std::string& metadata)
 	{
-		auto* mount = GetMount_Internal(mountId);
-		if (!mount)
+		ScopedAccessTrace trace(GetAccessTrace(), AccessType::Write, fileId);
+
+		Mount mount{};
+		if (!GetMount_Internal(mountId, mount))
 			return false;
 
-		WriteOnlyByteBuffer uncompressedDataBuffer;
+		WriteOnlyByteBuffer uncompressedDataBuffer(FS_WRITE_BUFFER_INITIAL_CAPACITY, m_allocator, MemoryCategory::FileData);
 		dataObject.Write(uncompressedDataBuffer);
+		trace.Size = uncompressedDataBuffer.GetSize();
+
+		const auto* payloadData = uncompressedDataBuffer.GetData();
+		auto payloadSize = uncompressedDataBuffer.GetSize();
 
-		bool shouldCompress = compress && uncompressedDataBuffer.GetSize() >= FS_COMPRESS_MIN_FILE_SIZE_BYTES;
-		WriteOnlyByteBuffer compressedDataBuffer;
-		if (shouldCompress)
+		std::vector<char, StlAllocator<char>> compressedData(StlAllocator<char>(m_allocator, MemoryCategory::Compression));
+		if (compress && uncompressedDataBuffer.GetSize() >= FS_COMPRESS_MIN_FILE_SIZE_BYTES)
 		{
-			compressedDataBuffer.SetSize(uncompressedDataBuffer.GetSize());
-			const uint32_t compressedSize = LZ4_compress_default(reinterpret_cast<const char*>(uncompressedDataBuffer.GetData()),
-				reinterpret_cast<char*>(compressedDataBuffer.GetData()),
+			compressedData.resize(size_t(LZ4_compressBound(int32_t(uncompressedDataBuffer.GetSize()))));
+			ScopedStatTimer timer(m_stats->CompressTime);
+			const auto compressedSize = LZ4_compress_default(reinterpret_cast<const char*>(uncompressedDataBuffer.GetData()),
+				compressedData.data(),
 				int32_t(uncompressedDataBuffer.GetSize()),
-				int32_t(compressedDataBuffer.GetSize()));
-			compressedDataBuffer.SetSize(compressedSize);
-		}
-		else
-		{
-			compressedDataBuffer.SetSize(uncompressedDataBuffer.GetSize());
-			compressedDataBuffer.Write(uncompressedDataBuffer.GetSize(), uncompressedDataBuffer.GetData());
+				int32_t(compressedData.size()));
+
+			// Incompressible data is stored as is (equal sizes mark a file as uncompressed).
+			if (compressedSize > 0 && uint64_t(compressedSize) < uncompressedDataBuffer.GetSize())
+			{
+				payloadData = reinterpret_cast<const uint8_t*>(compressedData.data());
+				payloadSize = uint64_t(compressedSize);
+			}
 		}
 
 		FormatHeader header{};
@@ -150,154 +758,489 @@ namespace gfs
 		file.SourceFilename = sourceFilename;
 		file.MetadataStr = metadata;
 		file.FileDependencies = fileDependencies;
+		file.MetadataHash = HashMetadata(metadata);
+		if (!sourceFilename.empty())
+		{
+			if (tImportContext.SourceHash != 0 && tImportContext.SourceFilename == sourceFilename.string())
+				file.SourceHash = tImportContext.SourceHash;
+			else if (!HashFileContents(sourceFilename, file.SourceHash))
+				file.SourceHash = 0;
+		}
 		file.UncompressedSize = uint32_t(uncompressedDataBuffer.GetSize());
-		file.CompressedSize = uint32_t(compressedDataBuffer.GetSize());
+		file.CompressedSize = uint32_t(payloadSize);
+		file.RecordOffset = FS_FORMAT_HEADER_SIZE;
+		file.Offset = file.RecordOffset + GetFileRecordSize(file);
 
-		std::ofstream stream(mount->RootDirPath / filename, std::ios::binary);
-		if (!stream)
+		// Header & record are assembled in memory so the whole file is written with a single call.
+		std::ostringstream recordStream(std::ios::binary);
+		recordStream << header << file;
+		const auto records = recordStream.str();
+		assert(records.size() == file.Offset);
+
+		if (!file.SourceFilename.empty())
+			CreateFileWatch(file.SourceFilename);
+
+		trace.Succeeded = CommitWrite_Internal(mount, filename, { { records.data(), records.size() }, { payloadData, size_t(payloadSize) } }, { file });
+		return trace.Succeeded;
+	}
+
+	bool Filesystem::ReadFile(FileID fileId, BinaryStreamable& dataObject, ReadMode mode)
+	{
+		ScopedStatTimer timer(m_stats->ReadFileLatency);
+		ScopedAccessTrace trace(GetAccessTrace(), AccessType::Read, fileId);
+
+		std::unique_ptr<MountFile> mountFile;
+		File file{};
+		{
+			const auto& files = AcquireFileSnapshot();
+			const auto index = files.Find(fileId);
+			if (index == FileRegistry::InvalidIndex)
+				return false;
+
+			Mount mount{};
+			if (!GetMount_Internal(files.GetMountId(index), mount))
+				return false;
+
+			mountFile = mount.Backend->Open(files.GetMountRelPath(index));
+			if (!mountFile)
+				return false;
+			file.UncompressedSize = files.GetUncompressedSize(index);
+			file.CompressedSize = files.GetCompressedSize(index);
+			file.Offset = files.GetOffset(index);
+		}
+		trace.Size = file.UncompressedSize;
+
+		// Files held in memory are read in place.
+		if (const auto* payload = mountFile->GetResident(file.Offset, file.CompressedSize))
+		{
+			m_stats->BytesRead.Add(file.CompressedSize);
+			m_stats->FilesRead.Add();
+			trace.Succeeded = ReadPayload(payload, file, dataObject);
+			return trace.Succeeded;
+		}
+
+		if (const auto sharedCache = GetSharedCache())
+		{
+			if (const auto succeeded = ReadFileShared(*sharedCache, fileId, *mountFile, file, dataObject))
+			{
+				trace.Succeeded = *succeeded;
+				return trace.Succeeded;
+			}
+		}
+
+		const auto uncachedReadThreshold = m_uncachedReadThreshold.load(std::memory_order_relaxed);
+		if (mode == ReadMode::Uncached || (mode == ReadMode::Default && uncachedReadThreshold != 0 && file.CompressedSize >= uncachedReadThreshold))
+		{
+			trace.Succeeded = ReadFileUncached(*mountFile, file, dataObject);
+			return trace.Succeeded;
+		}
+
+		const bool isCompressed = file.CompressedSize != file.UncompressedSize;
+
+		ReadOnlyByteBuffer decompressedBuffer(file.UncompressedSize, m_allocator, MemoryCategory::FileData);
+		ReadOnlyByteBuffer compressedBuffer(isCompressed ? file.CompressedSize : 0, m_allocator, MemoryCategory::Compression);
+		if (decompressedBuffer.GetData() == nullptr || compressedBuffer.GetData() == nullptr)
+			return false; // Out of memory, eg. The allocator's budget is exhausted.
+
+		auto* readData = static_cast<uint8_t*>(isCompressed ? compressedBuffer.GetData() : decompressedBuffer.GetData());
+		const auto bytesRead = mountFile->Read(file.Offset, file.CompressedSize, readData);
+		m_stats->BytesRead.Add(bytesRead);
+		m_stats->FilesRead.Add();
+		if (isCompressed)
+		{
+			const auto* srcPtr = reinterpret_cast<const char*>(compressedBuffer.GetData());
+			auto* dstPtr = reinterpret_cast<char*>(decompressedBuffer.GetData());
+			int bytes = 0;
+			{
+				ScopedStatTimer decompressTimer(m_stats->DecompressTime);
+				bytes = LZ4_decompress_safe(srcPtr, dstPtr, int32_t(compressedBuffer.GetSize()), int32_t(decompressedBuffer.GetSize()));
+			}
+
+			if (uint32_t(bytes) != file.UncompressedSize)
+				return false; // Did not decompress to original size.
+		}
+
+		dataObject.Read(decompressedBuffer);
+
+		trace.Succeeded = true;
+		return true;
+	}
+
+	bool Filesystem::ReadFileUncached(MountFile& mountFile, const File& file, BinaryStreamable& dataObject)
+	{
+		const bool isCompressed = file.CompressedSize != file.UncompressedSize;
+
+		AlignedBuffer buffer;
+		const auto* payload = mountFile.ReadUncached(
+			file.Offset, file.CompressedSize, buffer, m_allocator, isCompressed ? MemoryCategory::Compression : MemoryCategory::FileData);
+		if (payload == nullptr)
 			return false;
 
-		stream.unsetf(std::ios::skipws);
+		m_stats->BytesRead.Add(file.CompressedSize);
+		m_stats->FilesRead.Add();
+
+		// Data read into the buffer starts part way into the first block. Moved to the (aligned) start so it is read in place.
+		if (!isCompressed && buffer.GetData() != nullptr && payload != buffer.GetData())
+		{
+			std::memmove(buffer.GetData(), payload, file.CompressedSize);
+			payload = buffer.GetData();
+		}
+		return ReadPayload(payload, file, dataObject);
+	}
 
-		stream << header;
-		stream << file;
-		file.Offset = uint32_t(stream.tellp());
-		const uint32_t offsetPos = file.Offset - sizeof(file.Offset);
+	auto Filesystem::ReadFileShared(SharedCache& cache, FileID fileId, MountFile& mountFile, const File& file, BinaryStreamable& dataObject) -> std::optional<bool>
+	{
+		const auto fileVersion = mountFile.GetVersion();
+		if (fileVersion == 0)
+			return std::nullopt;
 
-		stream.write(reinterpret_cast<const char*>(compressedDataBuffer.GetData()), compressedDataBuffer.GetSize());
+		const uint64_t versionFields[] = { fileVersion, file.Offset, file.CompressedSize, file.UncompressedSize };
+		const auto version = Hasher64::Hash(versionFields, sizeof(versionFields));
+		if (const auto* data = cache.Find(fileId, version, file.UncompressedSize))
+		{
+			m_stats->SharedCacheHits.Add();
+			ReadOnlyByteBuffer buffer(data, file.UncompressedSize);
+			dataObject.Read(buffer);
+			return true;
+		}
+		m_stats->SharedCacheMisses.Add();
 
-		// Go back and write data offset
-		stream.seekp(offsetPos, std::ios::beg);
-		stream.write(reinterpret_cast<const char*>(&file.Offset), sizeof(file.Offset));
+		// Decompressed straight into the cache, so a miss does not hold a private copy either.
+		const auto entry = cache.Reserve(fileId, version, file.UncompressedSize);
+		if (entry.Data == nullptr)
+			return std::nullopt;
 
+		const bool isCompressed = file.CompressedSize != file.UncompressedSize;
+		ReadOnlyByteBuffer compressedBuffer(isCompressed ? file.CompressedSize : 0, m_allocator, MemoryCategory::Compression);
+		if (compressedBuffer.GetData() == nullptr)
 		{
-			std::lock_guard lock(m_fileMutex);
-			m_files[file.FileId] = file; // Register new file.
+			// Not a failure of the file, so it is still read without the cache.
+			cache.Abandon(entry);
+			return std::nullopt;
 		}
 
-		if (!file.SourceFilename.empty())
-			CreateFileWatch(file.SourceFilename);
+		auto* readData = isCompressed ? static_cast<uint8_t*>(compressedBuffer.GetData()) : entry.Data;
+		const auto bytesRead = mountFile.Read(file.Offset, file.CompressedSize, readData);
+		m_stats->BytesRead.Add(bytesRead);
+		m_stats->FilesRead.Add();
+
+		bool succeeded = bytesRead == file.CompressedSize;
+		if (succeeded && isCompressed)
+		{
+			ScopedStatTimer decompressTimer(m_stats->DecompressTime);
+			const auto bytes = LZ4_decompress_safe(reinterpret_cast<const char*>(compressedBuffer.GetData()),
+				reinterpret_cast<char*>(entry.Data),
+				int32_t(file.CompressedSize),
+				int32_t(file.UncompressedSize));
+			succeeded = uint32_t(bytes) == file.UncompressedSize;
+		}
+		if (!succeeded)
+		{
+			cache.Abandon(entry);
+			return false;
+		}
+		cache.Publish(entry);
 
+		ReadOnlyByteBuffer buffer(entry.Data, file.UncompressedSize);
+		dataObject.Read(buffer);
 		return true;
 	}
 
-	bool Filesystem::ReadFile(FileID fileId, BinaryStreamable& dataObject)
+	bool Filesystem::ReadPayload(const uint8_t* payload, const File& file, BinaryStreamable& dataObject)
 	{
-		auto* file = GetFile(fileId);
-		if (!file)
+		if (file.CompressedSize == file.UncompressedSize)
+		{
+			// Read in place when aligned like an allocated buffer (Always true for the first file in a memory file).
+			if (reinterpret_cast<uintptr_t>(payload) % alignof(std::max_align_t) == 0)
+			{
+				ReadOnlyByteBuffer buffer(payload, file.UncompressedSize);
+				dataObject.Read(buffer);
+				return true;
+			}
+
+			ReadOnlyByteBuffer buffer(file.UncompressedSize, m_allocator, MemoryCategory::FileData);
+			if (buffer.GetData() == nullptr)
+				return false;
+			std::memcpy(buffer.GetData(), payload, file.UncompressedSize);
+			dataObject.Read(buffer);
+			return true;
+		}
+
+		// Compressed files are decompressed straight from the payload.
+		ReadOnlyByteBuffer decompressedBuffer(file.UncompressedSize, m_allocator, MemoryCategory::FileData);
+		if (decompressedBuffer.GetData() == nullptr)
 			return false;
 
-		auto* mount = GetMount_Internal(file->MountId);
-		if (!mount)
+		int bytes = 0;
+		{
+			ScopedStatTimer decompressTimer(m_stats->DecompressTime);
+			bytes = LZ4_decompress_safe(reinterpret_cast<const char*>(payload),
+				reinterpret_cast<char*>(decompressedBuffer.GetData()),
+				int32_t(file.CompressedSize),
+				int32_t(file.UncompressedSize));
+		}
+		if (uint32_t(bytes) != file.UncompressedSize)
 			return false;
 
-		std::ifstream stream(mount->RootDirPath / file->MountRelPath, std::ios::binary);
-		stream.unsetf(std::ios::skipws);
-		stream.seekg(file->Offset);
+		dataObject.Read(decompressedBuffer);
+		return true;
+	}
 
-		const bool isCompressed = file->CompressedSize != file->UncompressedSize;
+	bool Filesystem::CreateArchive(MountID mountId, const std::filesystem::path& filename, const std::vector<FileID>& files)
+	{
+		Mount mount{};
+		if (!GetMount_Internal(mountId, mount))
+			return false;
 
-		ReadOnlyByteBuffer decompressedBuffer(file->UncompressedSize);
-		ReadOnlyByteBuffer compressedBuffer(isCompressed ? file->CompressedSize : 0);
+		// Gather full file records (cold fields included) & calculate total data size & data offsets
+		std::vector<File> archiveFiles(files.size());
+		uint64_t totalDataSize = 0;
+		std::vector<uint64_t> fileDataOffsets(files.size());
+		for (auto i = 0; i < files.size(); ++i)
+		{
+			if (!GetFullFile(files[i], archiveFiles[i]))
+				return false;
 
-		stream.read(reinterpret_cast<char*>(isCompressed ? compressedBuffer.GetData() : decompressedBuffer.GetData()), file->CompressedSize);
-		if (isCompressed)
+			fileDataOffsets[i] = totalDataSize;
+			totalDataSize += archiveFiles[i].CompressedSize;
+		}
+
+		// Gather file data
+		ReadOnlyByteBuffer dataBuffer(totalDataSize, m_allocator, MemoryCategory::FileData);
+		if (dataBuffer.GetData() == nullptr)
+			return false;
+		for (auto i = 0; i < files.size(); ++i)
 		{
-			const auto* srcPtr = reinterpret_cast<const char*>(compressedBuffer.GetData());
-			auto* dstPtr = reinterpret_cast<char*>(decompressedBuffer.GetData());
-			int bytes = LZ4_decompress_safe(srcPtr, dstPtr, int32_t(compressedBuffer.GetSize()), int32_t(decompressedBuffer.GetSize()));
+			const auto& file = archiveFiles[i];
+			Mount fileMount{};
+			if (!GetMount_Internal(file.MountId, fileMount))
+				return false;
 
-			if (uint32_t(bytes) != file->UncompressedSize)
-				return false; // Did not decompress to original size.
+			auto* dataWriteOffset = static_cast<uint8_t*>(dataBuffer.GetData()) + fileDataOffsets[i];
+			const auto mountFile = fileMount.Backend->Open(file.MountRelPath.generic_string());
+			if (!mountFile)
+				return false;
+
+			const auto bytesRead = mountFile->Read(file.Offset, file.CompressedSize, dataWriteOffset);
+			m_stats->BytesRead.Add(bytesRead);
+			if (bytesRead != file.CompressedSize)
+				return false;
 		}
 
-		dataObject.Read(decompressedBuffer);
+		FormatHeader header{};
+		std::memcpy(header.MagicNumber, FS_FORMAT_MAGIC_NUM, sizeof(FS_FORMAT_MAGIC_NUM));
+		header.FormatVersion = FS_FORMAT_VERSION;
+		header.FileCount = files.size();
+
+		// Record sizes are known up front, so data offsets can be set before anything is written.
+		uint32_t recordOffset = FS_FORMAT_HEADER_SIZE;
+		for (auto& file : archiveFiles)
+		{
+			file.MountId = mountId;		  // Update mount id.
+			file.MountRelPath = filename; // Update filename to archive file.
+			file.RecordOffset = recordOffset;
+			recordOffset += GetFileRecordSize(file);
+		}
+		const uint32_t dataStartOffset = recordOffset;
+		for (auto i = 0; i < files.size(); ++i)
+			archiveFiles[i].Offset = dataStartOffset + uint32_t(fileDataOffsets[i]);
+
+		std::ostringstream recordStream(std::ios::binary);
+		recordStream << header;
+		for (const auto& file : archiveFiles)
+			recordStream << file;
+		const auto records = recordStream.str();
+		assert(records.size() == dataStartOffset);
+
+		// Files now live in the archive.
+		return CommitWrite_Internal(
+			mount, filename, { { records.data(), records.size() }, { dataBuffer.GetData(), size_t(dataBuffer.GetSize()) } }, std::move(archiveFiles));
+	}
+
+	void Filesystem::SetUncachedReadThreshold(uint64_t minSize)
+	{
+		m_uncachedReadThreshold.store(minSize, std::memory_order_relaxed);
+	}
+
+	bool Filesystem::EnableSharedCache(const std::string& name, uint64_t capacity, uint32_t maxEntries)
+	{
+		auto cache = SharedCache::Open(name, capacity, maxEntries);
+		if (!cache)
+			return false;
+
+		std::atomic_store(&m_sharedCache, std::move(cache));
+		m_sharedCacheEnabled = true;
+		return true;
+	}
+
+	void Filesystem::DisableSharedCache()
+	{
+		// Reads still holding the cache keep it mapped until they finish.
+		m_sharedCacheEnabled = false;
+		std::atomic_store(&m_sharedCache, std::shared_ptr<SharedCache>());
+	}
+
+	bool Filesystem::RemoveSharedCache(const std::string& name)
+	{
+		return SharedCache::Remove(name);
+	}
 
-		return true;
+	void Filesystem::SetDurableWrites(bool durable)
+	{
+		m_durableWrites.store(durable, std::memory_order_relaxed);
 	}
 
-	bool Filesystem::CreateArchive(MountID mountId, const std::filesystem::path& filename, const std::vector<FileID>& files)
+	void Filesystem::BeginWriteBatch()
 	{
-		auto* mount = GetMount_Internal(mountId);
-		if (!mount)
-			return false;
+		std::lock_guard lock(m_writeBatchMutex);
+		++m_writeBatchDepth;
+	}
 
-		// Calculate total data size & data offsets
-		uint64_t totalDataSize = 0;
-		std::vector<uint64_t> fileDataOffsets(files.size());
-		for (auto i = 0; i < files.size(); ++i)
+	bool Filesystem::EndWriteBatch()
+	{
+		std::vector<PendingWrite> writes;
 		{
-			const auto fileId = files[i];
-			const auto* file = GetFile(fileId);
-			if (!file)
-				return false;
+			std::lock_guard lock(m_writeBatchMutex);
+			if (m_writeBatchDepth == 0)
+				return false; // Not in a batch.
 
-			fileDataOffsets[i] = totalDataSize;
-			totalDataSize += file->CompressedSize;
+			if (--m_writeBatchDepth != 0)
+				return true;
+
+			writes.swap(m_pendingWrites);
 		}
 
-		// Gather file data
-		ReadOnlyByteBuffer dataBuffer(totalDataSize);
-		for (auto i = 0; i < files.size(); ++i)
+		if (m_durableWrites.load(std::memory_order_relaxed))
 		{
-			const auto fileId = files[i];
-			const auto* file = GetFile(fileId);
-			if (!file)
+			// Data must be on disk before the commits make the files visible. The files are flushed in parallel so the
+			// filesystem can group their journal commits.
+			std::vector<StagedWrite*> unsyncedWrites;
+			std::vector<PendingWrite> syncedWrites; // Those with nothing to sync, eg. To in-memory mounts.
+			unsyncedWrites.reserve(writes.size());
+			for (const auto& write : writes)
+			{
+				if (!write.Staged->IsSynced())
+					unsyncedWrites.push_back(write.Staged.get());
+				else
+					syncedWrites.push_back(write);
+			}
+
+			const auto jobCount = std::min<size_t>(m_threadPool->GetThreadCount(), unsyncedWrites.size());
+			std::vector<std::future<bool>> syncJobs;
+			syncJobs.reserve(jobCount);
+			for (size_t job = 0; job < jobCount; ++job)
+			{
+				syncJobs.push_back(m_threadPool->Submit([&unsyncedWrites, job, jobCount]() {
+					bool synced = true;
+					for (size_t i = job; i < unsyncedWrites.size(); i += jobCount)
+						synced &= unsyncedWrites[i]->Sync();
+					return synced;
+				}));
+			}
+
+			bool synced = true;
+			for (auto& job : syncJobs)
+				synced &= job.get();
+
+			if (!synced)
+			{
+				// Nothing on disk is replaced by files that may not have reached it.
+				for (auto* write : unsyncedWrites)
+					write->Discard();
+				FinalizeWrites(syncedWrites);
 				return false;
+			}
+		}
 
-			auto* dataWriteOffset = static_cast<uint8_t*>(dataBuffer.GetData()) + fileDataOffsets[i];
+		return FinalizeWrites(writes);
+	}
 
-			std::ifstream stream(mount->RootDirPath / file->MountRelPath, std::ios::binary);
-			stream.unsetf(std::ios::skipws);
-			stream.seekg(file->Offset);
-			stream.read(reinterpret_cast<char*>(dataWriteOffset), file->CompressedSize);
+	bool Filesystem::CommitWrite_Internal(const Mount& mount,
+		const std::filesystem::path& filename,
+		const std::vector<WriteChunk>& chunks,
+		std::vector<File> files)
+	{
+		bool batched = false;
+		{
+			std::lock_guard lock(m_writeBatchMutex);
+			batched = m_writeBatchDepth != 0;
 		}
 
-		FormatHeader header{};
-		std::memcpy(header.MagicNumber, FS_FORMAT_MAGIC_NUM, sizeof(FS_FORMAT_MAGIC_NUM));
-		header.FormatVersion = FS_FORMAT_VERSION;
-		header.FileCount = files.size();
+		PendingWrite write{};
+		write.MountId = mount.Id;
+		write.Files = std::move(files);
 
-		std::ofstream stream(mount->RootDirPath / filename, std::ios::binary);
-		if (!stream)
+		const bool durable = m_durableWrites.load(std::memory_order_relaxed);
+		const bool sync = durable && !batched; // Batches are flushed together when they end.
+		write.Staged = mount.Backend->Stage(FileRegistry::NormalizePath(filename), chunks, sync);
+		if (!write.Staged)
 			return false;
 
-		stream.unsetf(std::ios::skipws);
+		for (const auto& chunk : chunks)
+			m_stats->BytesWritten.Add(chunk.Size);
+		m_stats->FilesWritten.Add();
 
-		stream << header;
+		{
+			// Checked again as the batch may have started or ended while writing.
+			std::lock_guard lock(m_writeBatchMutex);
+			if (m_writeBatchDepth != 0)
+			{
+				m_pendingWrites.push_back(std::move(write));
+				return true;
+			}
+		}
 
-		std::vector<uint64_t> fileOffsetWritePositions(files.size());
-		for (auto i = 0; i < files.size(); ++i)
+		if (durable && !write.Staged->IsSynced() && !write.Staged->Sync())
 		{
-			const auto fileId = files[i];
-			auto* file = GetFile(fileId);
-			if (!file)
-				return false;
+			write.Staged->Discard();
+			return false;
+		}
 
-			file->MountId = mountId;	   // Update mount id.
-			file->MountRelPath = filename; // Update filename to archive file.
+		return FinalizeWrites({ write });
+	}
 
-			stream << *file;
-			fileOffsetWritePositions[i] = uint32_t(stream.tellp()) - sizeof(file->Offset);
-		}
-		const uint32_t dataStartOffset = stream.tellp();
+	bool Filesystem::FinalizeWrites(const std::vector<PendingWrite>& writes)
+	{
+		bool succeeded = true;
+		std::vector<const PendingWrite*> committedWrites;
+		committedWrites.reserve(writes.size());
+		std::unordered_set<std::string> directories;
+		for (const auto& write : writes)
+		{
+			if (!write.Staged->Commit())
+			{
+				succeeded = false;
+				continue;
+			}
 
-		stream.write(reinterpret_cast<const char*>(dataBuffer.GetData()), dataBuffer.GetSize());
+			committedWrites.push_back(&write);
+			auto directory = write.Staged->GetCommitDirectory();
+			if (!directory.empty())
+				directories.insert(directory.string());
+		}
 
-		for (auto i = 0; i < files.size(); ++i)
+		// Make the commits (eg. Renames) themselves durable.
+		if (m_durableWrites.load(std::memory_order_relaxed))
 		{
-			const auto fileId = files[i];
-			auto* file = GetFile(fileId);
+			for (const auto& directory : directories)
+				succeeded &= SyncDirectory(directory);
+		}
 
-			const auto fileOffsetWritePos = fileOffsetWritePositions[i];
-			file->Offset = dataStartOffset + fileDataOffsets[i];
+		std::shared_lock mountLock(m_mountMutex);
+		std::lock_guard lock(m_fileMutex);
+		for (const auto* write : committedWrites)
+		{
+			if (m_mountMap.find(write->MountId) == m_mountMap.end())
+			{
+				succeeded = false; // Unmounted while writing.
+				continue;
+			}
 
-			// Go back and write data offset
-			stream.seekp(fileOffsetWritePos, std::ios::beg);
-			stream.write(reinterpret_cast<const char*>(&file->Offset), sizeof(file->Offset));
+			for (const auto& file : write->Files)
+				RegisterFile_Internal(file);
 		}
 
-		return true;
+		return succeeded;
 	}
 
 	void Filesystem::SetImporter(const std::vector<std::string>& fileExts, const std::shared_ptr<FileImporter>& importer)
@@ -305,6 +1248,7 @@ namespace gfs
 		for (const auto& ext : fileExts)
 		{
 			const auto extHash = std::hash<std::string>{}(ext);
+			std::unique_lock importerLock(m_importerMutex);
 			m_extImporterMap[extHash] = importer;
 		}
 	}
@@ -312,6 +1256,7 @@ namespace gfs
 	auto Filesystem::GetImporter(const std::string& fileExt) -> std::shared_ptr<FileImporter>
 	{
 		const auto extHash = std::hash<std::string>{}(fileExt);
+		std::shared_lock importerLock(m_importerMutex);
 		const auto it = m_extImporterMap.find(extHash);
 		if (it == m_extImporterMap.end())
 			return nullptr;
@@ -320,182 +1265,745 @@ namespace gfs
 	}
 
 	bool Filesystem::Import(const std::filesystem::path& filename, MountID outputMount, const std::filesystem::path& outputDir, const std::string& metadata)
+	{
+		return Import_Internal(filename, outputMount, outputDir, metadata) != ImportStatus::Failed;
+	}
+
+	auto Filesystem::ImportDirectory(const std::filesystem::path& srcDir, MountID outputMount, const std::filesystem::path& outputDir, const ImportOptions& options)
+		-> ImportResult
+	{
+		ImportResult result{};
+
+		Mount mount{};
+		if (!GetMount_Internal(outputMount, mount))
+		{
+			result.FailedCount = 1;
+			result.Errors.push_back({ srcDir, "Output mount does not exist" });
+			return result;
+		}
+
+		std::error_code error;
+		if (!std::filesystem::is_directory(srcDir, error))
+		{
+			result.FailedCount = 1;
+			result.Errors.push_back({ srcDir, "Source directory does not exist" });
+			return result;
+		}
+
+		// Discover files that have an importer. Importers expect their output directory to exist, so the source directory
+		// structure is mirrored under the output directory up front.
+		struct ImportJob
+		{
+			std::filesystem::path Filename;
+			std::filesystem::path OutputDir;
+		};
+		std::vector<ImportJob> jobs;
+		std::unordered_set<std::string> outputDirs;
+
+		auto addFile = [&](const std::filesystem::directory_entry& entry) {
+			std::error_code entryError;
+			if (!entry.is_regular_file(entryError) || !GetImporter(entry.path().extension().string()))
+				return;
+
+			const auto relDir = entry.path().parent_path().lexically_relative(srcDir);
+			auto jobOutputDir = relDir.empty() || relDir == "." ? outputDir : outputDir / relDir;
+			if (outputDirs.insert(jobOutputDir.string()).second)
+				mount.Backend->CreateDirectories(jobOutputDir);
+
+			jobs.push_back({ entry.path(), std::move(jobOutputDir) });
+		};
+
+		const auto iteratorOptions = std::filesystem::directory_options::skip_permission_denied;
+		if (options.Recursive)
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(srcDir, iteratorOptions, error))
+				addFile(entry);
+		}
+		else
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(srcDir, iteratorOptions, error))
+				addFile(entry);
+		}
+
+		// Each file is imported as its own job. Completions are handed back so progress is reported on this thread.
+		std::mutex completionMutex;
+		std::condition_variable completionCondition;
+		std::deque<uint32_t> completedJobs;
+		std::vector<ImportStatus> statuses(jobs.size(), ImportStatus::Failed);
+		std::vector<std::string> errorMessages(jobs.size());
+
+		for (uint32_t i = 0; i < uint32_t(jobs.size()); ++i)
+		{
+			m_threadPool->Submit([&, i]() {
+				auto status = ImportStatus::Failed;
+				std::string errorMessage;
+				try
+				{
+					status = Import_Internal(jobs[i].Filename, outputMount, jobs[i].OutputDir, options.Metadata);
+					if (status == ImportStatus::Failed)
+						errorMessage = "Importer failed";
+				}
+				catch (const std::exception& ex)
+				{
+					errorMessage = ex.what();
+				}
+				catch (...)
+				{
+					errorMessage = "Unknown exception";
+				}
+
+				// Notified under the lock, as the waiting thread may return (destroying the condition) once it is released.
+				std::lock_guard lock(completionMutex);
+				statuses[i] = status;
+				errorMessages[i] = std::move(errorMessage);
+				completedJobs.push_back(i);
+				completionCondition.notify_one();
+			});
+		}
+
+		for (uint32_t completedCount = 0; completedCount < uint32_t(jobs.size());)
+		{
+			uint32_t jobIndex;
+			{
+				std::unique_lock lock(completionMutex);
+				completionCondition.wait(lock, [&]() { return !completedJobs.empty(); });
+				jobIndex = completedJobs.front();
+				completedJobs.pop_front();
+			}
+			++completedCount;
+
+			switch (statuses[jobIndex])
+			{
+			case ImportStatus::Imported:
+				++result.ImportedCount;
+				break;
+			case ImportStatus::UpToDate:
+				++result.UpToDateCount;
+				break;
+			case ImportStatus::Failed:
+				++result.FailedCount;
+				result.Errors.push_back({ jobs[jobIndex].Filename, std::move(errorMessages[jobIndex]) });
+				break;
+			}
+
+			if (options.ProgressCallback)
+				options.ProgressCallback({ completedCount, uint32_t(jobs.size()), jobs[jobIndex].Filename });
+		}
+
+		std::sort(result.Errors.begin(), result.Errors.end(), [](const ImportError& lhs, const ImportError& rhs) { return lhs.Filename < rhs.Filename; });
+		return result;
+	}
+
+	auto Filesystem::Import_Internal(const std::filesystem::path& filename,
+		MountID outputMount,
+		const std::filesystem::path& outputDir,
+		const std::string& metadata) -> ImportStatus
 	{
 		if (filename.empty() || !std::filesystem::exists(filename) || !std::filesystem::is_regular_file(filename))
-			return false;
+			return ImportStatus::Failed;
 
 		const auto fileExt = filename.extension().string();
 		const auto importer = GetImporter(fileExt);
 		if (!importer)
-			return false;
+			return ImportStatus::Failed;
+
+		uint64_t sourceHash = 0;
+		if (!HashFileContents(filename, sourceHash))
+			return ImportStatus::Failed;
+
+		if (m_importCacheEnabled.load(std::memory_order_relaxed) && IsImportUpToDate(filename, outputMount, outputDir, sourceHash, HashMetadata(metadata)))
+		{
+			m_stats->ImportCacheHits.Add();
+			return ImportStatus::UpToDate;
+		}
+		m_stats->ImportCacheMisses.Add();
+
+		ScopedImportContext context(filename, sourceHash);
+		return importer->Import(*this, filename, outputMount, outputDir, metadata) ? ImportStatus::Imported : ImportStatus::Failed;
+	}
+
+	bool Filesystem::IsImportUpToDate(const std::filesystem::path& sourceFilename,
+		MountID mountId,
+		const std::filesystem::path& outputDir,
+		uint64_t sourceHash,
+		uint64_t metadataHash) const
+	{
+		// Imports write files, so reading from a snapshot here would republish one for every file.
+		const auto normalOutputDir = FileRegistry::NormalizePath(outputDir);
+		std::lock_guard lock(m_fileMutex);
+		const auto& files = m_files;
+
+		// Only files the previous import wrote into the same directory count, so importing into another directory is not skipped.
+		bool hasImportedFiles = false;
+		for (const auto fileId : files.GetFilesWithSourceFile(sourceFilename.string()))
+		{
+			const auto index = files.Find(fileId);
+			if (files.GetMountId(index) != mountId)
+				continue;
+
+			const auto& mountRelPath = files.GetMountRelPath(index);
+			const auto separator = mountRelPath.rfind('/');
+			if (mountRelPath.compare(0, separator == std::string::npos ? 0 : separator, normalOutputDir) != 0)
+				continue;
+
+			if (files.GetSourceHash(index) != sourceHash || files.GetMetadataHash(index) != metadataHash)
+				return false;
+			hasImportedFiles = true;
+		}
+		return hasImportedFiles;
+	}
 
-		return importer->Import(*this, filename, outputMount, outputDir, metadata);
+	void Filesystem::SetImportCacheEnabled(bool enabled)
+	{
+		m_importCacheEnabled.store(enabled, std::memory_order_relaxed);
 	}
 
 	bool Filesystem::Reimport(FileID fileId)
 	{
-		auto* file = GetFile(fileId);
-		if (!file)
-			return false;
+		const auto result = Reimport_Internal(fileId);
+		if (result == ImportStatus::Imported && m_fileReimportCallback)
+			m_fileReimportCallback(fileId);
 
-		if (file->SourceFilename.empty() || !std::filesystem::exists(file->SourceFilename) || !std::filesystem::is_regular_file(file->SourceFilename))
-			return false;
+		return result != ImportStatus::Failed;
+	}
+
+	auto Filesystem::Reimport_Internal(FileID fileId) -> ImportStatus
+	{
+		// Reimports write files, so reading from a snapshot here would republish one for every file.
+		auto registeredFile = GetFile_Internal(fileId);
+		File file{};
+		if (!registeredFile || !GetFullFile(std::move(*registeredFile), file))
+			return ImportStatus::Failed;
 
-		const auto fileExt = file->SourceFilename.extension().string();
+		if (file.SourceFilename.empty() || !std::filesystem::exists(file.SourceFilename) || !std::filesystem::is_regular_file(file.SourceFilename))
+			return ImportStatus::Failed;
+
+		const auto fileExt = file.SourceFilename.extension().string();
 		auto importer = GetImporter(fileExt);
 		if (!importer)
-			return false;
+			return ImportStatus::Failed;
 
-		bool success = importer->Reimport(*this, *file);
-		if (success)
-			m_fileReimportCallback(fileId);
+		uint64_t sourceHash = 0;
+		if (!HashFileContents(file.SourceFilename, sourceHash))
+			return ImportStatus::Failed;
+
+		// Saving a file without changes (or touching it) only changes its timestamp. The metadata is the file's own, so cannot
+		// have changed.
+		if (m_importCacheEnabled.load(std::memory_order_relaxed) && file.SourceHash == sourceHash)
+		{
+			m_stats->ImportCacheHits.Add();
+			return ImportStatus::UpToDate;
+		}
+		m_stats->ImportCacheMisses.Add();
+
+		ScopedImportContext context(file.SourceFilename, sourceHash);
+		return importer->Reimport(*this, file) ? ImportStatus::Imported : ImportStatus::Failed;
+	}
 
-		return success;
+	void Filesystem::SetFileReimportCallback(const std::function<void(FileID fileId)>& callback)
+	{
+		m_fileReimportCallback = callback;
+	}
+
+	void Filesystem::SetHotReloadDebounce(std::chrono::milliseconds quietPeriod)
+	{
+		std::lock_guard lock(m_hotReloadMutex);
+		m_hotReloadDebounce = quietPeriod;
 	}
 
 	bool Filesystem::IsPathInMount(const std::filesystem::path& path, MountID mountId)
 	{
-		auto* mount = GetMount_Internal(mountId);
-		if (!mount)
-			return false;
+		Mount mount{};
+		return GetMount_Internal(mountId, mount) && mount.Backend->ContainsPath(path);
+	}
 
-		std::filesystem::path finalPath;
-		try
+	bool Filesystem::IsPathInAnyMount(const std::filesystem::path& path)
+	{
+		for (const auto& mount : GetMounts_Internal())
 		{
-			finalPath = std::filesystem::canonical(mount->RootDirPath / path);
+			if (IsPathInMount(path, mount.Id))
+				return true;
 		}
-		catch (const std::exception& /*ex*/)
+		return false;
+	}
+
+	auto Filesystem::GetStats() const -> FilesystemStats
+	{
+		auto stats = m_stats->Snapshot();
+		if constexpr (StatsEnabled)
 		{
-			return false; // Path/File does not exists.
+			std::lock_guard lock(m_hotReloadMutex);
+			stats.HotReloadQueueDepth = uint32_t(m_pendingHotReloads.size() + m_fileHotReloadQueue.size());
 		}
+		return stats;
+	}
 
-		auto [rootEnd, nothing] = std::mismatch(mount->RootDirPath.begin(), mount->RootDirPath.end(), finalPath.begin());
-		if (rootEnd == mount->RootDirPath.end())
+	void Filesystem::ResetStats()
+	{
+		m_stats->Reset();
+	}
+
+	bool Filesystem::StartAccessTrace(const std::filesystem::path& filename)
+	{
+		std::lock_guard lock(m_accessTraceMutex);
+		if (m_accessTraceEnabled)
 			return false;
 
+		auto recorder = std::make_shared<AccessTraceRecorder>();
+		if (!recorder->Open(filename))
+			return false;
+
+		std::atomic_store(&m_accessTrace, std::move(recorder));
+		m_accessTraceEnabled = true;
 		return true;
 	}
 
-	bool Filesystem::IsPathInAnyMount(const std::filesystem::path& path)
+	bool Filesystem::StopAccessTrace()
+	{
+		std::lock_guard lock(m_accessTraceMutex);
+		if (!m_accessTraceEnabled)
+			return false;
+
+		m_accessTraceEnabled = false;
+		// Calls still holding the recorder finish without recording once it is closed.
+		const auto recorder = std::atomic_exchange(&m_accessTrace, std::shared_ptr<AccessTraceRecorder>());
+		return recorder->Close();
+	}
+
+	bool Filesystem::GetMount_Internal(MountID id, Mount& outMount) const
+	{
+		std::shared_lock mountLock(m_mountMutex);
+		const auto it = m_mountMap.find(id);
+		if (it == m_mountMap.end())
+			return false;
+
+		outMount = it->second;
+		return true;
+	}
+
+	auto Filesystem::GetMounts_Internal() const -> std::vector<Mount>
 	{
+		std::shared_lock mountLock(m_mountMutex);
+		std::vector<Mount> mounts;
+		mounts.reserve(m_mountMap.size());
 		for (const auto& [id, mount] : m_mountMap)
+			mounts.push_back(mount);
+		return mounts;
+	}
+
+	auto Filesystem::AcquireFileSnapshot() const -> const FileRegistry&
+	{
+		// Each thread keeps the last snapshot it used, so while nothing is written lookups are lock-free & never touch the
+		// shared reference count. The returned reference is valid until this thread next acquires a snapshot.
+		auto* slot = m_snapshotSlots->GetSlot(GetThreadIndex());
+		if (slot == nullptr)
 		{
-			if (IsPathInMount(path, mount.Id))
-				return true;
+			std::lock_guard lock(m_snapshotSlots->OverflowMutex);
+			slot = &m_snapshotSlots->OverflowSlots[std::this_thread::get_id()];
 		}
-		return false;
+
+		if (!slot->Snapshot || slot->Snapshot->Version != m_fileVersion.load(std::memory_order_acquire))
+			slot->Snapshot = GetLatestFileSnapshot();
+		return slot->Snapshot->Files;
 	}
 
-	auto Filesystem::GetMount_Internal(MountID id) -> Mount*
+	auto Filesystem::GetLatestFileSnapshot() const -> std::shared_ptr<const FileSnapshot>
 	{
-		const auto it = m_mountMap.find(id);
-		if (it == m_mountMap.end())
+		auto snapshot = std::atomic_load(&m_fileSnapshot);
+		if (snapshot->Version == m_fileVersion.load(std::memory_order_acquire))
+			return snapshot;
+
+		std::lock_guard lock(m_fileMutex);
+		snapshot = std::atomic_load(&m_fileSnapshot);
+		if (snapshot->Version != m_fileVersion.load(std::memory_order_relaxed))
+		{
+			// Publish a new version. Readers still holding the previous snapshot keep it alive until they are done.
+			// The copy shares the registry's chunks, which are only copied when the registry next changes them.
+			snapshot = std::make_shared<FileSnapshot>(FileSnapshot{ m_fileVersion.load(std::memory_order_relaxed), m_files });
+			std::atomic_store(&m_fileSnapshot, snapshot);
+		}
+		return snapshot;
+	}
+
+	auto Filesystem::GetAccessTrace() const -> std::shared_ptr<AccessTraceRecorder>
+	{
+		// Checked first so calls made while not recording never touch the shared reference count.
+		if (!m_accessTraceEnabled.load(std::memory_order_relaxed))
+			return nullptr;
+		return std::atomic_load(&m_accessTrace);
+	}
+
+	auto Filesystem::GetSharedCache() const -> std::shared_ptr<SharedCache>
+	{
+		// Checked first so reads without a shared cache never touch the shared reference count.
+		if (!m_sharedCacheEnabled.load(std::memory_order_relaxed))
 			return nullptr;
+		return std::atomic_load(&m_sharedCache);
+	}
 
-		return &it->second;
+	void Filesystem::RegisterFile_Internal(const File& file)
+	{
+		m_files.Insert(file); // Cold fields are released by the registry in lazy mode & read back from disk on demand.
+		m_fileVersion.fetch_add(1, std::memory_order_release);
 	}
 
-	auto Filesystem::GetFile(FileID id) -> File*
+	auto Filesystem::GetFile_Internal(FileID id) const -> std::optional<File>
 	{
+		// The registry writers modify, so nothing needs to be published.
 		std::lock_guard lock(m_fileMutex);
+		const auto index = m_files.Find(id);
+		if (index == FileRegistry::InvalidIndex)
+			return std::nullopt;
 
-		const auto it = m_files.find(id);
-		if (it == m_files.end())
-			return nullptr;
+		return m_files.GetFile(index);
+	}
+
+	bool Filesystem::GetFullFile(FileID id, File& outFile)
+	{
+		auto file = GetFile(id);
+		return file && GetFullFile(std::move(*file), outFile);
+	}
+
+	bool Filesystem::GetFullFile(File file, File& outFile)
+	{
+		if (!m_lazyFileMetadata.load(std::memory_order_relaxed))
+		{
+			outFile = std::move(file);
+			return true;
+		}
+
+		return ReadFileRecord(file, outFile);
+	}
+
+	bool Filesystem::ReadFileRecord(const File& file, File& outFile)
+	{
+		Mount mount{};
+		if (!GetMount_Internal(file.MountId, mount))
+			return false;
+
+		const auto mountFile = mount.Backend->Open(file.MountRelPath.generic_string());
+		if (!mountFile)
+			return false;
+
+		auto& stream = mountFile->GetStream();
+		if (!stream)
+			return false;
+
+		return ReadFileRecord(stream, file, outFile);
+	}
+
+	bool Filesystem::ReadFileRecord(std::istream& stream, const File& file, File& outFile)
+	{
+		// The header determines the record layout.
+		FormatHeader header{};
+		stream >> header;
+		if (!stream || std::memcmp(header.MagicNumber, FS_FORMAT_MAGIC_NUM, sizeof(header.MagicNumber)) != 0 || header.FormatVersion > FS_FORMAT_VERSION)
+			return false;
 
-		return &it->second;
+		stream.seekg(file.RecordOffset);
+		stream >> outFile;
+		if (!stream || outFile.FileId != file.FileId)
+			return false;
+
+		outFile.MountId = file.MountId;
+		outFile.MountRelPath = file.MountRelPath;
+		outFile.RecordOffset = file.RecordOffset;
+		return true;
 	}
 
 	auto Filesystem::GetMountPathIsIn(const std::filesystem::path& path) -> MountID
 	{
-		for (auto& [id, mount] : m_mountMap)
+		for (const auto& mount : GetMounts_Internal())
 		{
-			if (IsPathInMount(path, id))
-				return id;
+			if (IsPathInMount(path, mount.Id))
+				return mount.Id;
 		}
 		return InvalidMountId;
 	}
 
 	void Filesystem::GatherFilesInMount(const Mount& mount)
 	{
-		for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(mount.RootDirPath))
-		{
-			if (!dirEntry.is_regular_file())
-				continue;
-
-			const auto filePath = dirEntry.path();
+		ScopedStatTimer timer(m_stats->MountScanTime);
+
+		const bool indexEnabled = m_mountIndexEnabled.load(std::memory_order_relaxed) && !mount.IndexFilename.empty();
+		auto indexedEntries = indexEnabled ? ReadMountIndex(mount) : std::unordered_map<std::string, MountIndexEntry>{};
+		bool indexOutOfDate = indexedEntries.empty();
+
+		// Skipped when scanning. Empty (or outside the mount) when the index is kept elsewhere.
+		const auto indexRelPath = FileRegistry::NormalizePath(mount.IndexFilename.lexically_relative(mount.RootDirPath));
+
+		std::vector<MountIndexEntry> entries;
+		std::vector<std::filesystem::path> sourceFiles;
+
+		// The directory walk stays on this thread while batches of new/modified files are validated on the thread pool.
+		// Each job registers its whole batch under a single lock & hands the validated entries back.
+		std::vector<std::future<std::vector<MountIndexEntry>>> batchJobs;
+
+		std::vector<MountIndexEntry> batch;
+		auto submitBatch = [&]() {
+			batchJobs.push_back(m_threadPool->Submit([this, &mount, batch = std::move(batch)]() mutable {
+				for (auto& entry : batch)
+				{
+					const auto mountFile = mount.Backend->Open(entry.MountRelPath);
+					if (mountFile)
+						entry.Files = ReadFileRecords(mountFile->GetStream(), entry.FileSize, entry.MountRelPath, mount.Id);
+				}
+
+				{
+					std::lock_guard lock(m_fileMutex);
+					for (const auto& entry : batch)
+					{
+						for (const auto& file : entry.Files)
+							RegisterFile_Internal(file);
+					}
+				}
+				WatchSourceFiles(batch); // After registering, so a change picked up straight away finds the files.
+				return std::move(batch);
+			}));
+			batch = {};
+			batch.reserve(FS_MOUNT_SCAN_BATCH_SIZE);
+		};
+
+		batch.reserve(FS_MOUNT_SCAN_BATCH_SIZE);
+		uint64_t unchangedEntryCount = 0;
+		mount.Backend->Enumerate([&](const std::string& mountRelPath, uint64_t fileSize, int64_t lastWriteTime) {
+			if (fileSize < sizeof(FormatHeader) || mountRelPath == indexRelPath)
+				return;
+
+			MountIndexEntry entry{};
+			entry.MountRelPath = mountRelPath;
+			entry.FileSize = fileSize;
+			entry.LastWriteTime = lastWriteTime;
+
+			const auto it = indexedEntries.find(entry.MountRelPath);
+			if (it != indexedEntries.end() && it->second.FileSize == entry.FileSize && it->second.LastWriteTime == entry.LastWriteTime)
+			{
+				// Unchanged since the index was written, so its records can be registered without opening it.
+				entry.Files = std::move(it->second.Files);
+				for (auto& file : entry.Files)
+				{
+					file.MountId = mount.Id;
+					file.MountRelPath = entry.MountRelPath;
+				}
+				entries.push_back(std::move(entry));
+				++unchangedEntryCount;
+				return;
+			}
+
+			indexOutOfDate = true;
+			batch.push_back(std::move(entry));
+			if (batch.size() >= FS_MOUNT_SCAN_BATCH_SIZE)
+				submitBatch();
+		});
+		if (!batch.empty())
+			submitBatch();
+
+		m_stats->MountIndexHits.Add(unchangedEntryCount);
+		if (unchangedEntryCount != indexedEntries.size())
+			indexOutOfDate = true; // Files have been removed since the index was written.
 
-			const auto fileSize = std::filesystem::file_size(filePath);
-			if (fileSize < sizeof(FormatHeader))
-				continue;
+		{
+			std::lock_guard lock(m_fileMutex);
+			for (const auto& entry : entries)
+			{
+				for (const auto& file : entry.Files)
+					RegisterFile_Internal(file);
+			}
+		}
+		WatchSourceFiles(entries);
 
-			ValidateAndRegisterFile(filePath, mount.Id);
+		for (auto& job : batchJobs)
+		{
+			auto validatedEntries = job.get();
+			std::move(validatedEntries.begin(), validatedEntries.end(), std::back_inserter(entries));
 		}
+
+		if (indexEnabled && indexOutOfDate)
+			WriteMountIndex(mount, entries);
 	}
 
-	void Filesystem::ValidateAndRegisterFile(const std::filesystem::path& filename, MountID mountId)
+	auto Filesystem::ReadFileRecords(std::istream& stream, uint64_t fileSize, const std::filesystem::path& mountRelPath, MountID mountId) -> std::vector<File>
 	{
-		std::ifstream stream(filename, std::ios::binary);
 		if (!stream)
-			return;
+			return {};
 
 		FormatHeader header{};
 		stream >> header;
 
-		if (std::memcmp(header.MagicNumber, FS_FORMAT_MAGIC_NUM, sizeof(header.MagicNumber)) != 0)
-			return;
+		if (!stream || std::memcmp(header.MagicNumber, FS_FORMAT_MAGIC_NUM, sizeof(header.MagicNumber)) != 0 || header.FormatVersion > FS_FORMAT_VERSION)
+			return {};
 
-		File file{};
-		stream >> file;
+		// Reject obviously corrupt headers before allocating records for them.
+		if (uint64_t(header.FileCount) * FS_FORMAT_MIN_RECORD_SIZE > fileSize)
+			return {};
 
-		file.MountId = mountId;
-		file.MountRelPath = filename;
+		// Archives contain a record for each file they hold.
+		std::vector<File> files(header.FileCount);
+		for (auto& file : files)
+		{
+			file.RecordOffset = uint32_t(stream.tellg());
+			stream >> file;
+			if (!stream)
+				return {};
+
+			file.MountId = mountId;
+			file.MountRelPath = mountRelPath;
+		}
+		return files;
+	}
+
+	auto Filesystem::ReadMountIndex(const Mount& mount) -> std::unordered_map<std::string, MountIndexEntry>
+	{
+		const auto& indexFilename = mount.IndexFilename;
+
+		std::error_code error;
+		const auto indexSize = std::filesystem::file_size(indexFilename, error);
+		if (error || indexSize < sizeof(FS_MOUNT_INDEX_MAGIC_NUM) + sizeof(FS_MOUNT_INDEX_VERSION))
+			return {};
+
+		std::ifstream stream(indexFilename, std::ios::binary);
+		if (!stream)
+			return {};
+
+		// Read the whole index in one go & parse it from memory.
+		ReadOnlyByteBuffer buffer(indexSize);
+		stream.read(static_cast<char*>(buffer.GetData()), std::streamsize(indexSize));
+		if (!stream)
+			return {};
+
+		char magicNumber[4]{};
+		uint16_t version = 0;
+		uint64_t entryCount = 0;
+		buffer.Read(sizeof(magicNumber), reinterpret_cast<uint8_t*>(magicNumber));
+		buffer.Read(version);
+		if (std::memcmp(magicNumber, FS_MOUNT_INDEX_MAGIC_NUM, sizeof(magicNumber)) != 0 || version != FS_MOUNT_INDEX_VERSION)
+			return {};
 
+		if (!ReadIndexValue(buffer, entryCount))
+			return {};
+
+		std::unordered_map<std::string, MountIndexEntry> entries;
+		for (uint64_t i = 0; i < entryCount; ++i)
 		{
-			std::lock_guard lock(m_fileMutex);
-			m_files[file.FileId] = file;
+			MountIndexEntry entry{};
+			uint32_t fileCount = 0;
+			if (!ReadIndexString(buffer, entry.MountRelPath) || !ReadIndexValue(buffer, entry.FileSize) || !ReadIndexValue(buffer, entry.LastWriteTime)
+				|| !ReadIndexValue(buffer, fileCount))
+				return {};
+
+			if (uint64_t(fileCount) * FS_FORMAT_MIN_RECORD_SIZE > buffer.GetSize() - buffer.GetPosition())
+				return {};
+
+			entry.Files.resize(fileCount);
+			for (auto& file : entry.Files)
+			{
+				std::string sourceFilename;
+				uint64_t dependencyCount = 0;
+				if (!ReadIndexValue(buffer, file.FileId) || !ReadIndexString(buffer, sourceFilename) || !ReadIndexString(buffer, file.MetadataStr)
+					|| !ReadIndexValue(buffer, dependencyCount))
+					return {};
+
+				if (dependencyCount > (buffer.GetSize() - buffer.GetPosition()) / sizeof(FileID))
+					return {};
+
+				file.SourceFilename = sourceFilename;
+				file.FileDependencies.resize(dependencyCount);
+				if (dependencyCount != 0)
+					buffer.Read(dependencyCount * sizeof(FileID), reinterpret_cast<uint8_t*>(file.FileDependencies.data()));
+
+				if (!ReadIndexValue(buffer, file.SourceHash) || !ReadIndexValue(buffer, file.MetadataHash) || !ReadIndexValue(buffer, file.UncompressedSize) || !ReadIndexValue(buffer, file.CompressedSize) || !ReadIndexValue(buffer, file.Offset)
+					|| !ReadIndexValue(buffer, file.RecordOffset))
+					return {};
+			}
+
+			auto relPath = entry.MountRelPath;
+			entries.emplace(std::move(relPath), std::move(entry));
 		}
+		return entries;
+	}
 
-		if (!file.SourceFilename.empty())
+	bool Filesystem::WriteMountIndex(const Mount& mount, const std::vector<MountIndexEntry>& entries)
+	{
+		WriteOnlyByteBuffer buffer(1024 * 64);
+		buffer.Write(sizeof(FS_MOUNT_INDEX_MAGIC_NUM), reinterpret_cast<const uint8_t*>(FS_MOUNT_INDEX_MAGIC_NUM));
+		buffer.Write(FS_MOUNT_INDEX_VERSION);
+		buffer.Write(uint64_t(entries.size()));
+		for (const auto& entry : entries)
 		{
-			CreateFileWatch(file.SourceFilename);
+			buffer.Write(entry.MountRelPath);
+			buffer.Write(entry.FileSize);
+			buffer.Write(entry.LastWriteTime);
+			buffer.Write(uint32_t(entry.Files.size()));
+			for (const auto& file : entry.Files)
+			{
+				buffer.Write(file.FileId);
+				buffer.Write(file.SourceFilename.string());
+				buffer.Write(file.MetadataStr);
+				buffer.Write(uint64_t(file.FileDependencies.size()));
+				if (!file.FileDependencies.empty())
+					buffer.Write(file.FileDependencies.size() * sizeof(FileID), reinterpret_cast<const uint8_t*>(file.FileDependencies.data()));
+				buffer.Write(file.SourceHash);
+				buffer.Write(file.MetadataHash);
+				buffer.Write(file.UncompressedSize);
+				buffer.Write(file.CompressedSize);
+				buffer.Write(file.Offset);
+				buffer.Write(file.RecordOffset);
+			}
+		}
+
+		// Write to a temporary file first so a partially written index is never picked up.
+		const auto& indexFilename = mount.IndexFilename;
+		auto tmpFilename = indexFilename;
+		tmpFilename += ".tmp";
+		{
+			std::error_code directoryError;
+			if (indexFilename.has_parent_path())
+				std::filesystem::create_directories(indexFilename.parent_path(), directoryError); // When kept out of the mount.
+
+			std::ofstream stream(tmpFilename, std::ios::binary | std::ios::trunc);
+			if (!stream)
+				return false;
+
+			stream.write(reinterpret_cast<const char*>(buffer.GetData()), std::streamsize(buffer.GetSize()));
+			if (!stream)
+				return false;
 		}
+
+		std::error_code error;
+		std::filesystem::rename(tmpFilename, indexFilename, error);
+		return !error;
 	}
 
 	void Filesystem::CreateFileWatch(const std::filesystem::path& filename)
 	{
-		if (!std::filesystem::exists(filename) || !std::filesystem::is_regular_file(filename))
-			return;
-
-		if (m_existingFileWatchers.find(filename.string()) != m_existingFileWatchers.end())
-			return;
+		m_fileWatcher->Watch(filename);
+	}
 
-		auto filewatch =
-			std::make_unique<filewatch::FileWatch<std::string>>(filename.string(), [&](const std::string& path, const filewatch::Event changeType) {
-				if (changeType == filewatch::Event::modified)
-					OnFileModified(path);
-			});
-		m_fileWatchers.push_back(std::move(filewatch));
-		m_existingFileWatchers.emplace(filename.string());
+	void Filesystem::WatchSourceFiles(const std::vector<MountIndexEntry>& entries)
+	{
+		for (const auto& entry : entries)
+		{
+			for (const auto& file : entry.Files)
+			{
+				if (!file.SourceFilename.empty())
+					CreateFileWatch(file.SourceFilename);
+			}
+		}
 	}
 
 	void Filesystem::OnFileModified(const std::filesystem::path& filePath)
 	{
 		auto affectedFiles = FindFilesWithSourceFile(filePath);
+		const auto now = std::chrono::steady_clock::now();
 		std::lock_guard lock(m_hotReloadMutex);
 		for (auto fileId : affectedFiles)
-			m_fileHotReloadQueue.push(fileId);
+			m_pendingHotReloads[fileId] = now; // Restarts the quiet period.
+		m_stats->MaxHotReloadQueueDepth.Max(m_pendingHotReloads.size() + m_fileHotReloadQueue.size());
 	}
 
 	auto Filesystem::FindFilesWithSourceFile(const std::filesystem::path& sourceFilename) const -> std::vector<FileID>
 	{
-		std::vector<FileID> affectedFiles{};
-		for (const auto& [id, file] : m_files)
-		{
-			if (file.SourceFilename == sourceFilename)
-				affectedFiles.push_back(id);
-		}
-		return affectedFiles;
+		return AcquireFileSnapshot().GetFilesWithSourceFile(sourceFilename.string());
 	}
 
 	auto operator<<(std::ostream& stream, const FormatHeader& header) -> std::ostream&
@@ -511,10 +2019,11 @@ namespace gfs
 		stream.read(reinterpret_cast<char*>(&header.MagicNumber), sizeof(header.MagicNumber));
 		stream.read(reinterpret_cast<char*>(&header.FormatVersion), sizeof(header.FormatVersion));
 		stream.read(reinterpret_cast<char*>(&header.FileCount), sizeof(header.FileCount));
+		stream.iword(sFormatVersionIndex) = header.FormatVersion;
 		return stream;
 	}
 
-	auto operator<<(std::ostream& stream, const Filesystem::File& file) -> std::ostream&
+	auto operator<<(std::ostream& stream, const File& file) -> std::ostream&
 	{
 		stream.write(reinterpret_cast<const char*>(&file.FileId), sizeof(file.FileId));
 
@@ -541,13 +2050,17 @@ namespace gfs
 		if (!file.FileDependencies.empty())
 			stream.write(reinterpret_cast<const char*>(file.FileDependencies.data()), sizeof(file.FileDependencies[0]) * count);
 
+		// Import hashes
+		stream.write(reinterpret_cast<const char*>(&file.SourceHash), sizeof(file.SourceHash));
+		stream.write(reinterpret_cast<const char*>(&file.MetadataHash), sizeof(file.MetadataHash));
+
 		stream.write(reinterpret_cast<const char*>(&file.UncompressedSize), sizeof(file.UncompressedSize));
 		stream.write(reinterpret_cast<const char*>(&file.CompressedSize), sizeof(file.CompressedSize));
 		stream.write(reinterpret_cast<const char*>(&file.Offset), sizeof(file.Offset));
 		return stream;
 	}
 
-	auto operator>>(std::istream& stream, Filesystem::File& file) -> std::istream&
+	auto operator>>(std::istream& stream, File& file) -> std::istream&
 	{
 		stream.read(reinterpret_cast<char*>(&file.FileId), sizeof(file.FileId));
 
@@ -579,6 +2092,15 @@ namespace gfs
 		if (!file.FileDependencies.empty())
 			stream.read(reinterpret_cast<char*>(file.FileDependencies.data()), sizeof(file.FileDependencies[0]) * count);
 
+		// Import hashes
+		file.SourceHash = 0;
+		file.MetadataHash = 0;
+		if (GetStreamFormatVersion(stream) >= 2)
+		{
+			stream.read(reinterpret_cast<char*>(&file.SourceHash), sizeof(file.SourceHash));
+			stream.read(reinterpret_cast<char*>(&file.MetadataHash), sizeof(file.MetadataHash));
+		}
+
 		stream.read(reinterpret_cast<char*>(&file.UncompressedSize), sizeof(file.UncompressedSize));
 		stream.read(reinterpret_cast<char*>(&file.CompressedSize), sizeof(file.CompressedSize));
 		stream.read(reinterpret_cast<char*>(&file.Offset), sizeof(file.Offset));
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "gfs/filesystem.hpp"
+
+#include <cstdint>
+
+namespace gfs
+{
+	constexpr char FS_FORMAT_MAGIC_NUM[4] = { 'g', 'f', 's', 'f' }; // GFS Format
+	constexpr auto FS_FORMAT_VERSION = 2; // 2: Source & metadata hashes in file records.
+
+	constexpr uint32_t FS_FORMAT_PATH_LENGTH = 255;
+
+	constexpr uint32_t FS_FORMAT_HEADER_SIZE = sizeof(FormatHeader::MagicNumber) + sizeof(FormatHeader::FormatVersion) + sizeof(FormatHeader::FileCount);
+
+	constexpr uint32_t FS_FORMAT_MIN_RECORD_SIZE = sizeof(FileID) + sizeof(uint16_t) * 4 + sizeof(uint32_t) * 3; // File record with empty strings/deps.
+
+} // namespace gfs
@@ -0,0 +1,147 @@
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gfs
+{
+	namespace
+	{
+		constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+		constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+		constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+		constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+		constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+		inline auto RotateLeft(uint64_t value, uint32_t bits) -> uint64_t { return (value << bits) | (value >> (64 - bits)); }
+
+		// Little-endian hosts only, matching the rest of the on-disk format.
+		inline auto Read64(const uint8_t* ptr) -> uint64_t
+		{
+			uint64_t value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		inline auto Read32(const uint8_t* ptr) -> uint32_t
+		{
+			uint32_t value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		inline auto Round(uint64_t lane, uint64_t input) -> uint64_t
+		{
+			lane += input * Prime2;
+			lane = RotateLeft(lane, 31);
+			return lane * Prime1;
+		}
+
+		inline auto MergeRound(uint64_t hash, uint64_t lane) -> uint64_t
+		{
+			hash ^= Round(0, lane);
+			return hash * Prime1 + Prime4;
+		}
+
+		// Consumes whole 32 byte stripes. Returns the number of bytes consumed.
+		inline auto ConsumeStripes(uint64_t (&lanes)[4], const uint8_t* data, size_t size) -> size_t
+		{
+			const auto* ptr = data;
+			const auto* const end = data + (size & ~size_t(31));
+			auto lane0 = lanes[0], lane1 = lanes[1], lane2 = lanes[2], lane3 = lanes[3];
+			for (; ptr < end; ptr += 32)
+			{
+				lane0 = Round(lane0, Read64(ptr));
+				lane1 = Round(lane1, Read64(ptr + 8));
+				lane2 = Round(lane2, Read64(ptr + 16));
+				lane3 = Round(lane3, Read64(ptr + 24));
+			}
+			lanes[0] = lane0, lanes[1] = lane1, lanes[2] = lane2, lanes[3] = lane3;
+			return size_t(ptr - data);
+		}
+	} // namespace
+
+	Hasher64::Hasher64(uint64_t seed) : m_seed(seed)
+	{
+		m_lanes[0] = seed + Prime1 + Prime2;
+		m_lanes[1] = seed + Prime2;
+		m_lanes[2] = seed;
+		m_lanes[3] = seed - Prime1;
+	}
+
+	void Hasher64::Update(const void* data, size_t size)
+	{
+		const auto* ptr = static_cast<const uint8_t*>(data);
+		m_totalSize += size;
+
+		if (m_bufferSize != 0)
+		{
+			const auto fill = std::min<size_t>(sizeof(m_buffer) - m_bufferSize, size);
+			std::memcpy(m_buffer + m_bufferSize, ptr, fill);
+			m_bufferSize += uint32_t(fill);
+			ptr += fill;
+			size -= fill;
+
+			if (m_bufferSize < sizeof(m_buffer))
+				return;
+
+			ConsumeStripes(m_lanes, m_buffer, sizeof(m_buffer));
+			m_bufferSize = 0;
+		}
+
+		const auto consumed = ConsumeStripes(m_lanes, ptr, size);
+		std::memcpy(m_buffer, ptr + consumed, size - consumed);
+		m_bufferSize = uint32_t(size - consumed);
+	}
+
+	auto Hasher64::Finish() const -> uint64_t
+	{
+		uint64_t hash;
+		if (m_totalSize >= sizeof(m_buffer))
+		{
+			hash = RotateLeft(m_lanes[0], 1) + RotateLeft(m_lanes[1], 7) + RotateLeft(m_lanes[2], 12) + RotateLeft(m_lanes[3], 18);
+			for (const auto lane : m_lanes)
+				hash = MergeRound(hash, lane);
+		}
+		else
+		{
+			hash = m_seed + Prime5;
+		}
+		hash += m_totalSize;
+
+		const auto* ptr = m_buffer;
+		const auto* const end = m_buffer + m_bufferSize;
+		for (; ptr + 8 <= end; ptr += 8)
+		{
+			hash ^= Round(0, Read64(ptr));
+			hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+		}
+		if (ptr + 4 <= end)
+		{
+			hash ^= uint64_t(Read32(ptr)) * Prime1;
+			hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+			ptr += 4;
+		}
+		for (; ptr < end; ++ptr)
+		{
+			hash ^= *ptr * Prime5;
+			hash = RotateLeft(hash, 11) * Prime1;
+		}
+
+		// Avalanche
+		hash ^= hash >> 33;
+		hash *= Prime2;
+		hash ^= hash >> 29;
+		hash *= Prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	auto Hasher64::Hash(const void* data, size_t size, uint64_t seed) -> uint64_t
+	{
+		Hasher64 hasher(seed);
+		hasher.Update(data, size);
+		return hasher.Finish();
+	}
+
+} // namespace gfs
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gfs
+{
+	/**
+	 * Streaming 64-bit non-cryptographic hash (XXH64). Processes 32 bytes per step, so large inputs hash at memory speed.
+	 */
+	class Hasher64
+	{
+	public:
+		explicit Hasher64(uint64_t seed = 0);
+
+		void Update(const void* data, size_t size);
+
+		/**
+		 * @brief Hash of all data passed to `Update()` so far. Does not modify the state.
+		 * @return
+		 */
+		auto Finish() const -> uint64_t;
+
+		static auto Hash(const void* data, size_t size, uint64_t seed = 0) -> uint64_t;
+		static auto Hash(const std::string& str, uint64_t seed = 0) -> uint64_t { return Hash(str.data(), str.size(), seed); }
+
+	private:
+		uint64_t m_seed;
+		uint64_t m_lanes[4];
+		uint8_t m_buffer[32];
+		uint32_t m_bufferSize = 0;
+		uint64_t m_totalSize = 0;
+	};
+
+} // namespace gfs
@@ -0,0 +1,234 @@
+#include "memory_mount.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <mutex>
+#include <optional>
+
+namespace gfs
+{
+	constexpr size_t MEMORY_FILE_ALIGNMENT = alignof(std::max_align_t); // Same as byte buffers, so data can be read in place.
+
+	MemoryFile::MemoryFile(uint64_t size, uint64_t alignedOffset, Allocator* allocator)
+		: m_allocator(allocator != nullptr ? allocator : GetDefaultAllocator()),
+		  m_blockSize(size_t(size) + (MEMORY_FILE_ALIGNMENT - alignedOffset % MEMORY_FILE_ALIGNMENT) % MEMORY_FILE_ALIGNMENT),
+		  m_block(static_cast<uint8_t*>(m_allocator->Allocate(m_blockSize, MEMORY_FILE_ALIGNMENT, MemoryCategory::FileData))),
+		  m_data(m_block != nullptr ? m_block + (m_blockSize - size_t(size)) : nullptr),
+		  m_size(m_block != nullptr ? size : 0)
+	{
+	}
+
+	MemoryFile::~MemoryFile()
+	{
+		if (m_block != nullptr)
+			m_allocator->Deallocate(m_block, m_blockSize, MEMORY_FILE_ALIGNMENT, MemoryCategory::FileData);
+	}
+
+	auto MemoryFile::Create(const std::vector<WriteChunk>& chunks, Allocator* allocator) -> std::shared_ptr<MemoryFile>
+	{
+		uint64_t size = 0;
+		for (const auto& chunk : chunks)
+			size += chunk.Size;
+
+		auto file = std::make_shared<MemoryFile>(size, chunks.empty() ? 0 : chunks.front().Size, allocator);
+		if (file->GetData() == nullptr)
+			return nullptr;
+
+		auto* writePtr = file->GetData();
+		for (const auto& chunk : chunks)
+		{
+			if (chunk.Size != 0)
+				std::memcpy(writePtr, chunk.Data, chunk.Size);
+			writePtr += chunk.Size;
+		}
+		return file;
+	}
+
+	namespace
+	{
+		class MemoryMountFile : public MountFile
+		{
+		public:
+			explicit MemoryMountFile(std::shared_ptr<const MemoryFile> file) : m_file(std::move(file)) {}
+
+			auto GetResident(uint64_t offset, uint64_t size) const -> const uint8_t* override
+			{
+				if (offset > m_file->GetSize() || size > m_file->GetSize() - offset)
+					return nullptr;
+				return m_file->GetData() + offset;
+			}
+
+			auto Read(uint64_t offset, uint64_t size, uint8_t* outData) -> uint64_t override
+			{
+				const auto* data = GetResident(offset, size);
+				if (data == nullptr)
+					return 0;
+
+				std::memcpy(outData, data, size_t(size));
+				return size;
+			}
+
+			auto ReadUncached(uint64_t offset, uint64_t size, AlignedBuffer& /*buffer*/, Allocator* /*allocator*/, MemoryCategory /*category*/)
+				-> const uint8_t* override
+			{
+				return GetResident(offset, size); // Never in the OS page cache.
+			}
+
+			auto GetVersion() const -> uint64_t override { return 0; } // Sharing would only copy memory this process holds anyway.
+			auto GetStream() -> std::istream& override
+			{
+				// Created on first use, as streams are not cheap to construct & reads of file data do not need one.
+				if (!m_stream)
+				{
+					m_buffer.emplace(m_file->GetData(), m_file->GetSize());
+					m_stream.emplace(&*m_buffer);
+				}
+				return *m_stream;
+			}
+
+		private:
+			std::shared_ptr<const MemoryFile> m_file;
+			std::optional<MemoryStreamBuffer> m_buffer;
+			std::optional<std::istream> m_stream;
+		};
+
+		class MemoryStagedWrite : public StagedWrite
+		{
+		public:
+			MemoryStagedWrite(std::shared_ptr<MemoryMount> mount, std::string mountRelPath, std::shared_ptr<const MemoryFile> file)
+				: m_mount(std::move(mount)),
+				  m_mountRelPath(std::move(mountRelPath)),
+				  m_file(std::move(file))
+			{
+			}
+
+			bool IsSynced() const override { return true; }
+			bool Sync() override { return true; }
+
+			bool Commit() override
+			{
+				m_mount->Store(m_mountRelPath, m_file);
+				return true;
+			}
+
+			void Discard() override { m_file.reset(); }
+			auto GetCommitDirectory() const -> std::filesystem::path override { return {}; }
+
+		private:
+			std::shared_ptr<MemoryMount> m_mount;
+			std::string m_mountRelPath;
+			std::shared_ptr<const MemoryFile> m_file;
+		};
+	} // namespace
+
+	MemoryMount::MemoryMount(Allocator* allocator) : m_allocator(allocator)
+	{
+	}
+
+	auto MemoryMount::Find(const std::string& mountRelPath) const -> std::shared_ptr<const MemoryFile>
+	{
+		std::shared_lock lock(m_mutex);
+		const auto it = m_files.find(mountRelPath);
+		return it != m_files.end() ? it->second : nullptr;
+	}
+
+	void MemoryMount::Store(const std::string& mountRelPath, std::shared_ptr<const MemoryFile> file)
+	{
+		std::shared_ptr<const MemoryFile> previous;
+		{
+			std::unique_lock lock(m_mutex);
+			auto& entry = m_files[mountRelPath];
+			previous = std::move(entry);
+			entry = std::move(file);
+		}
+		// `previous` is released outside the lock, as freeing a large file is not free.
+	}
+
+	auto MemoryMount::Open(const std::string& mountRelPath) const -> std::unique_ptr<MountFile>
+	{
+		auto file = Find(mountRelPath);
+		if (!file)
+			return nullptr;
+		return std::make_unique<MemoryMountFile>(std::move(file));
+	}
+
+	auto MemoryMount::Stage(const std::string& mountRelPath, const std::vector<WriteChunk>& chunks, bool /*sync*/) -> std::shared_ptr<StagedWrite>
+	{
+		// Assembled in memory in place of the temporary file & stored when committed in place of the rename.
+		auto file = MemoryFile::Create(chunks, m_allocator);
+		if (!file)
+			return nullptr;
+		return std::make_shared<MemoryStagedWrite>(shared_from_this(), mountRelPath, std::move(file));
+	}
+
+	auto MemoryMount::StageCopy(const std::string& mountRelPath, std::istream& stream, uint64_t size, uint64_t alignedOffset)
+		-> std::shared_ptr<StagedWrite>
+	{
+		auto file = std::make_shared<MemoryFile>(size, alignedOffset, m_allocator);
+		if (file->GetData() == nullptr)
+			return nullptr;
+
+		stream.read(reinterpret_cast<char*>(file->GetData()), std::streamsize(size));
+		if (uint64_t(stream.gcount()) != size)
+			return nullptr;
+		return std::make_shared<MemoryStagedWrite>(shared_from_this(), mountRelPath, std::move(file));
+	}
+
+	void MemoryMount::CreateDirectories(const std::filesystem::path& /*mountRelDir*/)
+	{
+		// Paths are just keys.
+	}
+
+	void MemoryMount::Enumerate(const EnumerateCallback& callback) const
+	{
+		std::vector<std::pair<std::string, uint64_t>> files;
+		{
+			// Copied so `callback` is free to write to the mount.
+			std::shared_lock lock(m_mutex);
+			files.reserve(m_files.size());
+			for (const auto& [mountRelPath, file] : m_files)
+				files.emplace_back(mountRelPath, file->GetSize());
+		}
+
+		for (const auto& [mountRelPath, size] : files)
+			callback(mountRelPath, size, 0);
+	}
+
+	bool MemoryMount::ContainsPath(const std::filesystem::path& /*path*/) const
+	{
+		return false; // Not in the filesystem.
+	}
+
+	MemoryStreamBuffer::MemoryStreamBuffer(const uint8_t* data, uint64_t size)
+	{
+		// Never written through, the stream buffer interface just is not const.
+		auto* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+		setg(begin, begin, begin + size);
+	}
+
+	auto MemoryStreamBuffer::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) -> pos_type
+	{
+		if ((which & std::ios_base::in) == 0)
+			return pos_type(off_type(-1));
+
+		off_type base = 0;
+		if (dir == std::ios_base::cur)
+			base = gptr() - eback();
+		else if (dir == std::ios_base::end)
+			base = egptr() - eback();
+
+		const auto position = base + offset;
+		if (position < 0 || position > egptr() - eback())
+			return pos_type(off_type(-1));
+
+		setg(eback(), eback() + position, egptr());
+		return pos_type(position);
+	}
+
+	auto MemoryStreamBuffer::seekpos(pos_type position, std::ios_base::openmode which) -> pos_type
+	{
+		return seekoff(off_type(position), std::ios_base::beg, which);
+	}
+
+} // namespace gfs
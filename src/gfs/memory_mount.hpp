@@ -0,0 +1,102 @@
+#pragma once
+
+#include "gfs/allocator.hpp"
+#include "file_io.hpp"
+#include "mount_backend.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gfs
+{
+	/**
+	 * A whole gfs file (header, records & data) held in memory, laid out exactly as it is on disk so records & offsets are the
+	 * same for both kinds of mount. Immutable once stored.
+	 */
+	class MemoryFile
+	{
+	public:
+		/**
+		 * @brief
+		 * @param size
+		 * @param alignedOffset Offset within the file placed at `alignof(std::max_align_t)`, eg. The start of the file data so
+		 * it can be read in place.
+		 * @param allocator
+		 * @attention `GetData()` is nullptr if the allocator could not provide the memory.
+		 */
+		MemoryFile(uint64_t size, uint64_t alignedOffset, Allocator* allocator);
+		~MemoryFile();
+
+		MemoryFile(const MemoryFile&) = delete;
+		MemoryFile& operator=(const MemoryFile&) = delete;
+
+		/**
+		 * @brief Assembles a file from the chunks passed to `WriteFileChunks()`.
+		 * @param chunks The first chunk holds the header & records, so the data following it is aligned.
+		 * @param allocator
+		 * @return nullptr if out of memory.
+		 */
+		static auto Create(const std::vector<WriteChunk>& chunks, Allocator* allocator) -> std::shared_ptr<MemoryFile>;
+
+		auto GetData() const -> const uint8_t* { return m_data; }
+		auto GetData() -> uint8_t* { return m_data; }
+		auto GetSize() const -> uint64_t { return m_size; }
+
+	private:
+		Allocator* m_allocator;
+		size_t m_blockSize;
+		uint8_t* m_block;
+		uint8_t* m_data;
+		uint64_t m_size;
+	};
+
+	/**
+	 * Files of an in-memory mount, keyed by normalized mount relative path (See `FileRegistry::NormalizePath()`).
+	 * Storing a file replaces it, so readers still holding the previous version are unaffected. Files are read in place.
+	 */
+	class MemoryMount : public MountBackend, public std::enable_shared_from_this<MemoryMount>
+	{
+	public:
+		/**
+		 * @brief
+		 * @param allocator Used for the files. Must outlive the mount.
+		 */
+		explicit MemoryMount(Allocator* allocator);
+
+		auto Find(const std::string& mountRelPath) const -> std::shared_ptr<const MemoryFile>;
+		void Store(const std::string& mountRelPath, std::shared_ptr<const MemoryFile> file);
+
+		bool IsInMemory() const override { return true; }
+		auto Open(const std::string& mountRelPath) const -> std::unique_ptr<MountFile> override;
+		auto Stage(const std::string& mountRelPath, const std::vector<WriteChunk>& chunks, bool sync) -> std::shared_ptr<StagedWrite> override;
+		auto StageCopy(const std::string& mountRelPath, std::istream& stream, uint64_t size, uint64_t alignedOffset)
+			-> std::shared_ptr<StagedWrite> override;
+		void CreateDirectories(const std::filesystem::path& mountRelDir) override;
+		void Enumerate(const EnumerateCallback& callback) const override;
+		bool ContainsPath(const std::filesystem::path& path) const override;
+
+	private:
+		Allocator* m_allocator;
+		mutable std::shared_mutex m_mutex;
+		std::unordered_map<std::string, std::shared_ptr<const MemoryFile>> m_files;
+	};
+
+	/**
+	 * Read only, seekable stream buffer over memory, so file records are parsed from memory files without copying them.
+	 */
+	class MemoryStreamBuffer : public std::streambuf
+	{
+	public:
+		MemoryStreamBuffer(const uint8_t* data, uint64_t size);
+
+	protected:
+		auto seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) -> pos_type override;
+		auto seekpos(pos_type position, std::ios_base::openmode which) -> pos_type override;
+	};
+
+} // namespace gfs
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "gfs/allocator.hpp"
+#include "file_io.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gfs
+{
+	/**
+	 * A gfs file opened for reading from a mount.
+	 */
+	class MountFile
+	{
+	public:
+		virtual ~MountFile() = default;
+
+		/**
+		 * @brief
+		 * @param offset
+		 * @param size
+		 * @return The range if the file is held in memory, so it is read in place. nullptr otherwise.
+		 */
+		virtual auto GetResident(uint64_t offset, uint64_t size) const -> const uint8_t* = 0;
+
+		/**
+		 * @brief Copies a range into memory owned by the caller.
+		 * @param offset
+		 * @param size
+		 * @param outData
+		 * @return Number of bytes read.
+		 */
+		virtual auto Read(uint64_t offset, uint64_t size, uint8_t* outData) -> uint64_t = 0;
+
+		/**
+		 * @brief Reads a range without leaving it in the OS page cache (See `gfs::ReadFileUncached()`).
+		 * @param offset
+		 * @param size
+		 * @param buffer
+		 * @param allocator
+		 * @param category
+		 * @return Start of the range, in `buffer` or in place. nullptr if it could not be read.
+		 */
+		virtual auto ReadUncached(uint64_t offset, uint64_t size, AlignedBuffer& buffer, Allocator* allocator, MemoryCategory category)
+			-> const uint8_t* = 0;
+
+		/**
+		 * @brief Identifies the file's current contents for caches shared between processes (See `gfs::GetFileVersion()`).
+		 * @return 0 if the file is not shared, eg. It is already held in memory.
+		 */
+		virtual auto GetVersion() const -> uint64_t = 0;
+
+		/**
+		 * @brief
+		 * @return Stream over the whole file, to parse its records. Failed if the file could not be opened.
+		 */
+		virtual auto GetStream() -> std::istream& = 0;
+	};
+
+	/**
+	 * A file written to a mount that is not visible in it until committed, so readers never see part of a file.
+	 */
+	class StagedWrite
+	{
+	public:
+		virtual ~StagedWrite() = default;
+
+		/**
+		 * @brief
+		 * @return True once the staged data is durable, or if it never needs to be.
+		 */
+		virtual bool IsSynced() const = 0;
+
+		/**
+		 * @brief Flushes the staged data to storage.
+		 * @return
+		 */
+		virtual bool Sync() = 0;
+
+		/**
+		 * @brief Makes the file visible, replacing any previous version. Readers holding the previous version are unaffected.
+		 * @return False if it could not be committed, in which case it is discarded.
+		 */
+		virtual bool Commit() = 0;
+
+		/**
+		 * @brief Drops the staged data without committing it.
+		 */
+		virtual void Discard() = 0;
+
+		/**
+		 * @brief
+		 * @return Directory whose entries a commit changes, to be synced so commits survive a crash. Empty if there is none.
+		 */
+		virtual auto GetCommitDirectory() const -> std::filesystem::path = 0;
+	};
+
+	/**
+	 * Where a mount's gfs files are stored. Paths are mount relative & normalized (See `FileRegistry::NormalizePath()`).
+	 * Backends are used from any thread.
+	 */
+	class MountBackend
+	{
+	public:
+		using EnumerateCallback = std::function<void(const std::string& mountRelPath, uint64_t size, int64_t lastWriteTime)>;
+
+	public:
+		virtual ~MountBackend() = default;
+
+		virtual bool IsInMemory() const = 0;
+
+		/**
+		 * @brief
+		 * @param mountRelPath
+		 * @return nullptr if the file does not exist. Files on disk may only fail once read.
+		 */
+		virtual auto Open(const std::string& mountRelPath) const -> std::unique_ptr<MountFile> = 0;
+
+		/**
+		 * @brief Writes a file, to be committed later.
+		 * @param mountRelPath
+		 * @param chunks The first chunk holds the header & records.
+		 * @param sync Flushes the data to storage before returning.
+		 * @return nullptr if it could not be written.
+		 */
+		virtual auto Stage(const std::string& mountRelPath, const std::vector<WriteChunk>& chunks, bool sync) -> std::shared_ptr<StagedWrite> = 0;
+
+		/**
+		 * @brief Copies a whole gfs file from a stream into the mount, to be committed later.
+		 * @param mountRelPath
+		 * @param stream
+		 * @param size
+		 * @param alignedOffset Offset within the file to align, eg. The start of the file data.
+		 * @return nullptr if it could not be read or the backend only stores files written with `Stage()`.
+		 */
+		virtual auto StageCopy(const std::string& mountRelPath, std::istream& stream, uint64_t size, uint64_t alignedOffset)
+			-> std::shared_ptr<StagedWrite> = 0;
+
+		/**
+		 * @brief Creates a directory (& its parents) for files to be written into.
+		 * @param mountRelDir
+		 */
+		virtual void CreateDirectories(const std::filesystem::path& mountRelDir) = 0;
+
+		/**
+		 * @brief Calls `callback` for each gfs file in the mount. Temporary files of uncommitted writes are skipped.
+		 * @param callback
+		 */
+		virtual void Enumerate(const EnumerateCallback& callback) const = 0;
+
+		/**
+		 * @brief
+		 * @param path
+		 * @return
+		 * @attention Backs `Filesystem::IsPathInMount()`, which is unsure to work as intended.
+		 */
+		virtual bool ContainsPath(const std::filesystem::path& path) const = 0;
+	};
+
+} // namespace gfs
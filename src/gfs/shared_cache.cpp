@@ -0,0 +1,295 @@
+#include "shared_cache.hpp"
+
+#include "hash.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define GFS_POSIX_SHARED_MEMORY
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <new>
+#include <thread>
+
+namespace gfs
+{
+	constexpr uint64_t SHARED_CACHE_MAGIC_NUM = 0x3168636163736667; // "gfscach1"
+	constexpr uint32_t SHARED_CACHE_LAYOUT_VERSION = 1;
+	constexpr uint64_t SHARED_CACHE_DATA_ALIGNMENT = 64; // Cache line, which also satisfies `alignof(std::max_align_t)`.
+	constexpr uint64_t SHARED_CACHE_PAGE_SIZE = 4096;
+	constexpr auto SHARED_CACHE_OPEN_TIMEOUT = std::chrono::seconds(1); // For the process creating the segment to set it up.
+
+	enum class SharedCacheSlotState : uint32_t
+	{
+		Empty,	   // Ends a probe sequence.
+		Claimed,   // Taken by an insert, key not written yet.
+		Filling,   // Key written, data being written.
+		Ready,	   // Immutable from here on.
+		Abandoned, // Filling failed. Kept so probe sequences passing through it stay intact.
+	};
+
+	static_assert(std::atomic<SharedCacheSlotState>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+		"Atomics shared between processes must be lock free");
+
+	struct SharedCacheSlot
+	{
+		std::atomic<SharedCacheSlotState> State;
+		uint32_t Padding;
+		FileID FileId;
+		uint64_t Version;
+		uint64_t Offset; // Within the data.
+		uint64_t Size;
+	};
+
+	// Start of the segment, followed by the slots & the data.
+	struct SharedCacheSegment
+	{
+		std::atomic<uint64_t> MagicNumber; // Stored last by the creator, so other processes know the layout is set up.
+		uint32_t LayoutVersion;
+		uint32_t SlotCount; // Power of 2.
+		uint64_t SlotsOffset;
+		uint64_t DataOffset;
+		uint64_t DataCapacity;
+		std::atomic<uint64_t> DataSize; // Bytes of data reserved so far.
+	};
+
+	static auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static auto HashKey(FileID fileId, uint64_t version) -> uint64_t
+	{
+		const uint64_t key[2] = { fileId, version };
+		return Hasher64::Hash(key, sizeof(key));
+	}
+
+	SharedCache::SharedCache(void* mapping, uint64_t mappingSize)
+		: m_mapping(mapping),
+		  m_mappingSize(mappingSize),
+		  m_segment(static_cast<SharedCacheSegment*>(mapping)),
+		  m_slots(nullptr),
+		  m_slotCount(0),
+		  m_data(nullptr),
+		  m_dataCapacity(0)
+	{
+	}
+
+	SharedCache::~SharedCache()
+	{
+#if defined(GFS_POSIX_SHARED_MEMORY)
+		::munmap(m_mapping, size_t(m_mappingSize));
+#endif
+	}
+
+	auto SharedCache::Open(const std::string& name, uint64_t capacity, uint32_t maxEntries) -> std::shared_ptr<SharedCache>
+	{
+#if defined(GFS_POSIX_SHARED_MEMORY)
+		if (name.empty() || capacity == 0 || maxEntries == 0)
+			return nullptr;
+
+		const auto objectName = name.front() == '/' ? name : "/" + name;
+
+		// At most half full, so probe sequences stay short.
+		uint64_t slotCount = 1;
+		while (slotCount < uint64_t(maxEntries) * 2)
+			slotCount *= 2;
+		if (slotCount > UINT32_MAX)
+			return nullptr;
+
+		const auto slotsOffset = AlignUp(sizeof(SharedCacheSegment), SHARED_CACHE_DATA_ALIGNMENT);
+		const auto dataOffset = AlignUp(slotsOffset + slotCount * sizeof(SharedCacheSlot), SHARED_CACHE_PAGE_SIZE);
+		const auto dataCapacity = AlignUp(capacity, SHARED_CACHE_DATA_ALIGNMENT);
+
+		bool created = true;
+		int fd = ::shm_open(objectName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0 && errno == EEXIST)
+		{
+			created = false;
+			fd = ::shm_open(objectName.c_str(), O_RDWR, 0);
+		}
+		if (fd < 0)
+			return nullptr;
+
+		const auto deadline = std::chrono::steady_clock::now() + SHARED_CACHE_OPEN_TIMEOUT;
+		uint64_t mappingSize = dataOffset + dataCapacity;
+		if (created)
+		{
+			// Zero filled, so every slot starts out empty.
+			if (::ftruncate(fd, off_t(mappingSize)) != 0)
+			{
+				::close(fd);
+				::shm_unlink(objectName.c_str());
+				return nullptr;
+			}
+		}
+		else
+		{
+			// The creator may not have sized it yet.
+			struct stat status{};
+			while (::fstat(fd, &status) == 0 && status.st_size == 0 && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			mappingSize = uint64_t(status.st_size);
+			if (mappingSize < sizeof(SharedCacheSegment))
+			{
+				::close(fd);
+				return nullptr;
+			}
+		}
+
+		void* mapping = ::mmap(nullptr, size_t(mappingSize), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED)
+		{
+			if (created)
+				::shm_unlink(objectName.c_str());
+			return nullptr;
+		}
+
+		std::shared_ptr<SharedCache> cache(new SharedCache(mapping, mappingSize));
+		auto* segment = cache->m_segment;
+		if (created)
+		{
+			new (segment) SharedCacheSegment{};
+			segment->LayoutVersion = SHARED_CACHE_LAYOUT_VERSION;
+			segment->SlotCount = uint32_t(slotCount);
+			segment->SlotsOffset = slotsOffset;
+			segment->DataOffset = dataOffset;
+			segment->DataCapacity = dataCapacity;
+			auto* slots = reinterpret_cast<SharedCacheSlot*>(static_cast<uint8_t*>(mapping) + slotsOffset);
+			for (uint64_t i = 0; i < slotCount; ++i)
+				new (&slots[i]) SharedCacheSlot{};
+			segment->MagicNumber.store(SHARED_CACHE_MAGIC_NUM, std::memory_order_release);
+		}
+		else
+		{
+			while (segment->MagicNumber.load(std::memory_order_acquire) != SHARED_CACHE_MAGIC_NUM && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			// Written by another process, so checked before it is trusted.
+			const auto slotsEnd = segment->SlotsOffset + uint64_t(segment->SlotCount) * sizeof(SharedCacheSlot);
+			if (segment->MagicNumber.load(std::memory_order_acquire) != SHARED_CACHE_MAGIC_NUM || segment->LayoutVersion != SHARED_CACHE_LAYOUT_VERSION ||
+				segment->SlotCount == 0 || (segment->SlotCount & (segment->SlotCount - 1)) != 0 || segment->SlotsOffset < sizeof(SharedCacheSegment) || segment->SlotsOffset > mappingSize ||
+				segment->SlotsOffset % SHARED_CACHE_DATA_ALIGNMENT != 0 || slotsEnd > segment->DataOffset ||
+				segment->DataOffset % SHARED_CACHE_DATA_ALIGNMENT != 0 || segment->DataOffset > mappingSize ||
+				segment->DataCapacity > mappingSize - segment->DataOffset)
+				return nullptr;
+		}
+
+		cache->m_slots = reinterpret_cast<SharedCacheSlot*>(static_cast<uint8_t*>(mapping) + segment->SlotsOffset);
+		cache->m_slotCount = segment->SlotCount;
+		cache->m_data = static_cast<uint8_t*>(mapping) + segment->DataOffset;
+		cache->m_dataCapacity = segment->DataCapacity;
+		return cache;
+#else
+		(void)name;
+		(void)capacity;
+		(void)maxEntries;
+		return nullptr;
+#endif
+	}
+
+	bool SharedCache::Remove(const std::string& name)
+	{
+#if defined(GFS_POSIX_SHARED_MEMORY)
+		if (name.empty())
+			return false;
+
+		const auto objectName = name.front() == '/' ? name : "/" + name;
+		return ::shm_unlink(objectName.c_str()) == 0;
+#else
+		(void)name;
+		return false;
+#endif
+	}
+
+	auto SharedCache::Find(FileID fileId, uint64_t version, uint64_t size) const -> const uint8_t*
+	{
+		const auto mask = m_slotCount - 1;
+		auto index = uint32_t(HashKey(fileId, version)) & mask;
+		for (uint32_t probes = 0; probes < m_slotCount; ++probes, index = (index + 1) & mask)
+		{
+			const auto& slot = m_slots[index];
+			const auto state = slot.State.load(std::memory_order_acquire);
+			if (state == SharedCacheSlotState::Empty)
+				return nullptr;
+
+			if (state == SharedCacheSlotState::Ready && slot.FileId == fileId && slot.Version == version)
+			{
+				if (slot.Size != size || slot.Offset > m_dataCapacity || size > m_dataCapacity - slot.Offset)
+					return nullptr;
+				return m_data + slot.Offset;
+			}
+		}
+		return nullptr;
+	}
+
+	auto SharedCache::Reserve(FileID fileId, uint64_t version, uint64_t size) -> Entry
+	{
+		if (size == 0 || size > m_dataCapacity)
+			return {};
+
+		// Checked again once a slot is won. This just keeps a full segment from using up slots.
+		const auto alignedSize = AlignUp(size, SHARED_CACHE_DATA_ALIGNMENT);
+		const auto usedBefore = m_segment->DataSize.load(std::memory_order_relaxed);
+		if (usedBefore > m_dataCapacity || alignedSize > m_dataCapacity - usedBefore)
+			return {};
+
+		const auto mask = m_slotCount - 1;
+		auto index = uint32_t(HashKey(fileId, version)) & mask;
+		for (uint32_t probes = 0; probes < m_slotCount; ++probes, index = (index + 1) & mask)
+		{
+			auto& slot = m_slots[index];
+			auto state = slot.State.load(std::memory_order_acquire);
+			if (state == SharedCacheSlotState::Empty)
+			{
+				// The slot is won before any data is reserved, so losing a race never strands reserved bytes.
+				auto expected = SharedCacheSlotState::Empty;
+				if (slot.State.compare_exchange_strong(expected, SharedCacheSlotState::Claimed, std::memory_order_acq_rel))
+				{
+					slot.FileId = fileId;
+					slot.Version = version;
+					slot.Size = size;
+
+					auto used = m_segment->DataSize.load(std::memory_order_relaxed);
+					do
+					{
+						if (used > m_dataCapacity || alignedSize > m_dataCapacity - used)
+						{
+							// Full. Abandoned rather than emptied, as another insert may already be probing past it.
+							slot.Offset = 0;
+							slot.State.store(SharedCacheSlotState::Abandoned, std::memory_order_release);
+							return {};
+						}
+					} while (!m_segment->DataSize.compare_exchange_weak(used, used + alignedSize, std::memory_order_relaxed));
+
+					slot.Offset = used;
+					slot.State.store(SharedCacheSlotState::Filling, std::memory_order_release);
+					return { index, m_data + used };
+				}
+				state = expected; // Another process took it first.
+			}
+
+			// Racing inserts of the same file can both miss each other while claimed, which only wastes a slot & its space.
+			if ((state == SharedCacheSlotState::Filling || state == SharedCacheSlotState::Ready) && slot.FileId == fileId && slot.Version == version)
+				return {};
+		}
+		return {};
+	}
+
+	void SharedCache::Publish(const Entry& entry)
+	{
+		m_slots[entry.Slot].State.store(SharedCacheSlotState::Ready, std::memory_order_release);
+	}
+
+	void SharedCache::Abandon(const Entry& entry)
+	{
+		m_slots[entry.Slot].State.store(SharedCacheSlotState::Abandoned, std::memory_order_release);
+	}
+
+} // namespace gfs
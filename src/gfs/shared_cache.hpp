@@ -0,0 +1,87 @@
+#pragma once
+
+#include "gfs/file_registry.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace gfs
+{
+	struct SharedCacheSegment;
+	struct SharedCacheSlot;
+
+	/**
+	 * Decompressed file data in a named shared memory segment, so processes on one machine reading the same files hold a
+	 * single copy. Entries are keyed by file id & content version & are immutable once published. The index is a fixed size
+	 * open addressing table updated only with atomics, so processes never wait on each other (or on one that died part way
+	 * through an insert), & data is appended to the segment until it is full. Nothing is evicted.
+	 */
+	class SharedCache
+	{
+	public:
+		struct Entry
+		{
+			uint32_t Slot = 0;
+			uint8_t* Data = nullptr; // nullptr if nothing was reserved.
+		};
+
+	public:
+		~SharedCache();
+
+		SharedCache(const SharedCache&) = delete;
+		SharedCache& operator=(const SharedCache&) = delete;
+
+		/**
+		 * @brief Opens the segment called `name`, creating it if no process has yet. Sizes only apply when it is created.
+		 * @param name
+		 * @param capacity Bytes of file data.
+		 * @param maxEntries
+		 * @return nullptr if the segment could not be created, is incompatible, or on platforms without POSIX shared memory.
+		 */
+		static auto Open(const std::string& name, uint64_t capacity, uint32_t maxEntries) -> std::shared_ptr<SharedCache>;
+
+		/**
+		 * @brief Removes the segment's name. Processes that already opened it keep using it.
+		 * @param name
+		 * @return
+		 */
+		static bool Remove(const std::string& name);
+
+		/**
+		 * @brief
+		 * @param fileId
+		 * @param version
+		 * @param size Expected size of the data.
+		 * @return The published data, valid until this cache is destroyed. nullptr if not cached.
+		 */
+		auto Find(FileID fileId, uint64_t version, uint64_t size) const -> const uint8_t*;
+
+		/**
+		 * @brief Reserves space for a file's data. Fill it & `Publish()` it, or `Abandon()` it if that fails.
+		 * @param fileId
+		 * @param version
+		 * @param size
+		 * @return Nothing reserved if the file is already cached (or being added), or the segment is full.
+		 */
+		auto Reserve(FileID fileId, uint64_t version, uint64_t size) -> Entry;
+
+		void Publish(const Entry& entry);
+		void Abandon(const Entry& entry);
+
+	private:
+		SharedCache(void* mapping, uint64_t mappingSize);
+
+	private:
+		void* m_mapping;
+		uint64_t m_mappingSize;
+		SharedCacheSegment* m_segment;
+
+		// Copied out of the segment once validated, as other processes can write to it.
+		SharedCacheSlot* m_slots;
+		uint32_t m_slotCount;
+		uint8_t* m_data;
+		uint64_t m_dataCapacity;
+	};
+
+} // namespace gfs
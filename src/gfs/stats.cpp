@@ -0,0 +1,116 @@
+#include "gfs/stats.hpp"
+
+#include "stats_collector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gfs
+{
+	namespace
+	{
+		// Number of bits needed to represent `value` (0 for 0).
+		auto BitWidth(uint64_t value) -> uint32_t
+		{
+			uint32_t width = 0;
+			for (uint32_t shift = 32; shift != 0; shift /= 2)
+			{
+				if (value >> shift)
+				{
+					value >>= shift;
+					width += shift;
+				}
+			}
+			return width + uint32_t(value);
+		}
+	} // namespace
+
+	auto LatencyHistogram::GetPercentileNs(double percentile) const -> uint64_t
+	{
+		if (Count == 0)
+			return 0;
+
+		const auto rank = std::clamp<uint64_t>(uint64_t(std::ceil(percentile / 100.0 * double(Count))), 1, Count);
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < BucketCount; ++i)
+		{
+			seen += Buckets[i];
+			if (seen >= rank)
+				return i == 0 ? 0 : std::min(uint64_t(1) << i, MaxNs);
+		}
+		return MaxNs;
+	}
+
+	void StatHistogram::Record(std::chrono::nanoseconds duration)
+	{
+		if constexpr (StatsEnabled)
+		{
+			const auto ns = uint64_t(std::max<int64_t>(duration.count(), 0));
+			const auto bucket = std::min(BitWidth(ns), LatencyHistogram::BucketCount - 1);
+			m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			m_count.Add();
+			m_totalNs.Add(ns);
+			m_maxNs.Max(ns);
+		}
+	}
+
+	auto StatHistogram::Snapshot() const -> LatencyHistogram
+	{
+		LatencyHistogram histogram{};
+		for (uint32_t i = 0; i < LatencyHistogram::BucketCount; ++i)
+			histogram.Buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		histogram.Count = m_count.Get();
+		histogram.TotalNs = m_totalNs.Get();
+		histogram.MaxNs = m_maxNs.Get();
+		return histogram;
+	}
+
+	void StatHistogram::Reset()
+	{
+		for (auto& bucket : m_buckets)
+			bucket.store(0, std::memory_order_relaxed);
+		m_count.Reset();
+		m_totalNs.Reset();
+		m_maxNs.Reset();
+	}
+
+	auto StatsCollector::Snapshot() const -> FilesystemStats
+	{
+		FilesystemStats stats{};
+		const auto elapsed = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(StartTime.load());
+		stats.ElapsedSeconds = std::chrono::duration<double>(elapsed).count();
+
+		stats.BytesRead = BytesRead.Get();
+		stats.BytesWritten = BytesWritten.Get();
+		stats.FilesRead = FilesRead.Get();
+		stats.FilesWritten = FilesWritten.Get();
+		stats.FileOpens = FileOpens.Get();
+		stats.OpensPerSecond = stats.ElapsedSeconds > 0.0 ? double(stats.FileOpens) / stats.ElapsedSeconds : 0.0;
+
+		stats.ImportCacheHits = ImportCacheHits.Get();
+		stats.ImportCacheMisses = ImportCacheMisses.Get();
+		stats.MountIndexHits = MountIndexHits.Get();
+		stats.SharedCacheHits = SharedCacheHits.Get();
+		stats.SharedCacheMisses = SharedCacheMisses.Get();
+
+		stats.ReadFileLatency = ReadFileLatency.Snapshot();
+		stats.CompressTime = CompressTime.Snapshot();
+		stats.DecompressTime = DecompressTime.Snapshot();
+		stats.MountScanTime = MountScanTime.Snapshot();
+
+		stats.MaxHotReloadQueueDepth = uint32_t(MaxHotReloadQueueDepth.Get());
+		return stats;
+	}
+
+	void StatsCollector::Reset()
+	{
+		StartTime.store(std::chrono::steady_clock::now().time_since_epoch().count());
+
+		for (auto* counter : { &BytesRead, &BytesWritten, &FilesRead, &FilesWritten, &FileOpens, &ImportCacheHits, &ImportCacheMisses, &MountIndexHits, &SharedCacheHits,
+				 &SharedCacheMisses, &MaxHotReloadQueueDepth })
+			counter->Reset();
+		for (auto* histogram : { &ReadFileLatency, &CompressTime, &DecompressTime, &MountScanTime })
+			histogram->Reset();
+	}
+
+} // namespace gfs
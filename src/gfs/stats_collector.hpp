@@ -0,0 +1,111 @@
+#pragma once
+
+#include "gfs/stats.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace gfs
+{
+	// Relaxed atomics only, so recording is a few uncontended instructions. Every operation is a no-op when stats are compiled out.
+	class StatCounter
+	{
+	public:
+		void Add(uint64_t value = 1)
+		{
+			if constexpr (StatsEnabled)
+				m_value.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		void Max(uint64_t value)
+		{
+			if constexpr (StatsEnabled)
+			{
+				auto current = m_value.load(std::memory_order_relaxed);
+				while (value > current && !m_value.compare_exchange_weak(current, value, std::memory_order_relaxed))
+				{
+				}
+			}
+		}
+
+		auto Get() const -> uint64_t { return m_value.load(std::memory_order_relaxed); }
+		void Reset() { m_value.store(0, std::memory_order_relaxed); }
+
+	private:
+		std::atomic<uint64_t> m_value = 0;
+	};
+
+	class StatHistogram
+	{
+	public:
+		void Record(std::chrono::nanoseconds duration);
+
+		auto Snapshot() const -> LatencyHistogram;
+		void Reset();
+
+	private:
+		std::atomic<uint64_t> m_buckets[LatencyHistogram::BucketCount]{};
+		StatCounter m_count;
+		StatCounter m_totalNs;
+		StatCounter m_maxNs;
+	};
+
+	/**
+	 * Records the time from construction to destruction into a histogram.
+	 */
+	class ScopedStatTimer
+	{
+	public:
+		explicit ScopedStatTimer(StatHistogram& histogram) : m_histogram(histogram)
+		{
+			if constexpr (StatsEnabled)
+				m_start = std::chrono::steady_clock::now();
+		}
+
+		~ScopedStatTimer()
+		{
+			if constexpr (StatsEnabled)
+				m_histogram.Record(std::chrono::steady_clock::now() - m_start);
+		}
+
+		ScopedStatTimer(const ScopedStatTimer&) = delete;
+		ScopedStatTimer& operator=(const ScopedStatTimer&) = delete;
+
+	private:
+		StatHistogram& m_histogram;
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	struct StatsCollector
+	{
+		std::atomic<int64_t> StartTime = std::chrono::steady_clock::now().time_since_epoch().count();
+
+		StatCounter BytesRead;
+		StatCounter BytesWritten;
+		StatCounter FilesRead;
+		StatCounter FilesWritten;
+		StatCounter FileOpens;
+
+		StatCounter ImportCacheHits;
+		StatCounter ImportCacheMisses;
+		StatCounter MountIndexHits;
+		StatCounter SharedCacheHits;
+		StatCounter SharedCacheMisses;
+
+		StatHistogram ReadFileLatency;
+		StatHistogram CompressTime;
+		StatHistogram DecompressTime;
+		StatHistogram MountScanTime;
+
+		StatCounter MaxHotReloadQueueDepth;
+
+		/**
+		 * @brief Copies the counters. Counters are read individually, so a snapshot taken under load may be slightly inconsistent.
+		 * @return Stats without the hot reload queue depth, which the filesystem fills in.
+		 */
+		auto Snapshot() const -> FilesystemStats;
+		void Reset();
+	};
+
+} // namespace gfs
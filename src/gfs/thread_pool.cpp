@@ -0,0 +1,56 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace gfs
+{
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		m_threads.reserve(threadCount);
+		for (auto i = 0u; i < threadCount; ++i)
+			m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_shutdown = true;
+		}
+		m_jobCondition.notify_all();
+
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	void ThreadPool::Enqueue(std::function<void()> job)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_jobs.push(std::move(job));
+		}
+		m_jobCondition.notify_one();
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock lock(m_mutex);
+				m_jobCondition.wait(lock, [this]() { return m_shutdown || !m_jobs.empty(); });
+				if (m_jobs.empty())
+					return; // Shutdown & no work left.
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop();
+			}
+			job();
+		}
+	}
+
+} // namespace gfs
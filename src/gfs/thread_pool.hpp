@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gfs
+{
+	/**
+	 * Fixed size pool of worker threads used for internal background work (mount scanning, etc.).
+	 */
+	class ThreadPool
+	{
+	public:
+		/**
+		 * @param threadCount Number of worker threads. 0 = std::thread::hardware_concurrency().
+		 */
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/**
+		 * @brief Queues a job to be run on a worker thread.
+		 * @return Future that becomes ready once the job has completed.
+		 * @attention Jobs should not block waiting on other jobs submitted to the same pool.
+		 */
+		template <typename Func>
+		auto Submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>>;
+
+		auto GetThreadCount() const -> uint32_t { return uint32_t(m_threads.size()); }
+
+	private:
+		void Enqueue(std::function<void()> job);
+		void WorkerLoop();
+
+	private:
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_mutex;
+		std::condition_variable m_jobCondition;
+		std::queue<std::function<void()>> m_jobs;
+		bool m_shutdown = false;
+	};
+
+	template <typename Func>
+	auto ThreadPool::Submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>>
+	{
+		using ResultType = std::invoke_result_t<std::decay_t<Func>>;
+
+		// std::function requires copyable targets, so the (move-only) task is shared.
+		auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+		auto future = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return future;
+	}
+
+} // namespace gfs
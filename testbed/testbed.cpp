@@ -2,17 +2,22 @@
 #include <chrono>
 #include <gfs/gfs.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <ratio>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 auto ReadTextFile(const std::filesystem::path& filename) -> std::string
 {
@@ -25,7 +30,7 @@ auto ReadTextFile(const std::filesystem::path& filename) -> std::string
 	return ss.str();
 }
 
-struct DataType : gfs::BinaryStreamable
+struct DataType : gfs::FieldStreamable<DataType>
 {
 	uint32_t value_a = 0;
 	float value_b = 0.0f;
@@ -34,18 +39,37 @@ struct DataType : gfs::BinaryStreamable
 	DataType() = default;
 	DataType(uint32_t a, float b, bool c) : value_a(a), value_b(b), value_c(c) {}
 
-	void Read(gfs::ReadOnlyByteBuffer& buffer) override
+	// Read & Write are generated from this list. The members are adjacent so are copied with a single memcpy.
+	static constexpr auto GetFields()
 	{
-		buffer.Read(value_a);
-		buffer.Read(value_b);
-		buffer.Read(value_c);
+		return std::make_tuple(gfs::Field(&DataType::value_a), gfs::Field(&DataType::value_b), gfs::Field(&DataType::value_c));
 	}
+};
+
+// Version 1 of `VersionedData`, as data written before `Extra` was added.
+struct VersionedDataV1 : gfs::FieldStreamable<VersionedDataV1>
+{
+	uint32_t Id = 0;
+	std::string Name;
+
+	static constexpr auto GetFields() { return std::make_tuple(gfs::Field(&VersionedDataV1::Id), gfs::Field(&VersionedDataV1::Name)); }
+};
+
+struct VersionedData : gfs::FieldStreamable<VersionedData, 2>
+{
+	uint32_t Id = 0;
+	std::string Name;
+	uint64_t Extra = 42;
+	DataType Nested;
+	std::vector<std::string> Tags;
 
-	void Write(gfs::WriteOnlyByteBuffer& buffer) const override
+	static constexpr auto GetFields()
 	{
-		buffer.Write(value_a);
-		buffer.Write(value_b);
-		buffer.Write(value_c);
+		return std::make_tuple(gfs::Field(&VersionedData::Id),
+			gfs::Field(&VersionedData::Name),
+			gfs::Field(&VersionedData::Extra, 2),
+			gfs::Field(&VersionedData::Nested, 2),
+			gfs::Field(&VersionedData::Tags, 2));
 	}
 };
 
@@ -77,12 +101,53 @@ struct TextFileImporter : gfs::FileImporter
 		outputFilename.replace_extension(".rbin");
 
 		const auto fileId = std::hash<std::filesystem::path>{}(importFilename);
-		fs.WriteFile(outputMount, outputFilename, fileId, {}, resource, resource.Text.size() >= 524288, importFilename);
+		fs.WriteFile(outputMount, outputFilename, fileId, {}, resource, resource.Text.size() >= 524288, importFilename, metadata);
 
 		return true;
 	}
 
-	bool Reimport(gfs::Filesystem& fs, const gfs::Filesystem::File& file) override { return false; }
+	bool Reimport(gfs::Filesystem& fs, const gfs::Filesystem::File& file) override
+	{
+		return Import(fs, file.SourceFilename, file.MountId, file.MountRelPath.parent_path(), file.MetadataStr);
+	}
+};
+
+// Imports `.dep` files. The first line is the text & each following line a source file (next to it) it depends on.
+struct DependentTextImporter : gfs::FileImporter
+{
+	std::mutex ReimportMutex;
+	std::vector<gfs::FileID> ReimportOrder; // Reimports run on worker threads.
+
+	bool Import(gfs::Filesystem& fs,
+		const std::filesystem::path& importFilename,
+		gfs::MountID outputMount,
+		const std::filesystem::path& outputDir,
+		const std::string& metadata) override
+	{
+		std::ifstream stream(importFilename);
+		TextResource resource{};
+		if (!std::getline(stream, resource.Text))
+			return false;
+
+		std::vector<gfs::FileID> dependencies;
+		for (std::string line; std::getline(stream, line);)
+			dependencies.push_back(std::hash<std::filesystem::path>{}(importFilename.parent_path() / line));
+
+		auto outputFilename = outputDir / importFilename.filename();
+		outputFilename.replace_extension(".rbin");
+
+		const auto fileId = std::hash<std::filesystem::path>{}(importFilename);
+		return fs.WriteFile(outputMount, outputFilename, fileId, dependencies, resource, false, importFilename, metadata);
+	}
+
+	bool Reimport(gfs::Filesystem& fs, const gfs::Filesystem::File& file) override
+	{
+		{
+			std::lock_guard lock(ReimportMutex);
+			ReimportOrder.push_back(file.FileId);
+		}
+		return Import(fs, file.SourceFilename, file.MountId, file.MountRelPath.parent_path(), file.MetadataStr);
+	}
 };
 
 int main()
@@ -96,7 +161,7 @@ int main()
 
 	auto mountA = fs.MountDir("mount_a", true);
 	assert(mountA != gfs::InvalidMountId);
-	auto mountB = fs.MountDir("mount_b_locked", false);
+	auto mountB = fs.MountDir("mount_b_locked", false, 0, {}); // No mount index, so mounting never writes to it.
 	assert(mountB != gfs::InvalidMountId);
 
 	std::cout << "Mounts" << std::endl;
@@ -144,6 +209,167 @@ int main()
 		assert(false);
 	assert(readTexResourceCompressed.Text == texResourceBigger.Text);
 
+	{
+		// Field serialization
+		VersionedData written{};
+		written.Id = 7;
+		written.Name = "Not a memcpy";
+		written.Extra = 1234;
+		written.Nested = DataType{ 9, 2.5f, true };
+		written.Tags = { "a", "", "tag" };
+
+		gfs::WriteOnlyByteBuffer writeBuffer(1024);
+		written.Write(writeBuffer);
+		gfs::ReadOnlyByteBuffer readBuffer(writeBuffer.GetData(), writeBuffer.GetSize());
+		VersionedData read{};
+		read.Read(readBuffer);
+		assert(readBuffer.GetPosition() == writeBuffer.GetSize());
+		assert(read.Id == 7 && read.Name == written.Name && read.Extra == 1234 && read.Tags == written.Tags);
+		assert(read.Nested.value_a == 9 && read.Nested.value_b == 2.5f && read.Nested.value_c);
+
+		// Members added in version 2 keep their defaults when reading version 1 data.
+		VersionedDataV1 oldData{};
+		oldData.Id = 3;
+		oldData.Name = "Old";
+		gfs::WriteOnlyByteBuffer oldWriteBuffer(1024);
+		oldData.Write(oldWriteBuffer);
+		gfs::ReadOnlyByteBuffer oldReadBuffer(oldWriteBuffer.GetData(), oldWriteBuffer.GetSize());
+		VersionedData upgraded{};
+		upgraded.Read(oldReadBuffer);
+		assert(oldReadBuffer.GetPosition() == oldWriteBuffer.GetSize());
+		assert(upgraded.Id == 3 && upgraded.Name == "Old" && upgraded.Extra == 42 && upgraded.Nested.value_a == 0 && upgraded.Tags.empty());
+
+		// The three DataType members are a single memcpy run after the version.
+		gfs::WriteOnlyByteBuffer dataBuffer(64);
+		data.Write(dataBuffer);
+		assert(dataBuffer.GetSize() == sizeof(uint16_t) + sizeof(uint32_t) + sizeof(float) + sizeof(bool));
+	}
+
+	{
+		// Containers
+		const std::vector<uint32_t> podValues{ 1, 2, 3, 0xFFFFFFFF };
+		const std::array<uint16_t, 5> podArray{ 5, 4, 3, 2, 1 };
+		const std::vector<uint64_t> emptyValues;
+		const std::vector<double> alignedValues{ 0.5, -1.25, 3.0 };
+		const std::vector<bool> flags{ true, false, true };
+		const std::vector<std::string> strings{ "first", "", "third" };
+		const std::array<std::string, 2> stringArray{ "x", "yz" };
+		std::vector<TextResource> resources(2);
+		resources[0].Text = "Resource 0";
+		resources[1].Text = "Resource 1";
+
+		gfs::WriteOnlyByteBuffer writeBuffer(16);
+		writeBuffer.Write(podValues);
+		writeBuffer.Write(podArray);
+		writeBuffer.Write(emptyValues);
+		writeBuffer.Write(uint8_t(0xAB)); // Unaligned, so the doubles are padded.
+		const auto alignedCountPosition = writeBuffer.GetPosition();
+		writeBuffer.WriteArray(alignedValues.data(), alignedValues.size());
+		writeBuffer.Write(flags);
+		writeBuffer.Write(strings);
+		writeBuffer.Write(stringArray);
+		writeBuffer.Write(resources);
+
+		// Count & elements, the array without a count, then an empty vector still padded to the alignment of its elements.
+		assert(alignedCountPosition == 48 + 1);
+		const auto alignedDataPosition = (alignedCountPosition + 8 + 7) & ~uint64_t(7);
+		for (auto i = alignedCountPosition + 8; i < alignedDataPosition; ++i)
+			assert(writeBuffer.GetData()[i] == 0);
+
+		gfs::ReadOnlyByteBuffer readBuffer(writeBuffer.GetData(), writeBuffer.GetSize());
+		std::vector<uint32_t> readPodValues;
+		std::array<uint16_t, 5> readPodArray{};
+		std::vector<uint64_t> readEmptyValues{ 1, 2 };
+		uint8_t unaligned = 0;
+		std::vector<bool> readFlags;
+		std::vector<std::string> readStrings;
+		std::array<std::string, 2> readStringArray;
+		std::vector<TextResource> readResources;
+		readBuffer.Read(readPodValues);
+		readBuffer.Read(readPodArray);
+		readBuffer.Read(readEmptyValues);
+		readBuffer.Read(unaligned);
+		const auto alignedView = readBuffer.ReadView<double>();
+		readBuffer.Read(readFlags);
+		readBuffer.Read(readStrings);
+		readBuffer.Read(readStringArray);
+		readBuffer.Read(readResources);
+
+		assert(readPodValues == podValues && readPodArray == podArray && readEmptyValues.empty() && unaligned == 0xAB);
+		assert(reinterpret_cast<const uint8_t*>(alignedView.Data) == writeBuffer.GetData() + alignedDataPosition);
+		assert(reinterpret_cast<uintptr_t>(alignedView.Data) % alignof(double) == 0);
+		assert(std::vector<double>(alignedView.begin(), alignedView.end()) == alignedValues);
+		assert(readFlags == flags && readStrings == strings && readStringArray == stringArray);
+		assert(readResources.size() == 2 && readResources[0].Text == "Resource 0" && readResources[1].Text == "Resource 1");
+		assert(readBuffer.GetPosition() == writeBuffer.GetSize());
+	}
+
+	{
+		// Varints
+		gfs::WriteOnlyByteBuffer writeBuffer(1024);
+		const uint64_t uints[] = { 0, 127, 128, 16383, 16384, UINT64_MAX };
+		const int64_t ints[] = { 0, -1, 1, -64, 64, INT64_MIN, INT64_MAX };
+		for (const auto value : uints)
+			writeBuffer.WriteVarUInt(value);
+		for (const auto value : ints)
+			writeBuffer.WriteVarInt(value);
+
+		// Lengths that are not a multiple of 8 leave a tail after the 8 (& 4) at a time paths.
+		std::vector<uint32_t> smallValues(21);
+		for (uint32_t i = 0; i < uint32_t(smallValues.size()); ++i)
+			smallValues[i] = i * 7 % 128;
+		std::vector<uint32_t> twoByteValues(13);
+		for (uint32_t i = 0; i < uint32_t(twoByteValues.size()); ++i)
+			twoByteValues[i] = 128 + i * 1000;
+		const std::vector<int64_t> signedValues{ 0, -1, 1, -63, 64, -8192, INT64_MIN, INT64_MAX, -3, 5, -7 };
+		const std::vector<uint64_t> mixedValues{ 1, 2, 3, 4, 5, 6, 7, 200, 9, 10, 11, 12, 13, 14, 15, 16, 17, UINT64_MAX };
+		writeBuffer.WriteVarArray(smallValues.data(), smallValues.size());
+		writeBuffer.WriteVarArray(twoByteValues.data(), twoByteValues.size());
+		writeBuffer.WriteVarArray(signedValues.data(), signedValues.size());
+		writeBuffer.WriteVarArray(mixedValues.data(), mixedValues.size());
+
+		// Sorted ids with repeated deltas (runs), small deltas (8 at a time), jumps & a decreasing tail.
+		std::vector<uint64_t> ids;
+		for (uint64_t i = 0; i < 19; ++i)
+			ids.push_back(1000 + i * 4);
+		for (uint64_t i = 0; i < 11; ++i)
+			ids.push_back(ids.back() + i % 3);
+		ids.push_back(UINT64_MAX);
+		ids.push_back(0);
+		ids.push_back(5);
+		const std::vector<int32_t> signedDeltas{ -5, -5, -5, -5, 10, 3, -100000, 7 };
+		const std::vector<uint32_t> emptyValues;
+		writeBuffer.WriteDeltaArray(ids.data(), ids.size());
+		writeBuffer.WriteDeltaArray(signedDeltas.data(), signedDeltas.size());
+		writeBuffer.WriteDeltaArray(emptyValues.data(), emptyValues.size());
+
+		gfs::ReadOnlyByteBuffer readBuffer(writeBuffer.GetData(), writeBuffer.GetSize());
+		for (const auto value : uints)
+			assert(readBuffer.ReadVarUInt() == value);
+		for (const auto value : ints)
+			assert(readBuffer.ReadVarInt() == value);
+
+		std::vector<uint32_t> readSmallValues;
+		std::vector<uint32_t> readTwoByteValues;
+		std::vector<int64_t> readSignedValues;
+		std::vector<uint64_t> readMixedValues;
+		readBuffer.ReadVarArray(readSmallValues);
+		readBuffer.ReadVarArray(readTwoByteValues);
+		readBuffer.ReadVarArray(readSignedValues);
+		readBuffer.ReadVarArray(readMixedValues);
+		assert(readSmallValues == smallValues && readTwoByteValues == twoByteValues);
+		assert(readSignedValues == signedValues && readMixedValues == mixedValues);
+
+		std::vector<uint64_t> readIds;
+		std::vector<int32_t> readSignedDeltas;
+		std::vector<uint32_t> readEmptyValues{ 1 };
+		readBuffer.ReadDeltaArray(readIds);
+		readBuffer.ReadDeltaArray(readSignedDeltas);
+		readBuffer.ReadDeltaArray(readEmptyValues);
+		assert(readIds == ids && readSignedDeltas == signedDeltas && readEmptyValues.empty());
+		assert(readBuffer.GetPosition() == writeBuffer.GetSize());
+	}
+
 	{
 		// Archive Test
 		std::vector<gfs::FileID> fileIds;
@@ -190,6 +416,587 @@ int main()
 		assert(importedFile.Text == shortText.Text);
 	}
 
+	{
+		// Import cache
+		std::filesystem::remove_all("import_cache");
+		std::filesystem::create_directories("import_cache/source");
+		std::filesystem::create_directories("import_cache/mount");
+		std::ofstream("import_cache/source/cached.txt") << "Cached v1";
+
+		gfs::Filesystem cacheFs;
+		cacheFs.SetImporter({ ".txt" }, std::make_shared<TextFileImporter>());
+		auto cacheMount = cacheFs.MountDir("import_cache/mount", false);
+		assert(cacheMount != gfs::InvalidMountId);
+
+		auto importCached = [&](const std::filesystem::path& outputDir, const std::string& metadata) {
+			gfs::ImportOptions options{};
+			options.Metadata = metadata;
+			const auto result = cacheFs.ImportDirectory("import_cache/source", cacheMount, outputDir, options);
+			assert(result.Succeeded());
+			return result.UpToDateCount == 1;
+		};
+		assert(!importCached("a", ""));
+		assert(importCached("a", "")); // Source unchanged.
+		assert(!importCached("b", "")); // Same source into another directory.
+		assert(std::filesystem::exists("import_cache/mount/b/cached.rbin"));
+		assert(importCached("b", ""));
+
+		std::ofstream("import_cache/source/cached.txt") << "Cached v2";
+		assert(!importCached("b", "")); // Content changed.
+		TextResource cachedText{};
+		if (!cacheFs.ReadFile(std::hash<std::filesystem::path>{}("import_cache/source/cached.txt"), cachedText))
+			assert(false);
+		assert(cachedText.Text == "Cached v2");
+
+		assert(!importCached("b", "quality=high")); // Metadata changed.
+		assert(importCached("b", "quality=high"));
+	}
+
+	{
+		// Directory importing
+		gfs::ImportOptions options{};
+		options.ProgressCallback = [](const gfs::ImportProgress& progress) {
+			std::cout << "Imported " << progress.CompletedCount << "/" << progress.TotalCount << " - " << progress.Filename << std::endl;
+		};
+		const auto result = fs.ImportDirectory("external_files", mountA, "", options);
+		assert(result.Succeeded());
+		assert(result.UpToDateCount == 1); // Already imported above.
+	}
+
+	{
+		// Dependencies
+		if (!fs.WriteFile(mountA, "dependent_a.rbin", 9001, { 234598753 }, data, false))
+			assert(false);
+		if (!fs.WriteFile(mountA, "dependent_b.rbin", 9002, { 9001 }, data, false))
+			assert(false);
+
+		assert(fs.GetDependents(234598753) == std::vector<gfs::FileID>{ 9001 });
+		assert(fs.GetDependents(234598753, true) == (std::vector<gfs::FileID>{ 9001, 9002 }));
+
+		if (!fs.WriteFile(mountA, "dependent_b.rbin", 9002, {}, data, false))
+			assert(false);
+		assert(fs.GetDependents(9001).empty());
+	}
+
+	{
+		// Durable write batches
+		std::filesystem::remove_all("mount_batch");
+		std::filesystem::create_directories("mount_batch");
+		gfs::Filesystem batchFs;
+		batchFs.SetDurableWrites(true);
+		auto batchMount = batchFs.MountDir("mount_batch");
+		assert(batchMount != gfs::InvalidMountId);
+
+		TextResource text{};
+		batchFs.BeginWriteBatch();
+		batchFs.BeginWriteBatch(); // Nested, so only the outer batch commits.
+		for (gfs::FileID fileId = 9301; fileId <= 9308; ++fileId)
+		{
+			text.Text = "Batched " + std::to_string(fileId);
+			if (!batchFs.WriteFile(batchMount, "batched_" + std::to_string(fileId) + ".rbin", fileId, {}, text, fileId == 9308))
+				assert(false);
+		}
+		text.Text = texResourceBigger.Text;
+		if (!batchFs.WriteFile(batchMount, "batched_big.rbin", 9309, {}, text, true))
+			assert(false);
+		if (!batchFs.EndWriteBatch())
+			assert(false);
+		assert(!batchFs.ReadFile(9301, text)); // Not visible until the outermost batch ends.
+		if (!batchFs.EndWriteBatch())
+			assert(false);
+
+		gfs::Filesystem remountedFs; // Read back from disk.
+		assert(remountedFs.MountDir("mount_batch") != gfs::InvalidMountId);
+		for (gfs::FileID fileId = 9301; fileId <= 9308; ++fileId)
+		{
+			if (!batchFs.ReadFile(fileId, text) || text.Text != "Batched " + std::to_string(fileId))
+				assert(false);
+			if (!remountedFs.ReadFile(fileId, text) || text.Text != "Batched " + std::to_string(fileId))
+				assert(false);
+		}
+		if (!remountedFs.ReadFile(9309, text))
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+
+		for (const auto& entry : std::filesystem::directory_iterator("mount_batch"))
+			assert(entry.path().extension().string().rfind(".gfs_tmp", 0) != 0);
+	}
+
+	{
+		// Mount overlays
+		assert(fs.FindFile("aa/txt_file.rbin") == 67236784);
+		assert(fs.FindFile("./aa/../aa/txt_file.rbin", mountA) == 67236784);
+
+		std::filesystem::create_directories("mount_mod/aa");
+		auto modMount = fs.MountDir("mount_mod", true, 10);
+		assert(modMount != gfs::InvalidMountId);
+
+		TextResource modText{};
+		modText.Text = "Modded!";
+		if (!fs.WriteFile(modMount, "aa/txt_file.rbin", 67236785, {}, modText, false))
+			assert(false);
+		assert(fs.FindFile("aa/txt_file.rbin") == 67236785);
+
+		if (!fs.UnmountDir(modMount))
+			assert(false);
+		assert(fs.FindFile("aa/txt_file.rbin") == 67236784);
+	}
+
+	{
+		// Mount index
+		std::filesystem::remove_all("mount_index");
+		std::filesystem::remove_all("mount_index_cache");
+		std::filesystem::create_directories("mount_index");
+		const auto indexFilename = std::filesystem::absolute("mount_index_cache/mount_index.gfs_index");
+
+		auto mountIndexed = [&](gfs::Filesystem& indexFs) {
+			const auto hits = indexFs.GetStats().MountIndexHits;
+			assert(indexFs.MountDir("mount_index", true, 0, indexFilename) != gfs::InvalidMountId);
+			return indexFs.GetStats().MountIndexHits - hits;
+		};
+
+		TextResource text{};
+		{
+			gfs::Filesystem writeFs;
+			auto writeMount = writeFs.MountDir("mount_index", true, 0, indexFilename);
+			assert(writeMount != gfs::InvalidMountId);
+			for (const auto fileId : { 9401, 9402, 9403 })
+			{
+				text.Text = "Indexed " + std::to_string(fileId);
+				if (!writeFs.WriteFile(writeMount, "indexed_" + std::to_string(fileId) + ".rbin", fileId, {}, text, false))
+					assert(false);
+			}
+		}
+		assert(std::filesystem::exists(indexFilename) && !std::filesystem::exists("mount_index/.gfs_index"));
+
+		{
+			gfs::Filesystem indexFs; // Scans the files the index does not have yet.
+			assert(mountIndexed(indexFs) == 0);
+		}
+		{
+			gfs::Filesystem indexFs; // Unchanged, so every file comes from the index.
+			assert(!gfs::StatsEnabled || mountIndexed(indexFs) == 3);
+			if (!indexFs.ReadFile(9402, text))
+				assert(false);
+			assert(text.Text == "Indexed 9402");
+		}
+
+		// Rewritten with the same size but another id. Its modification time is moved on in case the rewrite lands in the same tick.
+		const auto lastWriteTime = std::filesystem::last_write_time("mount_index/indexed_9402.rbin");
+		{
+			gfs::Filesystem rewriteFs;
+			auto rewriteMount = rewriteFs.MountDir("mount_index", true, 0, {});
+			text.Text = "Indexed 9499";
+			if (!rewriteFs.WriteFile(rewriteMount, "indexed_9402.rbin", 9499, {}, text, false))
+				assert(false);
+		}
+		std::filesystem::last_write_time("mount_index/indexed_9402.rbin", lastWriteTime + std::chrono::seconds(1));
+		// Appended to, so only its size changes.
+		const auto appendedWriteTime = std::filesystem::last_write_time("mount_index/indexed_9403.rbin");
+		std::ofstream("mount_index/indexed_9403.rbin", std::ios::binary | std::ios::app) << "Trailing data";
+		std::filesystem::last_write_time("mount_index/indexed_9403.rbin", appendedWriteTime);
+		{
+			gfs::Filesystem indexFs;
+			assert(!gfs::StatsEnabled || mountIndexed(indexFs) == 1);
+			assert(!indexFs.GetFile(9402) && indexFs.FindFile("indexed_9402.rbin") == 9499);
+			if (!indexFs.ReadFile(9499, text) || text.Text != "Indexed 9499" || !indexFs.ReadFile(9403, text) || text.Text != "Indexed 9403")
+				assert(false);
+		}
+		{
+			gfs::Filesystem indexFs; // The rescan updated the index.
+			assert(!gfs::StatsEnabled || mountIndexed(indexFs) == 3);
+			assert(indexFs.FindFile("indexed_9402.rbin") == 9499);
+		}
+		assert(!std::filesystem::exists("mount_b_locked/.gfs_index"));
+	}
+
+	{
+		// Lazy file metadata
+		gfs::Filesystem lazyFs;
+		lazyFs.SetLazyFileMetadata(true);
+		auto lazyMount = lazyFs.MountDir("mount_a");
+		assert(lazyMount != gfs::InvalidMountId);
+
+		assert(lazyFs.GetFileSourceFilename(5319311783236469214) == "external_files/txt_file.txt");
+
+		TextResource importedFile{};
+		if (!lazyFs.ReadFile(5319311783236469214, importedFile))
+			assert(false);
+		assert(importedFile.Text == shortText.Text);
+	}
+
+	{
+		// Uncached reads
+		TextResource text{};
+		if (!fs.ReadFile(8367428478, text, gfs::ReadMode::Uncached))
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+		if (!fs.ReadFile(2222, text, gfs::ReadMode::Uncached)) // Data in the middle of a block.
+			assert(false);
+		assert(text.Text == "I am file 2222!");
+
+		fs.SetUncachedReadThreshold(gfs::FS_COMPRESS_MIN_FILE_SIZE_BYTES);
+		if (!fs.ReadFile(68923789324, text))
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+		fs.SetUncachedReadThreshold(0);
+	}
+
+	{
+		// In-memory mounts
+		gfs::Filesystem memoryFs;
+		memoryFs.SetLazyFileMetadata(true);
+		auto memoryMount = memoryFs.MountMemory();
+		assert(memoryMount != gfs::InvalidMountId);
+		const auto memoryMountCopy = memoryFs.GetMount(memoryMount);
+		assert(memoryMountCopy && memoryMountCopy->IsInMemory());
+		assert(!memoryFs.GetMount(memoryMount + 1000));
+
+		// Loaded from an archive on disk.
+		if (!memoryFs.LoadIntoMemory(memoryMount, "mount_a/archive.rpak", "archive.rpak"))
+			assert(false);
+		for (const auto fileId : { 1111, 2222, 3333, 4444 })
+		{
+			TextResource text{};
+			if (!memoryFs.ReadFile(fileId, text))
+				assert(false);
+			assert(text.Text == "I am file " + std::to_string(fileId) + "!");
+		}
+
+		// Written directly.
+		if (!memoryFs.WriteFile(memoryMount, "aa/compressed.rbin", 9101, { 1111 }, texResourceBigger, true))
+			assert(false);
+		TextResource text{};
+		if (!memoryFs.ReadFile(9101, text))
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+		assert(memoryFs.FindFile("aa/compressed.rbin") == 9101);
+		assert(memoryFs.GetFileDependencies(9101) == std::vector<gfs::FileID>{ 1111 }); // Record read back from memory.
+
+		// Gathered from a directory mount.
+		auto diskMount = memoryFs.MountDir("mount_b_locked", false, 0, {});
+		assert(diskMount != gfs::InvalidMountId);
+		if (!memoryFs.CreateArchive(memoryMount, "hot.rpak", { 68923789324 }))
+			assert(false);
+		assert(!std::filesystem::exists("hot.rpak") && !std::filesystem::exists("mount_b_locked/hot.rpak"));
+		if (!memoryFs.ReadFile(68923789324, text))
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+
+		if (!memoryFs.UnmountDir(memoryMount))
+			assert(false);
+		assert(!memoryFs.ReadFile(1111, text));
+	}
+
+	{
+		// Allocators
+		gfs::TrackingAllocator tracking;
+		{
+			gfs::Filesystem trackedFs(&tracking);
+			auto trackedMount = trackedFs.MountDir("mount_b_locked", false, 0, {});
+			assert(trackedMount != gfs::InvalidMountId);
+
+			TextResource text{};
+			if (!trackedFs.ReadFile(8367428478, text))
+				assert(false);
+			assert(text.Text == texResourceBigger.Text);
+			assert(tracking.GetUsage(gfs::MemoryCategory::FileData).PeakBytes >= text.Text.size());
+			assert(tracking.GetUsage(gfs::MemoryCategory::Compression).PeakBytes != 0);
+			assert(tracking.GetUsage(gfs::MemoryCategory::FileData).CurrentBytes == 0);
+			assert(tracking.GetUsage(gfs::MemoryCategory::Registry).CurrentBytes != 0);
+		}
+		assert(tracking.GetTotalUsage().CurrentBytes == 0);
+
+		// Reads that do not fit in the arena fail rather than exceed it.
+		gfs::ArenaAllocator arena(64 * 1024);
+		gfs::Filesystem arenaFs(&arena);
+		arenaFs.MountDir("mount_b_locked", false, 0, {});
+		TextResource text{};
+		assert(!arenaFs.ReadFile(8367428478, text));
+	}
+
+	{
+		// Archive patches
+		auto createVersion = [&](const std::filesystem::path& dir, const std::vector<gfs::FileID>& fileIds, const std::string& bigText) {
+			std::filesystem::remove_all(dir);
+			std::filesystem::create_directories(dir);
+			gfs::Filesystem versionFs;
+			auto versionMount = versionFs.MountDir(dir);
+			assert(versionMount != gfs::InvalidMountId);
+
+			TextResource text{};
+			for (const auto fileId : fileIds)
+			{
+				text.Text = "I am file " + std::to_string(fileId) + "!";
+				if (!versionFs.WriteFile(versionMount, "file_" + std::to_string(fileId) + ".rbin", fileId, {}, text, false))
+					assert(false);
+			}
+			text.Text = bigText;
+			if (!versionFs.WriteFile(versionMount, "big.rbin", 7777, {}, text, false))
+				assert(false);
+
+			auto archiveFiles = fileIds;
+			archiveFiles.push_back(7777);
+			if (!versionFs.CreateArchive(versionMount, "patched.rpak", archiveFiles))
+				assert(false);
+		};
+
+		auto bigText = texResourceBigger.Text;
+		createVersion("mount_patch_v1", { 1111, 2222, 3333 }, bigText);
+		bigText.replace(bigText.size() / 2, 5, "Patch");
+		createVersion("mount_patch_v2", { 1111, 3333, 5555 }, bigText);
+
+		gfs::ArchivePatchInfo info{};
+		if (!gfs::CreateArchivePatch("mount_patch_v1/patched.rpak", "mount_patch_v2/patched.rpak", "patched.gfspatch", &info))
+			assert(false);
+		assert(info.UnchangedEntries == 2 && info.ChangedEntries == 1 && info.AddedEntries == 1 && info.RemovedEntries == 1);
+		assert(info.PatchSize < info.NewSize / 10);
+
+		const auto expected = ReadTextFile("mount_patch_v2/patched.rpak");
+		{
+			std::ifstream patch("patched.gfspatch", std::ios::binary);
+			if (!gfs::ApplyArchivePatch("mount_patch_v1/patched.rpak", patch, "patched_copy.rpak"))
+				assert(false);
+			assert(ReadTextFile("patched_copy.rpak") == expected);
+		}
+		{
+			std::filesystem::copy_file("mount_patch_v1/patched.rpak", "patched_in_place.rpak", std::filesystem::copy_options::overwrite_existing);
+			std::ifstream patch("patched.gfspatch", std::ios::binary);
+			if (!gfs::ApplyArchivePatchInPlace("patched_in_place.rpak", patch))
+				assert(false);
+			assert(ReadTextFile("patched_in_place.rpak") == expected);
+		}
+		{
+			// Not the version the patch was created from.
+			std::ifstream patch("patched.gfspatch", std::ios::binary);
+			assert(!gfs::ApplyArchivePatchInPlace("patched_in_place.rpak", patch));
+			assert(ReadTextFile("patched_in_place.rpak") == expected);
+		}
+
+		std::filesystem::remove_all("mount_patch_result");
+		std::filesystem::create_directories("mount_patch_result");
+		std::filesystem::copy_file("patched_copy.rpak", "mount_patch_result/patched.rpak");
+		gfs::Filesystem patchedFs;
+		auto patchedMount = patchedFs.MountDir("mount_patch_result");
+		assert(patchedMount != gfs::InvalidMountId);
+		TextResource text{};
+		if (!patchedFs.ReadFile(7777, text))
+			assert(false);
+		assert(text.Text == bigText);
+	}
+
+	{
+		// Shared cache
+		gfs::Filesystem::RemoveSharedCache("gfs_testbed_cache");
+		gfs::Filesystem otherFs; // As another process on the machine would.
+		auto otherMount = otherFs.MountDir("mount_b_locked", false, 0, {});
+		assert(otherMount != gfs::InvalidMountId);
+		if (!fs.EnableSharedCache("gfs_testbed_cache", 16 * 1024 * 1024) || !otherFs.EnableSharedCache("gfs_testbed_cache", 1))
+			assert(false);
+
+		TextResource text{};
+		if (!fs.ReadFile(8367428478, text)) // Decompressed into the cache.
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+		const auto hits = otherFs.GetStats().SharedCacheHits;
+		if (!otherFs.ReadFile(8367428478, text))
+			assert(false);
+		assert(text.Text == texResourceBigger.Text);
+		assert(!gfs::StatsEnabled || otherFs.GetStats().SharedCacheHits == hits + 1);
+
+		// Rewritten files are a new version.
+		text.Text = "Shared v1";
+		if (!fs.WriteFile(mountB, "shared.rbin", 9201, {}, text, false) || !fs.ReadFile(9201, text))
+			assert(false);
+		text.Text = "Shared v2";
+		if (!fs.WriteFile(mountB, "shared.rbin", 9201, {}, text, false))
+			assert(false);
+		text.Text.clear();
+		if (!fs.ReadFile(9201, text))
+			assert(false);
+		assert(text.Text == "Shared v2");
+
+		fs.DisableSharedCache();
+		otherFs.DisableSharedCache();
+		assert(gfs::Filesystem::RemoveSharedCache("gfs_testbed_cache"));
+	}
+
+	{
+		// Hot reloading
+		std::filesystem::remove_all("hot_reload");
+		std::filesystem::create_directories("hot_reload/source");
+		std::filesystem::create_directories("hot_reload/mount");
+		std::ofstream("hot_reload/source/watched.txt") << "Watched v1";
+
+		gfs::Filesystem hotFs;
+		hotFs.SetImporter({ ".txt" }, std::make_shared<TextFileImporter>());
+		auto hotMount = hotFs.MountDir("hot_reload/mount", true, 0, {});
+		assert(hotMount != gfs::InvalidMountId);
+		if (!hotFs.Import("hot_reload/source/watched.txt", hotMount, ""))
+			assert(false);
+		const auto watchedId = std::hash<std::filesystem::path>{}("hot_reload/source/watched.txt");
+
+		std::vector<gfs::FileID> reimported;
+		hotFs.SetFileReimportCallback([&](gfs::FileID fileId) { reimported.push_back(fileId); });
+
+		// Ticks like a frame loop until `count` files have been reimported. Events arrive from the watcher thread.
+		auto tickUntil = [&](size_t count, std::chrono::microseconds timeBudget = std::chrono::microseconds::max()) {
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (reimported.size() < count && std::chrono::steady_clock::now() < deadline)
+			{
+				hotFs.Tick(timeBudget);
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+			return reimported.size() >= count;
+		};
+
+		// A save in a watched directory reaches the hot reload queue & is reimported.
+		std::ofstream("hot_reload/source/watched.txt") << "Watched v2";
+		assert(tickUntil(1) && reimported == std::vector<gfs::FileID>{ watchedId });
+		TextResource text{};
+		if (!hotFs.ReadFile(watchedId, text))
+			assert(false);
+		assert(text.Text == "Watched v2");
+
+		// Saves during the quiet period restart it & are coalesced into a single reimport after the last one.
+		hotFs.SetImportCacheEnabled(false); // Every reimport then calls back, so repeated reimports would show.
+		hotFs.SetHotReloadDebounce(std::chrono::milliseconds(300));
+		reimported.clear();
+		auto lastSaveTime = std::chrono::steady_clock::now();
+		for (auto i = 3; i <= 5; ++i)
+		{
+			std::ofstream("hot_reload/source/watched.txt") << "Watched v" << i;
+			lastSaveTime = std::chrono::steady_clock::now();
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			hotFs.Tick();
+		}
+		assert(reimported.empty());
+		assert(tickUntil(1));
+		assert(std::chrono::steady_clock::now() - lastSaveTime >= std::chrono::milliseconds(300));
+		std::this_thread::sleep_for(std::chrono::milliseconds(400));
+		hotFs.Tick();
+		assert(reimported.size() == 1);
+		if (!hotFs.ReadFile(watchedId, text))
+			assert(false);
+		assert(text.Text == "Watched v5");
+
+		// Callbacks that do not fit in the time budget are carried over to the next tick.
+		hotFs.SetHotReloadDebounce(std::chrono::milliseconds(0));
+		std::vector<std::string> budgetSources;
+		for (auto i = 0; i < 4; ++i)
+		{
+			budgetSources.push_back("hot_reload/source/budget_" + std::to_string(i) + ".txt");
+			std::ofstream(budgetSources.back()) << "Budget v1";
+			if (!hotFs.Import(budgetSources.back(), hotMount, ""))
+				assert(false);
+		}
+		reimported.clear();
+		for (const auto& source : budgetSources)
+			std::ofstream(source) << "Budget v2";
+		std::this_thread::sleep_for(std::chrono::milliseconds(300)); // Every save is seen, so one batch holds them all.
+		hotFs.Tick(std::chrono::microseconds(0));
+		assert(reimported.size() <= 1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(300)); // Every reimport has finished.
+		const auto deliveredCount = reimported.size();
+		hotFs.Tick(std::chrono::microseconds(0));
+		assert(reimported.size() == deliveredCount + 1); // At least one callback per tick, but no more over budget.
+		hotFs.Tick();
+		assert(reimported.size() == budgetSources.size());
+
+		// Dependents are reimported after the files they depend on, even when saved first.
+		auto dependentImporter = std::make_shared<DependentTextImporter>();
+		hotFs.SetImporter({ ".dep" }, dependentImporter);
+		auto writeDependentSource = [&](const std::string& name, const std::string& text, const std::vector<std::string>& dependencies) {
+			std::ofstream stream("hot_reload/source/" + name);
+			stream << text;
+			for (const auto& dependency : dependencies)
+				stream << "\n" << dependency;
+		};
+		auto importDependentSource = [&](const std::string& name) {
+			if (!hotFs.Import("hot_reload/source/" + name, hotMount, ""))
+				assert(false);
+			return std::hash<std::filesystem::path>{}("hot_reload/source/" + name);
+		};
+		auto saveAndReimport = [&](const std::vector<std::pair<std::string, std::vector<std::string>>>& sources) {
+			reimported.clear();
+			dependentImporter->ReimportOrder.clear();
+			for (const auto& [name, dependencies] : sources)
+				writeDependentSource(name, name + " v2", dependencies);
+			// Not ticked until every save is past the quiet period, so they are all reimported in one batch.
+			std::this_thread::sleep_for(std::chrono::milliseconds(400));
+			return tickUntil(sources.size());
+		};
+		hotFs.SetHotReloadDebounce(std::chrono::milliseconds(200));
+
+		writeDependentSource("chain_a.dep", "A", {});
+		writeDependentSource("chain_b.dep", "B", { "chain_a.dep" });
+		writeDependentSource("chain_c.dep", "C", { "chain_b.dep" });
+		const auto chainA = importDependentSource("chain_a.dep");
+		const auto chainB = importDependentSource("chain_b.dep");
+		const auto chainC = importDependentSource("chain_c.dep");
+		assert(hotFs.GetDependents(chainA, true) == (std::vector<gfs::FileID>{ chainB, chainC }));
+
+		assert(saveAndReimport({ { "chain_c.dep", { "chain_b.dep" } }, { "chain_b.dep", { "chain_a.dep" } }, { "chain_a.dep", {} } }));
+		assert(dependentImporter->ReimportOrder == (std::vector<gfs::FileID>{ chainA, chainB, chainC }));
+		assert(reimported == (std::vector<gfs::FileID>{ chainA, chainB, chainC }));
+		if (!hotFs.ReadFile(chainC, text))
+			assert(false);
+		assert(text.Text == "chain_c.dep v2");
+
+		// A dependency cycle cannot be ordered, but the batch still completes & the next one starts.
+		writeDependentSource("cycle_x.dep", "X", { "cycle_y.dep" });
+		writeDependentSource("cycle_y.dep", "Y", { "cycle_x.dep" });
+		const auto cycleX = importDependentSource("cycle_x.dep");
+		const auto cycleY = importDependentSource("cycle_y.dep");
+		assert(saveAndReimport({ { "cycle_x.dep", { "cycle_y.dep" } }, { "cycle_y.dep", { "cycle_x.dep" } } }));
+		assert(reimported.size() == 2 && std::count(reimported.begin(), reimported.end(), cycleX) == 1
+			   && std::count(reimported.begin(), reimported.end(), cycleY) == 1);
+
+		assert(saveAndReimport({ { "chain_a.dep", {} } }));
+		assert(reimported == std::vector<gfs::FileID>{ chainA });
+	}
+
+	{
+		// Access traces
+		if (!fs.StartAccessTrace("access.gfstrace"))
+			assert(false);
+		assert(!fs.StartAccessTrace("access.gfstrace")); // Already recording.
+
+		TextResource text{};
+		if (!fs.ReadFile(5319311783236469214, text))
+			assert(false);
+		assert(!fs.ReadFile(1, text));
+		if (!fs.WriteFile(mountA, "traced.rbin", 9003, {}, data, false))
+			assert(false);
+		if (!fs.StopAccessTrace())
+			assert(false);
+
+		std::vector<gfs::AccessTraceEvent> events;
+		if (!gfs::ReadAccessTrace("access.gfstrace", events))
+			assert(false);
+		assert(events.size() == 3);
+		assert(events[0].Type == gfs::AccessType::Read && events[0].FileId == 5319311783236469214 && events[0].Succeeded);
+		assert(events[1].FileId == 1 && !events[1].Succeeded);
+		assert(events[2].Type == gfs::AccessType::Write && events[2].FileId == 9003 && events[2].Size != 0);
+	}
+
+	{
+		// Statistics
+		const auto stats = fs.GetStats();
+		if constexpr (gfs::StatsEnabled)
+		{
+			assert(stats.FilesRead != 0 && stats.BytesRead != 0);
+			assert(stats.FilesWritten != 0 && stats.BytesWritten != 0);
+			assert(stats.ReadFileLatency.Count >= stats.FilesRead); // Failed reads are timed too.
+			assert(stats.ImportCacheHits != 0);
+		}
+		std::cout << "Read " << stats.FilesRead << " files (" << stats.BytesRead << " bytes), p99 " << stats.ReadFileLatency.GetPercentileNs(99.0)
+				  << "ns. Wrote " << stats.FilesWritten << " files (" << stats.BytesWritten << " bytes)" << std::endl;
+
+		fs.ResetStats();
+		assert(fs.GetStats().FilesRead == 0);
+	}
+
 	std::cout << "Files" << std::endl;
 	fs.ForEachFile([](const gfs::Filesystem::File& file) { std::cout << "- " << file.FileId << " - " << file.MountRelPath << std::endl; });
 
@@ -0,0 +1,385 @@
+#include <gfs/gfs.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Packs a source tree into archives using the runtime import & archive code paths. Files are imported in parallel into an
+// intermediate directory (the import cache skips unchanged sources) & then combined into the archives listed in the
+// manifest, again in parallel. Archives whose contents would not change are not rewritten.
+//
+// Manifest format, one directive per line ('#' starts a comment):
+//   ext <.extension> [compress]      Pack files with this extension, optionally LZ4 compressed.
+//   archive <archive path> <prefix>  Files whose source tree relative path starts with <prefix> ("*" for any) go into the
+//                                    archive. The first matching archive wins. Files matching none stay unpacked.
+
+namespace
+{
+	struct Options
+	{
+		std::filesystem::path SourceDir;
+		std::filesystem::path ManifestFilename;
+		std::filesystem::path OutputDir;
+		std::filesystem::path IntermediateDir;
+		bool Force = false;
+	};
+
+	struct ExtensionOptions
+	{
+		bool Compress = false;
+	};
+
+	struct ArchiveRule
+	{
+		std::filesystem::path Filename; // Relative to the output directory.
+		std::string Prefix;				// Generic format. Empty matches every file.
+	};
+
+	struct Manifest
+	{
+		std::map<std::string, ExtensionOptions> Extensions;
+		std::vector<ArchiveRule> Archives;
+	};
+
+	// Stable across runs & platforms (unlike std::hash), as ids end up in the archives.
+	auto HashPath(const std::string& path) -> gfs::FileID
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (const auto c : path)
+		{
+			hash ^= uint8_t(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash != gfs::InvalidFileId ? hash : 1;
+	}
+
+	struct RawData : gfs::BinaryStreamable
+	{
+		std::string Bytes;
+
+		void Read(gfs::ReadOnlyByteBuffer& buffer) override
+		{
+			Bytes.resize(size_t(buffer.GetSize()));
+			buffer.Read(buffer.GetSize(), reinterpret_cast<uint8_t*>(Bytes.data()));
+		}
+
+		void Write(gfs::WriteOnlyByteBuffer& buffer) const override { buffer.Write(Bytes.size(), reinterpret_cast<const uint8_t*>(Bytes.data())); }
+	};
+
+	// Stores source files as is. The file id is derived from the source tree relative path.
+	class RawFileImporter : public gfs::FileImporter
+	{
+	public:
+		RawFileImporter(std::filesystem::path sourceDir, const Manifest& manifest) : m_sourceDir(std::move(sourceDir)), m_manifest(manifest) {}
+
+		bool Import(gfs::Filesystem& fs,
+			const std::filesystem::path& importFilename,
+			gfs::MountID outputMount,
+			const std::filesystem::path& outputDir,
+			const std::string& metadata) override
+		{
+			const auto relPath = importFilename.lexically_relative(m_sourceDir).generic_string();
+			return Write(fs, importFilename, outputMount, outputDir / importFilename.filename(), HashPath(relPath), metadata);
+		}
+
+		bool Reimport(gfs::Filesystem& fs, const gfs::Filesystem::File& file) override
+		{
+			return Write(fs, file.SourceFilename, file.MountId, file.MountRelPath, file.FileId, file.MetadataStr);
+		}
+
+	private:
+		bool Write(gfs::Filesystem& fs,
+			const std::filesystem::path& sourceFilename,
+			gfs::MountID outputMount,
+			const std::filesystem::path& outputFilename,
+			gfs::FileID fileId,
+			const std::string& metadata)
+		{
+			std::ifstream stream(sourceFilename, std::ios::binary);
+			if (!stream)
+				return false;
+
+			RawData data{};
+			std::ostringstream contents;
+			contents << stream.rdbuf();
+			data.Bytes = contents.str();
+
+			const auto it = m_manifest.Extensions.find(sourceFilename.extension().string());
+			const bool compress = it != m_manifest.Extensions.end() && it->second.Compress;
+			return fs.WriteFile(outputMount, outputFilename, fileId, {}, data, compress, sourceFilename, metadata);
+		}
+
+	private:
+		std::filesystem::path m_sourceDir;
+		const Manifest& m_manifest;
+	};
+
+	using ArchiveContents = std::set<std::tuple<gfs::FileID, uint64_t, uint64_t>>; // Id, source hash & metadata hash.
+
+	struct ArchiveJob
+	{
+		const ArchiveRule* Rule;
+		std::vector<gfs::FileID> Files;
+		ArchiveContents Contents;
+		uint64_t UncompressedBytes = 0;
+		uint64_t StoredBytes = 0;
+		bool UpToDate = false;
+		bool Succeeded = false;
+		double Seconds = 0.0;
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: gfs_pack <source dir> <manifest> <output dir> [--intermediate <dir>] [--force]\n"
+				  << "  --intermediate  Where imported files are kept between runs. Defaults to <output dir>_intermediate.\n"
+				  << "  --force         Reimport every file & rewrite every archive." << std::endl;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		std::vector<std::string> positional;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--force")
+				options.Force = true;
+			else if (arg == "--intermediate" && i + 1 < argc)
+				options.IntermediateDir = argv[++i];
+			else if (arg.rfind("--", 0) == 0)
+				return false;
+			else
+				positional.push_back(arg);
+		}
+		if (positional.size() != 3)
+			return false;
+
+		options.SourceDir = std::filesystem::absolute(positional[0]).lexically_normal(); // Recorded as the source filenames.
+		options.ManifestFilename = positional[1];
+		options.OutputDir = std::filesystem::path(positional[2]).lexically_normal();
+		if (!options.OutputDir.has_filename())
+			options.OutputDir = options.OutputDir.parent_path();
+		if (options.IntermediateDir.empty())
+			options.IntermediateDir = options.OutputDir.string() + "_intermediate";
+		return true;
+	}
+
+	bool ReadManifest(const std::filesystem::path& filename, Manifest& outManifest)
+	{
+		std::ifstream stream(filename);
+		if (!stream)
+		{
+			std::cerr << "Failed to open manifest " << filename << std::endl;
+			return false;
+		}
+
+		std::string line;
+		for (uint32_t lineNumber = 1; std::getline(stream, line); ++lineNumber)
+		{
+			line = line.substr(0, line.find('#'));
+			std::istringstream words(line);
+			std::string directive;
+			if (!(words >> directive))
+				continue;
+
+			if (directive == "ext")
+			{
+				std::string ext;
+				std::string option;
+				words >> ext;
+				auto& extOptions = outManifest.Extensions[ext];
+				while (words >> option)
+					extOptions.Compress |= option == "compress";
+				if (!ext.empty() && ext[0] == '.')
+					continue;
+			}
+			else if (directive == "archive")
+			{
+				ArchiveRule rule{};
+				std::string archiveFilename;
+				if (words >> archiveFilename >> rule.Prefix)
+				{
+					rule.Filename = archiveFilename;
+					if (rule.Prefix == "*")
+						rule.Prefix.clear();
+					outManifest.Archives.push_back(std::move(rule));
+					continue;
+				}
+			}
+
+			std::cerr << filename.string() << ":" << lineNumber << ": Invalid directive \"" << line << "\"" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// Metadata recorded with every imported file, so changing any option reimports (& repacks) everything.
+	auto GetImportMetadata(const Manifest& manifest) -> std::string
+	{
+		std::string metadata;
+		for (const auto& [ext, options] : manifest.Extensions)
+			metadata += ext + (options.Compress ? ":compress;" : ";");
+		return metadata;
+	}
+
+	auto FormatMB(uint64_t bytes) -> std::string
+	{
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.2fMB", double(bytes) / (1024.0 * 1024.0));
+		return buffer;
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	using clock = std::chrono::steady_clock;
+
+	Options options{};
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	Manifest manifest{};
+	if (!ReadManifest(options.ManifestFilename, manifest))
+		return 1;
+
+	std::error_code error;
+	std::filesystem::create_directories(options.OutputDir, error);
+	std::filesystem::create_directories(options.IntermediateDir, error);
+
+	const auto startTime = clock::now();
+
+	// The output is mounted first so the intermediate files mounted after it take precedence over their archived copies.
+	gfs::Filesystem fs;
+	const auto outputMount = fs.MountDir(options.OutputDir);
+	if (outputMount == gfs::InvalidMountId)
+	{
+		std::cerr << "Failed to mount " << options.OutputDir << std::endl;
+		return 1;
+	}
+
+	std::map<std::string, ArchiveContents> existingArchives;
+	fs.ForEachFile([&](const gfs::Filesystem::File& file) {
+		existingArchives[file.MountRelPath.generic_string()].insert({ file.FileId, file.SourceHash, file.MetadataHash });
+	});
+
+	const auto intermediateMount = fs.MountDir(options.IntermediateDir);
+	if (intermediateMount == gfs::InvalidMountId)
+	{
+		std::cerr << "Failed to mount " << options.IntermediateDir << std::endl;
+		return 1;
+	}
+
+	// Import
+	std::vector<std::string> extensions;
+	for (const auto& [ext, extOptions] : manifest.Extensions)
+		extensions.push_back(ext);
+	fs.SetImporter(extensions, std::make_shared<RawFileImporter>(options.SourceDir, manifest));
+	fs.SetImportCacheEnabled(!options.Force);
+
+	gfs::ImportOptions importOptions{};
+	importOptions.Metadata = GetImportMetadata(manifest);
+	const auto importResult = fs.ImportDirectory(options.SourceDir, intermediateMount, "", importOptions);
+	const auto importSeconds = std::chrono::duration<double>(clock::now() - startTime).count();
+
+	for (const auto& importError : importResult.Errors)
+		std::cerr << importError.Filename.string() << ": " << importError.Message << std::endl;
+	std::cout << "Imported " << importResult.ImportedCount << " files, " << importResult.UpToDateCount << " up to date, " << importResult.FailedCount
+			  << " failed in " << importSeconds << "s" << std::endl;
+
+	// Assign imported files to archives
+	std::vector<ArchiveJob> archiveJobs(manifest.Archives.size());
+	for (size_t i = 0; i < manifest.Archives.size(); ++i)
+		archiveJobs[i].Rule = &manifest.Archives[i];
+
+	uint32_t unpackedCount = 0;
+	fs.ForEachFile([&](const gfs::Filesystem::File& file) {
+		if (file.MountId != intermediateMount || file.SourceFilename.empty() || !std::filesystem::exists(file.SourceFilename))
+			return; // Left behind by a source file that has since been removed.
+
+		const auto relPath = file.SourceFilename.lexically_relative(options.SourceDir).generic_string();
+		const auto it = std::find_if(archiveJobs.begin(), archiveJobs.end(), [&](const ArchiveJob& job) { return relPath.rfind(job.Rule->Prefix, 0) == 0; });
+		if (it == archiveJobs.end())
+		{
+			++unpackedCount;
+			return;
+		}
+
+		it->Files.push_back(file.FileId);
+		it->Contents.insert({ file.FileId, file.SourceHash, file.MetadataHash });
+		it->UncompressedBytes += file.UncompressedSize;
+		it->StoredBytes += file.CompressedSize;
+	});
+
+	// Build archives on all cores
+	const auto archiveStartTime = clock::now();
+	std::atomic<size_t> nextJob = 0;
+	std::vector<std::thread> workers(std::max(1u, std::min(std::thread::hardware_concurrency(), uint32_t(archiveJobs.size()))));
+	for (auto& worker : workers)
+	{
+		worker = std::thread([&]() {
+			for (size_t i = nextJob++; i < archiveJobs.size(); i = nextJob++)
+			{
+				auto& job = archiveJobs[i];
+				const auto existing = existingArchives.find(job.Rule->Filename.generic_string());
+				job.UpToDate = !options.Force && existing != existingArchives.end() && existing->second == job.Contents;
+				if (job.UpToDate)
+				{
+					job.Succeeded = true;
+					continue;
+				}
+
+				std::sort(job.Files.begin(), job.Files.end()); // Deterministic archive layout.
+				const auto jobStartTime = clock::now();
+				if (!job.Rule->Filename.parent_path().empty())
+				{
+					std::error_code dirError;
+					std::filesystem::create_directories(options.OutputDir / job.Rule->Filename.parent_path(), dirError);
+				}
+				job.Succeeded = fs.CreateArchive(outputMount, job.Rule->Filename, job.Files);
+				job.Seconds = std::chrono::duration<double>(clock::now() - jobStartTime).count();
+			}
+		});
+	}
+	for (auto& worker : workers)
+		worker.join();
+	const auto archiveSeconds = std::chrono::duration<double>(clock::now() - archiveStartTime).count();
+
+	bool succeeded = importResult.Succeeded();
+	for (const auto& job : archiveJobs)
+	{
+		std::cout << job.Rule->Filename.generic_string() << ": " << job.Files.size() << " files, " << FormatMB(job.UncompressedBytes) << " -> "
+				  << FormatMB(job.StoredBytes);
+		if (job.UncompressedBytes != 0)
+			std::cout << " (" << uint32_t(100.0 * double(job.StoredBytes) / double(job.UncompressedBytes) + 0.5) << "%)";
+
+		if (!job.Succeeded)
+			std::cout << ", FAILED";
+		else if (job.UpToDate)
+			std::cout << ", up to date";
+		else
+			std::cout << ", written in " << job.Seconds << "s";
+		std::cout << std::endl;
+
+		succeeded &= job.Succeeded;
+	}
+
+	const auto stats = fs.GetStats();
+	std::cout << unpackedCount << " files not in any archive. Archives built in " << archiveSeconds << "s" << std::endl;
+	std::cout << "Compressed " << stats.CompressTime.Count << " files (p50 " << stats.CompressTime.GetPercentileNs(50.0) / 1000 << "us, p99 "
+			  << stats.CompressTime.GetPercentileNs(99.0) / 1000 << "us). Read " << FormatMB(stats.BytesRead) << ", wrote " << FormatMB(stats.BytesWritten)
+			  << ". Total " << std::chrono::duration<double>(clock::now() - startTime).count() << "s" << std::endl;
+
+	return succeeded ? 0 : 1;
+}
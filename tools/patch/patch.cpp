@@ -0,0 +1,74 @@
+#include <gfs/gfs.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Creates & applies archive patches (See gfs/archive_patch.hpp).
+//   create <old archive> <new archive> <patch>  Writes a patch turning the old archive into the new one.
+//   apply <archive> <patch> [<output>]          Applies a patch, in place unless an output is given. A patch of "-" is read
+//                                               from stdin, so patches can be applied while they are downloaded.
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::cout << "Usage: gfs_patch create <old archive> <new archive> <patch>\n"
+				  << "       gfs_patch apply <archive> <patch|-> [<output>]\n"
+				  << "  Without an output the archive is patched in place." << std::endl;
+	}
+
+	int Create(const std::filesystem::path& oldArchive, const std::filesystem::path& newArchive, const std::filesystem::path& patchFilename)
+	{
+		gfs::ArchivePatchInfo info{};
+		if (!gfs::CreateArchivePatch(oldArchive, newArchive, patchFilename, &info))
+		{
+			std::cerr << "Failed to create patch " << patchFilename << std::endl;
+			return 1;
+		}
+
+		std::cout << "Entries: " << info.UnchangedEntries << " unchanged, " << info.ChangedEntries << " changed, " << info.AddedEntries
+				  << " added, " << info.RemovedEntries << " removed\n"
+				  << "Copied " << info.CopiedBytes << " bytes, added " << info.AddedBytes << " bytes\n"
+				  << "Patch " << info.PatchSize << " bytes (new archive " << info.NewSize << " bytes)" << std::endl;
+		return 0;
+	}
+
+	int Apply(const std::filesystem::path& archive, const std::string& patchFilename, const std::filesystem::path& outputArchive)
+	{
+		std::ifstream patchFile;
+		if (patchFilename != "-")
+		{
+			patchFile.open(patchFilename, std::ios::binary);
+			if (!patchFile)
+			{
+				std::cerr << "Failed to open patch " << patchFilename << std::endl;
+				return 1;
+			}
+		}
+		auto& patch = patchFilename != "-" ? static_cast<std::istream&>(patchFile) : std::cin;
+
+		const bool succeeded = outputArchive.empty() ? gfs::ApplyArchivePatchInPlace(archive, patch) : gfs::ApplyArchivePatch(archive, patch, outputArchive);
+		if (!succeeded)
+		{
+			std::cerr << "Failed to apply patch to " << archive << std::endl;
+			return 1;
+		}
+
+		std::cout << "Patched " << (outputArchive.empty() ? archive : outputArchive) << std::endl;
+		return 0;
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const std::string command = argc > 1 ? argv[1] : "";
+	if (command == "create" && argc == 5)
+		return Create(argv[2], argv[3], argv[4]);
+	if (command == "apply" && (argc == 4 || argc == 5))
+		return Apply(argv[2], argv[3], argc == 5 ? argv[4] : "");
+
+	PrintUsage();
+	return 1;
+}
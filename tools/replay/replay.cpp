@@ -0,0 +1,284 @@
+#include <gfs/gfs.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Replays a trace recorded with `Filesystem::StartAccessTrace()` against a mounted directory. Each recorded thread is replayed
+// on its own thread, either at the recorded pace or as fast as possible, & the recorded & replayed latencies are reported.
+
+namespace
+{
+	struct Options
+	{
+		std::filesystem::path TraceFilename;
+		std::filesystem::path MountDir;
+		std::filesystem::path WriteDir; // Writes are only replayed if set.
+		std::string JsonFilename;
+		bool MaxSpeed = false;
+	};
+
+	// Reads the file data without deserializing it. Writes `Size` bytes.
+	struct RawData : gfs::BinaryStreamable
+	{
+		uint64_t Size = 0;
+
+		void Read(gfs::ReadOnlyByteBuffer& buffer) override { Size = buffer.GetSize(); }
+
+		void Write(gfs::WriteOnlyByteBuffer& buffer) const override
+		{
+			buffer.SetSize(Size);
+			std::memset(buffer.GetData(), 0, size_t(Size));
+			buffer.SetPosition(Size);
+		}
+	};
+
+	struct Samples
+	{
+		std::vector<double> RecordedNs;
+		std::vector<double> ReplayedNs;
+		uint64_t Bytes = 0;
+		uint64_t Failed = 0;
+	};
+
+	// Nearest-rank percentile of sorted samples.
+	auto Percentile(const std::vector<double>& sortedSamples, double percentile) -> double
+	{
+		if (sortedSamples.empty())
+			return 0.0;
+		const auto rank = size_t(std::ceil(percentile / 100.0 * double(sortedSamples.size())));
+		return sortedSamples[std::clamp<size_t>(rank, 1, sortedSamples.size()) - 1];
+	}
+
+	auto FormatDuration(double ns) -> std::string
+	{
+		char buffer[32];
+		if (ns < 1000.0)
+			std::snprintf(buffer, sizeof(buffer), "%.0fns", ns);
+		else if (ns < 1000000.0)
+			std::snprintf(buffer, sizeof(buffer), "%.1fus", ns / 1000.0);
+		else
+			std::snprintf(buffer, sizeof(buffer), "%.2fms", ns / 1000000.0);
+		return buffer;
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: gfs_replay <trace> <mount dir> [--max-speed] [--writes <scratch dir>] [--json <file|->]\n"
+				  << "  --max-speed  Issue calls back to back instead of at the recorded pace.\n"
+				  << "  --writes     Also replay writes, into files under the given directory.\n"
+				  << "  --json       Also write the results as JSON (\"-\" for stdout)." << std::endl;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		std::vector<std::string> positional;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--max-speed")
+				options.MaxSpeed = true;
+			else if (arg == "--writes" && i + 1 < argc)
+				options.WriteDir = argv[++i];
+			else if (arg == "--json" && i + 1 < argc)
+				options.JsonFilename = argv[++i];
+			else if (arg.rfind("--", 0) == 0)
+				return false;
+			else
+				positional.push_back(arg);
+		}
+		if (positional.size() != 2)
+			return false;
+
+		options.TraceFilename = positional[0];
+		options.MountDir = positional[1];
+		return true;
+	}
+
+	void Replay(gfs::Filesystem& fs,
+		gfs::MountID writeMount,
+		const std::vector<const gfs::AccessTraceEvent*>& events,
+		std::chrono::steady_clock::time_point startTime,
+		bool maxSpeed,
+		std::array<Samples, 2>& outSamples)
+	{
+		for (const auto* event : events)
+		{
+			if (event->Type == gfs::AccessType::Write && writeMount == gfs::InvalidMountId)
+				continue;
+
+			if (!maxSpeed)
+				std::this_thread::sleep_until(startTime + std::chrono::nanoseconds(event->TimestampNs));
+
+			RawData data{};
+			data.Size = event->Size;
+
+			const auto start = std::chrono::steady_clock::now();
+			bool succeeded = false;
+			if (event->Type == gfs::AccessType::Read)
+				succeeded = fs.ReadFile(event->FileId, data);
+			else
+				succeeded = fs.WriteFile(writeMount, "replay_" + std::to_string(event->FileId) + ".bin", event->FileId, {}, data, false);
+			const auto end = std::chrono::steady_clock::now();
+
+			auto& samples = outSamples[uint32_t(event->Type)];
+			samples.RecordedNs.push_back(double(event->DurationNs));
+			samples.ReplayedNs.push_back(double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+			samples.Bytes += data.Size;
+			samples.Failed += succeeded ? 0 : 1;
+		}
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Options options{};
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<gfs::AccessTraceEvent> events;
+	if (!gfs::ReadAccessTrace(options.TraceFilename, events))
+	{
+		std::cerr << "Failed to read trace " << options.TraceFilename << std::endl;
+		return 1;
+	}
+
+	gfs::Filesystem fs;
+	if (fs.MountDir(options.MountDir) == gfs::InvalidMountId)
+	{
+		std::cerr << "Failed to mount " << options.MountDir << std::endl;
+		return 1;
+	}
+
+	gfs::MountID writeMount = gfs::InvalidMountId;
+	if (!options.WriteDir.empty())
+	{
+		std::filesystem::create_directories(options.WriteDir);
+		writeMount = fs.MountDir(options.WriteDir, true, 1);
+		if (writeMount == gfs::InvalidMountId)
+		{
+			std::cerr << "Failed to mount " << options.WriteDir << std::endl;
+			return 1;
+		}
+	}
+
+	// Calls made on the same thread are replayed in order on the same thread.
+	std::map<uint32_t, std::vector<const gfs::AccessTraceEvent*>> threadEvents;
+	for (const auto& event : events)
+		threadEvents[event.ThreadIndex].push_back(&event);
+
+	std::vector<std::array<Samples, 2>> threadSamples(threadEvents.size());
+	std::vector<std::thread> threads;
+	threads.reserve(threadEvents.size());
+
+	const auto startTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(10); // Lets every thread start first.
+	uint32_t threadIndex = 0;
+	for (const auto& [index, eventsOnThread] : threadEvents)
+	{
+		auto& samples = threadSamples[threadIndex++];
+		threads.emplace_back([&, eventsOnThread = &eventsOnThread, samples = &samples]() {
+			std::this_thread::sleep_until(startTime);
+			Replay(fs, writeMount, *eventsOnThread, startTime, options.MaxSpeed, *samples);
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	const auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	uint64_t recordedNs = 0;
+	for (const auto& event : events)
+		recordedNs = std::max(recordedNs, event.TimestampNs + event.DurationNs);
+	const double recordedSeconds = double(recordedNs) / 1e9;
+	std::cout << events.size() << " events on " << threadEvents.size() << " threads. Recorded over " << recordedSeconds << "s, replayed in "
+			  << wallSeconds << "s (" << (options.MaxSpeed ? "max speed" : "recorded pace") << ")" << std::endl;
+
+	// Written once the report has been printed, so it is not interleaved when written to stdout.
+	std::ostringstream jsonStream;
+	std::ostream* json = options.JsonFilename.empty() ? nullptr : &jsonStream;
+	if (json)
+		*json << "{\n  \"wall_seconds\": " << wallSeconds << ",\n  \"recorded_seconds\": " << recordedSeconds << ",\n  \"results\": [";
+
+	const char* typeNames[2] = { "read", "write" };
+	bool firstResult = true;
+	for (uint32_t type = 0; type < 2; ++type)
+	{
+		Samples merged{};
+		for (auto& samples : threadSamples)
+		{
+			auto& typeSamples = samples[type];
+			merged.RecordedNs.insert(merged.RecordedNs.end(), typeSamples.RecordedNs.begin(), typeSamples.RecordedNs.end());
+			merged.ReplayedNs.insert(merged.ReplayedNs.end(), typeSamples.ReplayedNs.begin(), typeSamples.ReplayedNs.end());
+			merged.Bytes += typeSamples.Bytes;
+			merged.Failed += typeSamples.Failed;
+		}
+		if (merged.ReplayedNs.empty())
+			continue;
+
+		std::sort(merged.RecordedNs.begin(), merged.RecordedNs.end());
+		std::sort(merged.ReplayedNs.begin(), merged.ReplayedNs.end());
+
+		const auto count = merged.ReplayedNs.size();
+		std::cout << typeNames[type] << ": " << count << " calls, " << merged.Failed << " failed, " << merged.Bytes << " bytes" << std::endl;
+		for (const auto* samples : { &merged.RecordedNs, &merged.ReplayedNs })
+		{
+			char line[256];
+			std::snprintf(line,
+				sizeof(line),
+				"  %-9s p50 %-9s p90 %-9s p99 %-9s max %-9s",
+				samples == &merged.RecordedNs ? "recorded" : "replayed",
+				FormatDuration(Percentile(*samples, 50.0)).c_str(),
+				FormatDuration(Percentile(*samples, 90.0)).c_str(),
+				FormatDuration(Percentile(*samples, 99.0)).c_str(),
+				FormatDuration(samples->back()).c_str());
+			std::cout << line << std::endl;
+		}
+
+		if (json)
+		{
+			*json << (firstResult ? "\n" : ",\n") << "    {\"type\": \"" << typeNames[type] << "\", \"calls\": " << count << ", \"failed\": " << merged.Failed
+				  << ", \"bytes\": " << merged.Bytes;
+			for (const auto& [name, samples] : { std::make_pair("recorded", &merged.RecordedNs), std::make_pair("replayed", &merged.ReplayedNs) })
+			{
+				*json << ", \"" << name << "_p50_ns\": " << uint64_t(Percentile(*samples, 50.0)) << ", \"" << name
+					  << "_p90_ns\": " << uint64_t(Percentile(*samples, 90.0)) << ", \"" << name << "_p99_ns\": " << uint64_t(Percentile(*samples, 99.0))
+					  << ", \"" << name << "_max_ns\": " << uint64_t(samples->back());
+			}
+			*json << "}";
+		}
+		firstResult = false;
+	}
+
+	if (json)
+	{
+		*json << "\n  ]\n}" << std::endl;
+		if (options.JsonFilename == "-")
+		{
+			std::cout << jsonStream.str();
+		}
+		else
+		{
+			std::ofstream jsonFile(options.JsonFilename);
+			jsonFile << jsonStream.str();
+			if (!jsonFile)
+			{
+				std::cerr << "Failed to write " << options.JsonFilename << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}